@@ -1,8 +1,21 @@
+#ifndef _WIN32
+#define _FILE_OFFSET_BITS 64            /* 64-bit file offsets of fseeko() */
+#endif
 #include <stdarg.h>
 #include <stdio.h>
 #include <string.h>
 #include <stdlib.h>
 #include <math.h>
+#ifdef _WIN32
+#include <windows.h>
+#include <intrin.h>
+#else
+#include <time.h>
+#include <pthread.h>
+#endif
+#if defined(__GNUC__)&&defined(__x86_64__)
+#include <cpuid.h>
+#endif
 #include "rtcmCnv.h"
 
 
@@ -18,12 +31,32 @@
 #define SYS_ALL     0xFF                /* navigation system: all */
 
 #define RTCM3PREAMB 0xD3        /* rtcm ver.3 frame preamble */
+#define MAXRTCMLEN  1029        /* max rtcm ver.3 frame length (bytes) */
+#define LEAPS       18          /* leap seconds (GPST-UTC) (s) */
+#define DLTTYPE     4088        /* msm4 delta message type (proprietary) */
+#define DLTSEQ      256         /* msm4 delta message sequence modulo */
+
+#define SSR_ORB     0           /* ssr message: orbit correction */
+#define SSR_CLK     1           /* ssr message: clock correction */
+#define SSR_CBIAS   2           /* ssr message: code bias */
+#define SSR_COMB    3           /* ssr message: combined orbit and clock */
+#define SSR_URA     4           /* ssr message: user range accuracy */
+#define SSR_HRCLK   5           /* ssr message: high-rate clock correction */
+#define SSR_PBIAS   6           /* ssr message: phase bias */
+#define SSR_MAXBIAS 512         /* max number of biases in ssr message */
+#define REP_NEPH    7           /* number of ephemeris types of repeat suppression */
+#define REP_NSTA    5           /* number of station types of repeat suppression */
+#define REP_NKEY    (REP_NEPH*64+REP_NSTA) /* number of repeat suppression keys */
+#define WEEK_MS     604800000   /* ms in a week */
 
 #define P2_10       0.0009765625          /* 2^-10 */
 #define P2_24       5.960464477539063E-08 /* 2^-24 */
 #define P2_29       1.862645149230957E-09 /* 2^-29 */
+#define P2_31       4.656612873077393E-10 /* 2^-31 */
 #define CLIGHT      299792458.0         /* speed of light (m/s) */
 #define RANGE_MS    (CLIGHT*0.001)      /* range in 1 ms */
+#define PRUNIT_GPS  299792.458          /* rtcm 3 unit of gps pseudorange (m) */
+#define PRUNIT_GLO  599584.916          /* rtcm 3 unit of glonass pseudorange (m) */
 
 #define CODE_NONE   0                   /* obs code: none or unknown */
 #define CODE_L1C    1                   /* obs code: L1C/A,G1C/A,E1C (GPS,GLO,GAL,QZS,SBS) */
@@ -202,6 +235,7 @@
 #endif
 
 #define SNR_UNIT    0.001               /* SNR unit (dBHz) */
+#define ARENA_SIZE  (sizeof(obsd_con)*MAXOBS+8192) /* epoch scratch arena size (bytes) */
 
 #define ROUND(x)    ((int)floor((x)+0.5))
 #define ROUND_U(x)  ((uint32_t)floor((x)+0.5))
@@ -214,10 +248,41 @@ static char file_trace[1024];   /* trace file */
 
 
 typedef unsigned char uint8_t;
+typedef unsigned short uint16_t;
 typedef unsigned int  uint32_t;
+typedef short int16_t;
 typedef int int32_t;
+typedef unsigned long long uint64_t;
+
+/* next job index of worker threads ----------------------------------------*/
+#ifdef __GNUC__
+#define JOB_NEXT(n)     __atomic_fetch_add(&(n),1,__ATOMIC_RELAXED)
+#else
+#define JOB_NEXT(n)     (_InterlockedIncrement((volatile long *)&(n))-1)
+#endif
+
+/* 64-bit file offsets (archives and indexes over 2 GiB) --------------------*/
+#ifdef _WIN32
+#define FSEEK64(fp,off,org) _fseeki64(fp,(__int64)(off),org)
+#define FTELL64(fp)         _ftelli64(fp)
+#else
+#define FSEEK64(fp,off,org) fseeko(fp,(off_t)(off),org)
+#define FTELL64(fp)         ((long long)ftello(fp))
+#endif
+
+/* statistics counters: single writer (converter), lock-free readers --------*/
+#ifdef __GNUC__
+#define STAT_GET(x)     __atomic_load_n(&(x),__ATOMIC_RELAXED)
+#define STAT_ADD(x,n)   __atomic_store_n(&(x),STAT_GET(x)+(n),__ATOMIC_RELAXED)
+#define STAT_SET(x,v)   __atomic_store_n(&(x),(v),__ATOMIC_RELAXED)
+#else
+#define STAT_GET(x)     (*(volatile uint64_t *)&(x))
+#define STAT_ADD(x,n)   (*(volatile uint64_t *)&(x)=STAT_GET(x)+(n))
+#define STAT_SET(x,v)   (*(volatile uint64_t *)&(x)=(v))
+#endif
 
 
+/* default GLONASS fcn (used until fcn is received in the stream) */
 const int glo_fcn[32]={
                       1,-4,5,6,1,-4,5,6,
                       2,-7,0,-1,-2,-7,0,-1,
@@ -307,6 +372,34 @@ const char *msm_sig_irn[32]={
     ""  ,""  ,""  ,""  ,""  ,""  ,""  ,""
 };
 
+/* ssr signal and tracking mode ids to obs codes ----------------------------*/
+static const uint8_t ssr_sig_gps[32]={
+    CODE_L1C,CODE_L1P,CODE_L1W,CODE_L1S,CODE_L1L,CODE_L2C,CODE_L2D,CODE_L2S,
+    CODE_L2L,CODE_L2X,CODE_L2P,CODE_L2W,       0,       0,CODE_L5I,CODE_L5Q
+};
+static const uint8_t ssr_sig_glo[32]={
+    CODE_L1C,CODE_L1P,CODE_L2C,CODE_L2P,CODE_L4A,CODE_L4B,       0,       0,
+    CODE_L3I,CODE_L3Q
+};
+static const uint8_t ssr_sig_gal[32]={
+    CODE_L1A,CODE_L1B,CODE_L1C,       0,       0,CODE_L5I,CODE_L5Q,       0,
+    CODE_L7I,CODE_L7Q,       0,CODE_L8I,CODE_L8Q,       0,CODE_L6A,CODE_L6B,
+    CODE_L6C
+};
+static const uint8_t ssr_sig_qzs[32]={
+    CODE_L1C,CODE_L1S,CODE_L1L,CODE_L2S,CODE_L2L,       0,CODE_L5I,CODE_L5Q,
+           0,CODE_L6S,CODE_L6L,       0,       0,       0,       0,       0,
+           0,CODE_L6E
+};
+static const uint8_t ssr_sig_sbs[32]={
+    CODE_L1C,CODE_L5I,CODE_L5Q
+};
+static const uint8_t ssr_sig_cmp[32]={
+    CODE_L2I,CODE_L2Q,       0,CODE_L6I,CODE_L6Q,       0,CODE_L7I,CODE_L7Q,
+           0,CODE_L1D,CODE_L1P,       0,CODE_L5D,CODE_L5P,       0,CODE_L1A,
+           0,       0,CODE_L6A
+};
+
 static char *obscodes[]={       /* observation code strings */
 
     ""  ,"1C","1P","1W","1Y", "1M","1N","1S","1L","1E", /*  0- 9 */
@@ -368,6 +461,11 @@ typedef struct {        /* observation data */
     obsd_con *data;       /* observation data records */
 } obs_con;
 
+typedef struct {        /* epoch scratch arena type */
+    uint8_t *buff;      /* arena buffer (NULL:not allocated) */
+    size_t size,used;   /* size/used bytes of arena */
+} arena_con;
+
 typedef struct {              /* multi-signal-message header type */
 //    uint8_t iod;              /* issue of data station */
 //    uint8_t time_s;           /* cumulative session transmitting time */
@@ -378,9 +476,78 @@ typedef struct {              /* multi-signal-message header type */
     uint8_t nsat,nsig;        /* number of satellites/signals */
     uint8_t sats[64];         /* satellites */
     uint8_t sigs[32];         /* signals */
-    uint8_t cellmask[64];     /* cell mask */
+    uint64_t cellmask;        /* cell mask (bit n: cell n=isat*nsig+isig) */
 } msm_h_con;
 
+typedef struct {              /* MSM cell store type (structure of arrays) */
+    msm_h_con h;              /* msm header (satellite/signal/cell mask) */
+    int sys,msm,ncell;        /* satellite system/msm type (4-7)/number of cells */
+    uint8_t  rng  [64];       /* rough range integer ms (255:invalid) */
+    uint8_t  ex   [64];       /* extended satellite info (msm5,7) */
+    uint16_t rng_m[64];       /* rough range modulo 1 ms (2^-10 ms) */
+    int16_t  rate [64];       /* rough phaserange rate (m/s,-8192:invalid) (msm5,7) */
+    int32_t  prv  [64];       /* fine pseudorange (2^-24|2^-29 ms) */
+    int32_t  cpv  [64];       /* fine phaserange (2^-29|2^-31 ms) */
+    uint16_t lock [64];       /* lock time indicator */
+    uint64_t half;            /* half-cycle ambiguity indicator (bit n: cell n) */
+    uint64_t slip;            /* loss-of-lock flag (bit n: cell n) */
+    uint16_t cnr  [64];       /* signal cnr (1|2^-4 dBHz) */
+    int16_t  rrv  [64];       /* fine phaserange rate (0.0001 m/s,-16384:invalid) (msm5,7) */
+} msm_cell_con;               /* satellite fields: [isat], cell fields: [isat*nsig+isig] */
+
+typedef struct {              /* MSM4 message integers type (for delta coding) */
+    int type,nsat,nsig,ncell; /* message type/number of satellites/signals/cells */
+    uint32_t staid,epoch,sync,info; /* station id/epoch/sync/iods..smoothing int */
+    uint32_t satm[2],sigm;    /* satellite/signal mask */
+    uint64_t cellm;           /* cell mask (bit n: cell n) */
+    int64_t  rr   [64];       /* rough range (2^-10 ms) */
+    int64_t  pr   [64];       /* pseudorange (2^-24 ms) */
+    int64_t  cp   [64];       /* phaserange (2^-29 ms) */
+    uint8_t  lock [64];       /* lock time indicator */
+    uint8_t  half [64];       /* half-cycle ambiguity indicator */
+    uint8_t  cnr  [64];       /* signal cnr (dBHz) */
+} dlt_msm_con;                /* satellite fields: [isat], cell fields: [icell] */
+
+typedef struct {              /* MSM4 delta state of system type */
+    int nep;                  /* number of epochs in history (0:no state) */
+    int nseq;                 /* number of delta messages since keyframe */
+    uint32_t kepoch;          /* epoch of keyframe */
+    dlt_msm_con m;            /* last epoch */
+    uint32_t epoch;           /* epoch before last */
+    int64_t rr[64],pr[64],cp[64]; /* rough range/pseudorange/phaserange before last */
+} dlt_sys_con;
+
+typedef struct {              /* MSM4 delta coding type */
+    int nkey;                 /* keyframe interval (epochs) (0:decode only) */
+    dlt_sys_con sys[7];       /* delta state of systems */
+} dlt_con;
+
+typedef struct {              /* SSR message type (for signal filtering) */
+    int msg;                  /* ssr message (SSR_???) */
+    int hsize;                /* header size before number of satellites (bits) */
+    int ns,np,nx,nb;          /* number of satellites/prn/yaw/bias field size (bits) */
+    int nsat,nbias;           /* number of kept satellites/biases */
+    uint16_t sat[64];         /* position of kept satellites (bits) */
+    uint8_t  nbs[64];         /* number of kept biases of satellite */
+    uint16_t bias[SSR_MAXBIAS]; /* position of kept biases (bits) */
+} ssr_con;                    /* positions in message of rtcm->buff */
+
+typedef struct {              /* repeated message suppression type */
+    int tint;                 /* refresh interval (ms) */
+    int tow;                  /* stream time by last msm epoch (gps tow ms) (-1:no) */
+    uint32_t hash[REP_NKEY];  /* content hash of last forwarded message (0:no) */
+    int tfwd[REP_NKEY];       /* stream time of last forwarded message (-1:no) */
+} rep_con;                    /* keys: ephemeris type*64+prn, station type */
+
+struct rtcmprof_tag {         /* frequency selection profile type */
+    char frq[7][40];          /* frequency selection strings of systems */
+    int num[7];               /* number of selected frequencies */
+    int idx[7][NFREQ];        /* selection index of frequency (NFREQ:not selected) */
+    int bycode[7];            /* signals of system selected by obs codes */
+    uint8_t code[7][MAXCODE+1]; /* selected obs codes (1:selected) */
+    int err[7];               /* unknown frequency in selection string */
+};
+
 
 typedef struct {        /* RTCM control struct type */
 //    int staid;          /* station id */
@@ -390,6 +557,9 @@ typedef struct {        /* RTCM control struct type */
 //    gtime_t time;       /* message time */
 //    gtime_t time_s;     /* message start time */
     obs_con obs;          /* observation data (uncorrected) */
+    msm_cell_con cell;    /* msm cells of current message */
+    ssr_con ssr;          /* ssr biases of current message */
+    arena_con arena;      /* epoch scratch arena (obs data, msm2obs scratch) */
 //    nav_t nav;          /* satellite ephemerides */
 //    sta_t sta;          /* station parameters */
 //    dgps_t *dgps;       /* output of dgps corrections */
@@ -404,10 +574,28 @@ typedef struct {        /* RTCM control struct type */
 //    uint32_t lock[MAXSAT][NFREQ+NEXOBS]; /* lock time */ //change ZRZ uint32_t
 //    uint16_t loss[MAXSAT][NFREQ+NEXOBS]; /* loss of lock count */
 //    gtime_t lltime[MAXSAT][NFREQ+NEXOBS]; /* last lock time */
-//    int nbyte;          /* number of bytes in message buffer */
+    int nbyte;          /* number of bytes in message buffer */
+    int nneed;          /* number of bytes to next input state */
+    int skip;           /* skip frame (1:rejected,2:decimated before end of frame,
+                           3:type not converted) */
+    int hcell,hsize;    /* msm header decoded on input (cells/bits,-1:no) */
     int nbit;           /* number of bits in word buffer (bits) */
     int len;            /* message length (bytes) */
     int lensd;
+    int ncell[2];       /* number of decoded/encoded cells */
+    uint8_t glo_fcn[32]; /* glonass fcn cache (fcn+8,0:no data) */
+    uint16_t lock[MAXSAT][32]; /* last lock time indicator of msm signal */
+    rtcmprof_t frqp;    /* profile compiled from freq_c of last message */
+    const rtcmprof_t *prof; /* frequency selection profile of current message */
+    int selok[7];       /* signal selection cache valid */
+    uint32_t selsig[7],selkeep[7]; /* signal selection cache (signal/keep mask) */
+    int tint,toff;      /* msm epoch decimation interval/offset (ms) (0:off) */
+    int nosel;          /* encode all cells without frequency selection */
+    int verify;         /* verify converted msm messages */
+    dlt_con *dlt;       /* msm4 delta coding (NULL:off) */
+    rep_con *rep;       /* repeated message suppression (NULL:off) */
+    int legacy;         /* legacy observation message conversion (RTCMLEG_???) */
+    double legcp[MAXSAT][2]; /* last legacy L1/L2 phaserange-pseudorange (m) */
     uint8_t buff[1200]; /* message buffer */
     uint8_t buffsd[1200];
 //    uint32_t word;      /* word buffer for rtcm 2 */
@@ -416,13 +604,132 @@ typedef struct {        /* RTCM control struct type */
 //    char opt[256];      /* RTCM dependent options */
 } rtcm_con;
 
+struct rtcmcvt_tag {    /* RTCM stream converter type */
+    rtcm_con rtcm;      /* rtcm control struct */
+    rtcmstat_t stat;    /* conversion statistics */
+    rtcmprof_t *prof;   /* installed selection profile (NULL:no) */
+    rtcmprof_t *next;   /* pending selection profile swapped in on next input */
+};
+
+#define COL_NCOL    9           /* number of columns of columnar export */
+#define COL_MAGIC   "RTCMCOL1"  /* magic of columnar export file */
+
+typedef struct {        /* columnar export chunk directory type */
+    uint32_t nrow;      /* number of rows */
+    uint32_t reserved;
+    int64_t tmin,tmax;  /* epoch min/max (ms) */
+    uint64_t off[COL_NCOL]; /* file offset of columns */
+} colchk_con;
+
+struct rtcmcol_tag {    /* columnar export type */
+    FILE *fp;           /* output file */
+    uint64_t off;       /* current file offset */
+    int nmax,n;         /* max number/number of rows of chunk */
+    int week;           /* gps week of epochs */
+    int tow;            /* time of week of last epoch (ms) (-1:no) */
+    int64_t tmin,tmax;  /* epoch min/max of chunk (ms) */
+    int64_t  *epoch;    /* column 0: epoch (gps time,ms) */
+    uint16_t *sat;      /* column 1: satellite (dictionary index) */
+    uint8_t  *sig;      /* column 2: signal (dictionary index) */
+    double   *P,*L;     /* column 3,4: pseudorange (m)/carrier-phase (cycle) */
+    float    *D,*SNR;   /* column 5,6: doppler (Hz)/signal strength (dBHz) */
+    uint8_t  *LLI;      /* column 7: loss of lock indicator */
+    uint16_t *lock;     /* column 8: lock time indicator */
+    int nsat,nsig;      /* number of dictionary entries */
+    char sats[MAXSAT][4]; /* satellite dictionary ("G01",...) */
+    char sigs[MAXCODE+1][4]; /* signal dictionary ("1C",...) */
+    int satidx[MAXSAT+1]; /* satellite number to dictionary index+1 */
+    int sigidx[MAXCODE+1]; /* obs code to dictionary index+1 */
+    colchk_con *chk;    /* chunk directory */
+    int nchk,nchkmax;   /* number of chunks/allocated */
+};
+
+#define IDX_MAGIC   "RTCMIDX1"  /* magic of frame index file */
+#define IDX_HSIZE   16          /* size of frame index header (bytes) */
+#define IDX_RSIZE   16          /* size of frame index record (bytes) */
+
+struct rtcmidxw_tag {   /* RTCM 3 frame index writer type */
+    FILE *fp;           /* index file */
+    uint64_t off;       /* archive offset of next input byte */
+    int64_t t;          /* epoch of last msm message (ms) (-1:no) */
+    int nbyte,len;      /* number of bytes in buffer/frame length */
+    uint8_t buff[1200]; /* frame buffer */
+};
+
+#define IDX_EXT     ".idx"      /* extension of frame index file of archive */
+#define EXT_NBUF    1048576     /* archive read block of extraction (bytes) */
+#define EXT_MAXTHR  64          /* max number of extraction threads */
+
+typedef struct {        /* archive extraction type */
+    const char **files; /* archive files */
+    const char **outfiles; /* output files */
+    int nfile;          /* number of archive files */
+    uint32_t ts,te;     /* epoch window (gps time of week,ms) */
+    const int *types;   /* message types (NULL:all) */
+    int ntype;          /* number of message types */
+    int sysmask;        /* system indexes of frame index (bit 1-7,0:all) */
+    char **freq_c;      /* frequency selection (NULL:no conversion) */
+    int *nout;          /* number of frames output of each file */
+    long next;          /* next archive file (shared by threads) */
+} ext_con;
+
+#define RNX_NSIG    32          /* max number of signals of system in rinex */
+#define RNX_PGM     "rtcmCnv"   /* program name of rinex header */
+
+typedef struct {        /* rinex epoch record of satellite type */
+    int sat,sys;        /* satellite number/system */
+    int n;              /* number of signals */
+    uint8_t code[NFREQ+NEXOBS]; /* obs code */
+    double P[NFREQ+NEXOBS],L[NFREQ+NEXOBS]; /* pseudorange (m)/carrier-phase (cycle) */
+    float D[NFREQ+NEXOBS],S[NFREQ+NEXOBS]; /* doppler (Hz)/signal strength (dBHz) */
+    uint8_t LLI[NFREQ+NEXOBS]; /* loss of lock indicator */
+} rnxsat_con;
+
+struct rtcmrnx_tag {    /* rinex observation writer type */
+    FILE *fp;           /* rinex file (header written on close) */
+    FILE *fb;           /* temporary file of observation records */
+    double ver;         /* rinex version */
+    char marker[61];    /* marker name */
+    int week,tow;       /* gps week/time of week of last epoch (ms) (-1:no) */
+    int64_t t;          /* gps time of buffered epoch (ms) (-1:no) */
+    int64_t ts,te;      /* gps time of first/last epoch (ms) (-1:no) */
+    int nsig[7];        /* number of signals of systems */
+    uint8_t sigs[7][RNX_NSIG]; /* obs codes of systems in order of obs types */
+    rnxsat_con sat[MAXOBS]; /* epoch records of satellites */
+    int nsat;           /* number of satellites of buffered epoch */
+    uint8_t glo_fcn[32]; /* glonass fcn (fcn+8,0:no data) */
+    char *buff;         /* epoch output buffer */
+};
+
 
-int m_gnss_frq_idx[8][MAXFREQ];
-int m_gnss_frq_num[8];
+/* profile pointer exchange: pending profile handed over to converter ------*/
+#ifdef __GNUC__
+#define PROF_GET(p)     __atomic_load_n(&(p),__ATOMIC_ACQUIRE)
+#define PROF_XCHG(p,v)  __atomic_exchange_n(&(p),(v),__ATOMIC_ACQ_REL)
+#else
+#define PROF_GET(p)     (*(rtcmprof_t *volatile *)&(p))
+#define PROF_XCHG(p,v)  ((rtcmprof_t *)_InterlockedExchangePointer((void *volatile *)&(p),(v)))
+#endif
+
+/* copy string with length limit ---------------------------------------------
+* args   : char   *dst       O   destination (terminated)
+*          char   *src       I   source string
+*          size_t size       I   size of destination (bytes)
+* return : none
+* notes  : a longer source is cut at size-1 characters
+*-----------------------------------------------------------------------------*/
+static void strcpyn(char *dst, const char *src, size_t size)
+{
+    size_t n=strlen(src);
 
+    if (n>size-1) n=size-1;
+    memcpy(dst,src,n);
+    dst[n]='\0';
+}
+/* frequency string to frequency index (-1:unknown frequency) ---------------*/
 static int obsfrqstr2idx(const char* frq_str,int sys_idx)
 {
-    int i,idx=0;
+    int i,idx=-1;
     for(i=0;i<MAXFREQ;i++){
         if(!strcmp(frq_str,obsfrqstr[sys_idx][i])){
             idx = *obsfrqidx[sys_idx][i];
@@ -432,49 +739,43 @@ static int obsfrqstr2idx(const char* frq_str,int sys_idx)
     return idx;
 }
 
-static int getobsfrqidx(char* frq_str,int sys,int *idxs)
-{
-    int sys_idx=0,i=0;
-    for (int j=0;j<NFREQ;j++){
-        idxs[j] = MAXFREQ;
-    }
-    switch (sys){
-        case SYS_GLO: sys_idx = 1;break;
-        case SYS_GAL: sys_idx = 2;break;
-        case SYS_QZS: sys_idx = 3;break;
-        case SYS_SBS: sys_idx = 4;break;
-        case SYS_CMP: sys_idx = 5;break;
-        case SYS_IRN: sys_idx = 6;break;
-//        case SYS_LEO: sys_idx = 7;break;
-    }
-
-    char *token;
-
-    token = strtok(frq_str,"+");
-    while(token){
-        idxs[i++]=obsfrqstr2idx(token,sys_idx)+1;
-        token=strtok(NULL,"+");
-    }
-    return i;
-
-}
-
-
-
-static void setfrqpri(char frq_[40],int i)
+/* compile frequency selection of system ---------------------------------------
+* args   : rtcmprof_t *prof  IO  frequency selection profile
+*          int    i          I   system index (0:GPS,1:GLO,2:GAL,3:QZS,4:SBS,
+*                                5:BDS,6:IRN)
+*          char  *frq        I   frequency selection ("L1+L2",...,NULL:none)
+* return : status (1:ok,0:unknown frequency)
+* notes  : the string is not modified. an unknown frequency selects nothing
+*          and is marked in prof->err[i]
+*-----------------------------------------------------------------------------*/
+static int setfrqpri(rtcmprof_t *prof, int i, const char *frq)
 {
-    int sys;
-        switch (i){
-            case 0: sys=SYS_GPS; m_gnss_frq_num[i]=getobsfrqidx(frq_,sys,m_gnss_frq_idx[0]);break;
-            case 1: sys=SYS_GLO; m_gnss_frq_num[i]=getobsfrqidx(frq_,sys,m_gnss_frq_idx[1]);break;
-            case 2: sys=SYS_GAL; m_gnss_frq_num[i]=getobsfrqidx(frq_,sys,m_gnss_frq_idx[2]);break;
-            case 3: sys=SYS_QZS; m_gnss_frq_num[i]=getobsfrqidx(frq_,sys,m_gnss_frq_idx[3]);break;
-            case 4: sys=SYS_SBS; m_gnss_frq_num[i]=getobsfrqidx(frq_,sys,m_gnss_frq_idx[4]);break;
-            case 5: sys=SYS_CMP; m_gnss_frq_num[i]=getobsfrqidx(frq_,sys,m_gnss_frq_idx[5]);break;
-            case 6: sys=SYS_IRN; m_gnss_frq_num[i]=getobsfrqidx(frq_,sys,m_gnss_frq_idx[6]);break;
+    const char *p,*q;
+    char str[8];
+    int j,k,n=0;
+
+    memset(prof->frq[i],0,sizeof(prof->frq[i]));
+    if (frq) strcpyn(prof->frq[i],frq,sizeof(prof->frq[i]));
+
+    for (j=0;j<NFREQ;j++) prof->idx[i][j]=NFREQ;
+    prof->bycode[i]=0;
+    prof->err[i]=0;
+    memset(prof->code[i],0,sizeof(prof->code[i]));
+
+    for (p=prof->frq[i];*p&&n<NFREQ;p=*q?q+1:q) {
+        if (!(q=strchr(p,'+'))) q=p+strlen(p);
+        if (q==p) continue; /* empty token */
+        j=(int)(q-p)<(int)sizeof(str)-1?(int)(q-p):(int)sizeof(str)-1;
+        memcpy(str,p,j);
+        str[j]='\0';
+        if ((k=obsfrqstr2idx(str,i))<0) {
+            prof->err[i]=1;
+            continue;
         }
-
-
+        prof->idx[i][k]=n++;
+    }
+    prof->num[i]=n;
+    return !prof->err[i];
 }
 
 API_DECLSPEC void rtcmlogopen(const char *file)
@@ -484,7 +785,7 @@ API_DECLSPEC void rtcmlogopen(const char *file)
 
 //        reppath(file,path,time,"","");
         if (!*file||!(fp_trace=fopen(file,"w"))) fp_trace=stderr;
-        strcpy(file_trace,file);
+        strcpyn(file_trace,file,sizeof(file_trace));
 //        tick_trace=tickget();
 //        time_trace=time;
 //        initlock(&lock_trace);
@@ -516,6 +817,73 @@ static void trace(int level, const char *format, ...)
     fflush(fp_trace);
 }
 
+/* get monotonic tick time -----------------------------------------------------
+* get current monotonic tick in ns for latency measurement
+* args   : none
+* return : current tick in ns
+*-----------------------------------------------------------------------------*/
+static uint64_t tickget_ns(void)
+{
+#ifdef _WIN32
+    static LARGE_INTEGER freq={{0}};
+    LARGE_INTEGER cnt;
+
+    if (!freq.QuadPart) QueryPerformanceFrequency(&freq);
+    QueryPerformanceCounter(&cnt);
+    return (uint64_t)(cnt.QuadPart/freq.QuadPart*1000000000+
+                      cnt.QuadPart%freq.QuadPart*1000000000/freq.QuadPart);
+#else
+    struct timespec tp={0};
+
+    clock_gettime(CLOCK_MONOTONIC,&tp);
+    return (uint64_t)tp.tv_sec*1000000000+(uint64_t)tp.tv_nsec;
+#endif
+}
+
+/* message type to statistics index (1-299:1001-1299,300-329:4070-4099,0:other) */
+static int stat_typeidx(int type)
+{
+    if (1001<=type&&type<=1299) return type-1000;
+    if (4070<=type&&type<=4099) return type-3770;
+    return 0;
+}
+
+/* statistics index to message type ------------------------------------------*/
+static int stat_idxtype(int idx)
+{
+    return idx<300?idx+1000:idx+3770;
+}
+
+/* latency to histogram bin ----------------------------------------------------
+* log-linear (hdr-style) bins: bin 0 < 2^6 ns, then 4 linear sub-bins for each
+* power of 2 up to 2^32 ns (relative resolution 25%)
+*-----------------------------------------------------------------------------*/
+static int stat_latbin(uint64_t ns)
+{
+    int e;
+
+    if (ns<64) return 0;
+    for (e=6;e<31&&(ns>>(e+1));e++) ;
+    return 1+(e-6)*4+(int)((ns>>(e-2))&3);
+}
+
+/* upper bound of histogram bin (ns) -----------------------------------------*/
+static uint64_t stat_binub(int bin)
+{
+    int e=(bin-1)/4+6;
+
+    if (bin<=0) return 64;
+    return (uint64_t)(5+(bin-1)%4)<<(e-2);
+}
+
+/* add latency sample --------------------------------------------------------*/
+static void stat_lat(rtcmstat_t *stat, int stage, uint64_t t0, uint64_t t1)
+{
+    if (!stat) return;
+    STAT_ADD(stat->lat[stage][stat_latbin(t1-t0)],1);
+    STAT_ADD(stat->latsum[stage],t1-t0);
+}
+
 /* crc-24q parity --------------------------------------------------------------
 * compute crc-24q parity for sbas, rtcm3
 * args   : uint8_t *buff    I   data
@@ -543,10 +911,13 @@ static uint32_t rtk_crc24q(const uint8_t *buff, int len)
 *-----------------------------------------------------------------------------*/
 static uint32_t getbitu(const uint8_t *buff, int pos, int len)
 {
-    uint32_t bits=0;
-    int i;
-    for (i=pos;i<pos+len;i++) bits=(bits<<1)+((buff[i/8]>>(7-i%8))&1u);
-    return bits;
+    const uint8_t *p=buff+pos/8;
+    uint64_t bits=0;
+    int i,n=(pos%8+len+7)/8;
+
+    if (len<=0) return 0;
+    for (i=0;i<n;i++) bits=(bits<<8)|p[i]; /* bytes of bit field */
+    return (uint32_t)((bits>>(n*8-pos%8-len))&(((uint64_t)1<<len)-1));
 }
 
 /* obs code to obs code string -------------------------------------------------
@@ -592,6 +963,171 @@ static void setbits(uint8_t *buff, int pos, int len, int32_t data)
     setbitu(buff,pos,len,(uint32_t)data);
 }
 
+/* count/find set bits of 64 bit mask ---------------------------------------*/
+static int popcnt64(uint64_t x)
+{
+#if defined(__GNUC__)
+    return __builtin_popcountll(x);
+#else
+    int n;
+    for (n=0;x;x&=x-1) n++;
+    return n;
+#endif
+}
+static int ctz64(uint64_t x)
+{
+#if defined(__GNUC__)
+    return __builtin_ctzll(x);
+#elif defined(_MSC_VER)&&defined(_M_X64)
+    unsigned long n;
+    _BitScanForward64(&n,x);
+    return (int)n;
+#else
+    int n;
+    for (n=0;!(x&1);x>>=1) n++;
+    return n;
+#endif
+}
+
+/* parallel bit extract --------------------------------------------------------
+* gather bits of x selected by mask m to contiguous low bits (BMI2 PEXT)
+* args   : uint64_t x       I   source bits
+*          uint64_t m       I   mask
+* return : extracted bits
+* notes  : the BMI2 instruction is selected at run time. it is not used on AMD
+*          cpus before zen 3, where PEXT is microcoded and slower than scalar
+*-----------------------------------------------------------------------------*/
+static uint64_t pext64_c(uint64_t x, uint64_t m)
+{
+    uint64_t r=0,b=1;
+
+    for (;m;m&=m-1,b<<=1) {
+        if (x&m&(~m+1)) r|=b;
+    }
+    return r;
+}
+#if defined(__GNUC__)&&defined(__x86_64__)
+__attribute__((target("bmi2")))
+static uint64_t pext64_bmi2(uint64_t x, uint64_t m)
+{
+    return __builtin_ia32_pext_di(x,m);
+}
+#define MSM_BMI2
+#elif defined(_MSC_VER)&&defined(_M_X64)
+static uint64_t pext64_bmi2(uint64_t x, uint64_t m)
+{
+    return _pext_u64(x,m);
+}
+#define MSM_BMI2
+#endif
+
+#ifdef MSM_BMI2
+static int cpuid_bmi2(void)
+{
+    unsigned int r[4]={0},fam;
+    char vendor[13]={0};
+
+#ifdef _MSC_VER
+    int q[4];
+    __cpuid(q,0); r[0]=q[0]; r[1]=q[1]; r[2]=q[2]; r[3]=q[3];
+#else
+    __get_cpuid(0,r,r+1,r+2,r+3);
+#endif
+    if (r[0]<7) return 0;
+    memcpy(vendor,r+1,4); memcpy(vendor+4,r+3,4); memcpy(vendor+8,r+2,4);
+#ifdef _MSC_VER
+    __cpuid(q,1); fam=(unsigned int)q[0];
+#else
+    __get_cpuid(1,r,r+1,r+2,r+3); fam=r[0];
+#endif
+    fam=((fam>>8)&0xF)+((fam>>20)&0xFF);
+    if (!strcmp(vendor,"AuthenticAMD")&&fam<0x19) return 0; /* slow pext */
+#ifdef _MSC_VER
+    __cpuidex(q,7,0); r[1]=(unsigned int)q[1];
+#else
+    __get_cpuid_count(7,0,r,r+1,r+2,r+3);
+#endif
+    return (r[1]>>8)&1;
+}
+#endif
+
+static uint64_t (*pext64)(uint64_t x, uint64_t m)=pext64_c;
+
+/* select parallel bit extract -------------------------------------------------
+* resolve pext64 once per process. every converter calls pext64_init() before
+* its first conversion, so the pointer is written before any thread reads it
+*-----------------------------------------------------------------------------*/
+#ifdef _WIN32
+static INIT_ONCE pext64_once=INIT_ONCE_STATIC_INIT;
+
+static BOOL CALLBACK pext64_sel(PINIT_ONCE once, PVOID arg, PVOID *ctx)
+#else
+static pthread_once_t pext64_once=PTHREAD_ONCE_INIT;
+
+static void pext64_sel(void)
+#endif
+{
+#ifdef MSM_BMI2
+    pext64=cpuid_bmi2()?pext64_bmi2:pext64_c;
+#else
+    pext64=pext64_c;
+#endif
+    trace(3,"pext64: %s\n",pext64==pext64_c?"scalar":"bmi2");
+#ifdef _WIN32
+    return TRUE;
+#endif
+}
+static void pext64_init(void)
+{
+#ifdef _WIN32
+    InitOnceExecuteOnce(&pext64_once,pext64_sel,NULL,NULL);
+#else
+    pthread_once(&pext64_once,pext64_sel);
+#endif
+}
+
+/* bit stream writer -----------------------------------------------------------
+* append bits msb first to byte data through 64 bit accumulator
+* notes  : bits after the last written bit in the last byte are cleared
+*-----------------------------------------------------------------------------*/
+typedef struct {        /* bit stream writer type */
+    uint8_t *buff;      /* byte data */
+    int pos;            /* next byte position */
+    int nbit;           /* number of pending bits in accumulator */
+    uint64_t acc;       /* bit accumulator */
+} bitw_con;
+
+static void bitw_init(bitw_con *w, uint8_t *buff, int pos)
+{
+    w->buff=buff;
+    w->pos=pos/8;
+    w->nbit=pos%8;
+    w->acc=w->nbit?buff[w->pos]>>(8-w->nbit):0;
+}
+static void bitw_put(bitw_con *w, uint32_t data, int len)
+{
+    w->acc=(w->acc<<len)|(data&(((uint64_t)1<<len)-1));
+    w->nbit+=len;
+    while (w->nbit>=8) {
+        w->nbit-=8;
+        w->buff[w->pos++]=(uint8_t)(w->acc>>w->nbit);
+    }
+}
+static int bitw_end(bitw_con *w)
+{
+    if (w->nbit) w->buff[w->pos]=(uint8_t)(w->acc<<(8-w->nbit));
+    return w->pos*8+w->nbit;
+}
+static void bitw_copy(bitw_con *w, const uint8_t *buff, int pos, int len)
+{
+    int n;
+
+    for (;len>0;pos+=n,len-=n) {
+        n=len<32?len:32;
+        bitw_put(w,getbitu(buff,pos,n),n);
+    }
+}
+
 /* satellite system+prn/slot number to satellite number ------------------------
 * convert satellite system+prn/slot number to satellite number
 * args   : int    sys       I   satellite system (SYS_GPS,SYS_GLO,...)
@@ -722,27 +1258,15 @@ static int to_sigid(int sys, uint8_t code)
     }
     return 0;
 }
-/* m_gnss_frq_idx[0] */
 
 /* GPS obs code to frequency -------------------------------------------------*/
 static int code2freq_GPS(uint8_t code, double *freq,int *ord)
 {
-    int idx[NFREQ];
-    for (int i= 0;i<NFREQ;i++){
-        idx[i] = 2;
-        idx[i] = NFREQ;
-    }
-    for (int i=0;i<m_gnss_frq_num[0];i++){
-        idx[m_gnss_frq_idx[0][i]-1] =i;
-    }
-//    idx[m_gnss_frq_idx[0][0]-1] =0;
-//    idx[m_gnss_frq_idx[0][1]-1] =1;
-
     char *obs=code2obs(code);
     switch (obs[0]) {
-        case '1': *freq=FREQ1; *ord=0; return idx[0]; /* L1 */
-        case '2': *freq=FREQ2; *ord=1; return idx[1]; /* L2 */
-        case '5': *freq=FREQ5; *ord=2; return idx[2]; /* L5 */
+        case '1': *freq=FREQ1; *ord=0; return 0; /* L1 */
+        case '2': *freq=FREQ2; *ord=1; return 1; /* L2 */
+        case '5': *freq=FREQ5; *ord=2; return 2; /* L5 */
     }
     return -1;
 }
@@ -750,29 +1274,16 @@ static int code2freq_GPS(uint8_t code, double *freq,int *ord)
 /* GLONASS obs code to frequency ---------------------------------------------*/
 static int code2freq_GLO(uint8_t code, int fcn, double *freq,int *ord)
 {
-    int idx[NFREQ];
-    for (int i= 0;i<NFREQ;i++){
-        idx[i] = 4;
-        idx[i] = NFREQ;
-    }
-    for (int i=0;i<m_gnss_frq_num[1];i++){
-        idx[m_gnss_frq_idx[1][i]-1] =i;
-    }
-//    idx[m_gnss_frq_idx[1][0]-1] =0;
-//    idx[m_gnss_frq_idx[1][1]-1] =1;
-//    idx[m_gnss_frq_idx[1][2]-1] =2;
-//    idx[m_gnss_frq_idx[1][3]-1] =3;
-
     char *obs=code2obs(code);
 
     if (fcn<-7||fcn>6) return -1;
 
     switch (obs[0]) {
-        case '1': *freq=FREQ1_GLO+DFRQ1_GLO*fcn; *ord=0; return idx[0]; /* G1 */
-        case '2': *freq=FREQ2_GLO+DFRQ2_GLO*fcn; *ord=1; return idx[1]; /* G2 */
-        case '3': *freq=FREQ3_GLO;               *ord=2; return idx[2]; /* G3 */
-        case '4': *freq=FREQ1a_GLO;              *ord=3; return idx[3]; /* G1a */
-        case '6': *freq=FREQ2a_GLO;              *ord=4; return idx[4]; /* G2a */
+        case '1': *freq=FREQ1_GLO+DFRQ1_GLO*fcn; *ord=0; return 0; /* G1 */
+        case '2': *freq=FREQ2_GLO+DFRQ2_GLO*fcn; *ord=1; return 1; /* G2 */
+        case '3': *freq=FREQ3_GLO;               *ord=2; return 2; /* G3 */
+        case '4': *freq=FREQ1a_GLO;              *ord=3; return 3; /* G1a */
+        case '6': *freq=FREQ2a_GLO;              *ord=4; return 4; /* G2a */
     }
     return -1;
 }
@@ -780,26 +1291,13 @@ static int code2freq_GLO(uint8_t code, int fcn, double *freq,int *ord)
 /* Galileo obs code to frequency ---------------------------------------------*/
 static int code2freq_GAL(uint8_t code, double *freq,int *ord)
 {
-    int idx[NFREQ];
-    for (int i= 0;i<NFREQ;i++){
-        idx[i] = 4;
-        idx[i] = NFREQ;
-    }
-    for (int i=0;i<m_gnss_frq_num[2];i++){
-        idx[m_gnss_frq_idx[2][i]-1] =i;
-    }
-//    idx[m_gnss_frq_idx[2][0]-1] =0;
-//    idx[m_gnss_frq_idx[2][1]-1] =1;
-//    idx[m_gnss_frq_idx[2][2]-1] =2;
-//    idx[m_gnss_frq_idx[2][3]-1] =3;
-
     char *obs=code2obs(code);
     switch (obs[0]) {
-        case '1': *freq=FREQ1; *ord=0; return idx[0]; /* E1 */
-        case '7': *freq=FREQ7; *ord=1; return idx[1]; /* E5b */
-        case '5': *freq=FREQ5; *ord=2; return idx[2]; /* E5a */
-        case '6': *freq=FREQ6; *ord=3; return idx[3]; /* E6 */
-        case '8': *freq=FREQ8; *ord=4; return idx[4]; /* E5ab */
+        case '1': *freq=FREQ1; *ord=0; return 0; /* E1 */
+        case '7': *freq=FREQ7; *ord=1; return 1; /* E5b */
+        case '5': *freq=FREQ5; *ord=2; return 2; /* E5a */
+        case '6': *freq=FREQ6; *ord=3; return 3; /* E6 */
+        case '8': *freq=FREQ8; *ord=4; return 4; /* E5ab */
     }
     return -1;
 }
@@ -807,25 +1305,13 @@ static int code2freq_GAL(uint8_t code, double *freq,int *ord)
 /* QZSS obs code to frequency ------------------------------------------------*/
 static int code2freq_QZS(uint8_t code, double *freq,int *ord)
 {
-    int idx[NFREQ];
-    for (int i= 0;i<NFREQ;i++){
-        idx[i] = 3;
-        idx[i] = NFREQ;
-    }
-    for (int i=0;i<m_gnss_frq_num[3];i++){
-        idx[m_gnss_frq_idx[3][i]-1] =i;
-    }
-//    idx[m_gnss_frq_idx[3][0]-1] =0;
-//    idx[m_gnss_frq_idx[3][1]-1] =1;
-//    idx[m_gnss_frq_idx[3][2]-1] =2;
-
     char *obs=code2obs(code);
 
     switch (obs[0]) {
-        case '1': *freq=FREQ1; *ord=0; return idx[0]; /* L1 */
-        case '2': *freq=FREQ2; *ord=1; return idx[1]; /* L2 */
-        case '5': *freq=FREQ5; *ord=2; return idx[2]; /* L5 */
-        case '6': *freq=FREQ6; *ord=3; return idx[3]; /* L6 */
+        case '1': *freq=FREQ1; *ord=0; return 0; /* L1 */
+        case '2': *freq=FREQ2; *ord=1; return 1; /* L2 */
+        case '5': *freq=FREQ5; *ord=2; return 2; /* L5 */
+        case '6': *freq=FREQ6; *ord=3; return 3; /* L6 */
     }
     return -1;
 }
@@ -833,56 +1319,31 @@ static int code2freq_QZS(uint8_t code, double *freq,int *ord)
 /* SBAS obs code to frequency ------------------------------------------------*/
 static int code2freq_SBS(uint8_t code, double *freq,int *ord)
 {
-    int idx[NFREQ];
-    for (int i= 0;i<NFREQ;i++){
-        idx[i] = 2;
-        idx[i] = NFREQ;
-    }
-    for (int i=0;i<m_gnss_frq_num[4];i++){
-        idx[m_gnss_frq_idx[4][i]-1] =i;
-    }
-//    idx[m_gnss_frq_idx[4][0]-1] =0;
-//    idx[m_gnss_frq_idx[4][1]-1] =1;
-
     char *obs=code2obs(code);
 
     switch (obs[0]) {
-        case '1': *freq=FREQ1; *ord=0; return idx[0]; /* L1 */
-        case '5': *freq=FREQ5; *ord=1; return idx[1]; /* L5 */
+        case '1': *freq=FREQ1; *ord=0; return 0; /* L1 */
+        case '5': *freq=FREQ5; *ord=1; return 1; /* L5 */
     }
     return -1;
 }
 
 static int code2freq_BDS(uint8_t code, double *freq,int *ord)
 {
-    int idx[NFREQ];
-    for (int i= 0;i<NFREQ;i++){
-        idx[i] = 6;
-        idx[i] = NFREQ;
-    }
-    for (int i=0;i<m_gnss_frq_num[5];i++){
-        idx[m_gnss_frq_idx[5][i]-1] =i;
-    }
-//    idx[m_gnss_frq_idx[5][0]-1] =0;
-//    idx[m_gnss_frq_idx[5][1]-1] =1;
-//    idx[m_gnss_frq_idx[5][2]-1] =2;
-//    idx[m_gnss_frq_idx[5][3]-1] =3;
-//    idx[m_gnss_frq_idx[5][4]-1] =4;
-//    idx[m_gnss_frq_idx[5][5]-1] =5;
     char *obs=code2obs(code);
 
     switch (obs[0]) {
-        case '2': *freq=FREQ1_CMP; *ord=0; return idx[0]; /* B1I */
-        case '6': *freq=FREQ3_CMP; *ord=1; return idx[1]; /* B3 */
-        case '5': *freq=FREQ5;     *ord=2; return idx[2]; /* B2a */
-        case '1': *freq=FREQ1;     *ord=3; return idx[3]; /* B1C */
-        case '8': *freq=FREQ8;     *ord=4; return idx[4]; /* B2ab */
+        case '2': *freq=FREQ1_CMP; *ord=0; return 0; /* B1I */
+        case '6': *freq=FREQ3_CMP; *ord=1; return 1; /* B3 */
+        case '5': *freq=FREQ5;     *ord=2; return 2; /* B2a */
+        case '1': *freq=FREQ1;     *ord=3; return 3; /* B1C */
+        case '8': *freq=FREQ8;     *ord=4; return 4; /* B2ab */
         case '7': {
             if (obs[1]=='I'||obs[1]=='Q'||obs[1]=='X'){
-                *freq=FREQ2_CMP; *ord=5; return idx[5]; /* B2I*/
+                *freq=FREQ2_CMP; *ord=5; return 5; /* B2I*/
             }
             else {
-                *freq=FREQ2_CMP; *ord=6; return idx[6]; /* B2b */
+                *freq=FREQ2_CMP; *ord=6; return 6; /* B2b */
             }
         }
     }
@@ -893,17 +1354,6 @@ static int code2freq_BDS(uint8_t code, double *freq,int *ord)
 static int code2freq_IRN(uint8_t code, double *freq,int *ord)
 {
 
-    int idx[NFREQ];
-    for (int i= 0;i<NFREQ;i++){
-        idx[i] = 2;
-        idx[i] = NFREQ;
-    }
-    for (int i=0;i<m_gnss_frq_num[6];i++){
-        idx[m_gnss_frq_idx[6][i]-1] =i;
-    }
-//    idx[m_gnss_frq_idx[6][0]-1] =0;
-//    idx[m_gnss_frq_idx[6][1]-1] =1;
-
     char *obs=code2obs(code);
 
     switch (obs[0]) {
@@ -936,7 +1386,25 @@ static double code2freq(int sys, uint8_t code, int fcn)
     }
     return freq;
 }
-static int code2idx(int sys, uint8_t code)
+
+static int systbl(int sys){
+    int ord=0;
+
+    switch (sys) {
+        case SYS_GPS: ord=0;break;
+        case SYS_GLO: ord=1;break;
+        case SYS_GAL: ord=2;break;
+        case SYS_QZS: ord=3;break;
+        case SYS_SBS: ord=4;break;
+        case SYS_CMP: ord=5;break;
+        case SYS_IRN: ord=6;break;
+    }
+    return ord;
+
+}
+
+/* system and obs code to frequency order ----------------------------------*/
+static int code2ord(int sys, uint8_t code)
 {
     double freq;
     int ord;
@@ -953,20 +1421,86 @@ static int code2idx(int sys, uint8_t code)
     return -1;
 }
 
-static int systbl(int sys){
+/* system and obs code to frequency selection index --------------------------
+* args   : rtcmprof_t *prof  I   frequency selection profile
+*          int    sys       I   satellite system (SYS_???)
+*          uint8_t code     I   obs code (CODE_???)
+* return : selection index (NFREQ:not selected,-1:unknown code)
+*-----------------------------------------------------------------------------*/
+static int code2idx(const rtcmprof_t *prof, int sys, uint8_t code)
+{
     int ord;
 
-    switch (sys) {
-        case SYS_GPS: ord=0;break;
-        case SYS_GLO: ord=1;break;
-        case SYS_GAL: ord=2;break;
-        case SYS_QZS: ord=3;break;
-        case SYS_SBS: ord=4;break;
-        case SYS_CMP: ord=5;break;
-        case SYS_IRN: ord=6;break;
-    }
-    return ord;
+    if ((ord=code2ord(sys,code))<0) return -1;
+    return prof->idx[systbl(sys)][ord];
+}
+
+/* compile signal selection by obs codes ---------------------------------------
+* args   : rtcmprof_t *prof  O   frequency selection profile
+*          char  *sel        I   signal selection ("G:1C,2W;E:1X,5X",...)
+* return : status (1:ok,0:error)
+* notes  : system letters are G,R,E,J,S,C,I. a code is a rinex 3 obs code
+*          with or without type ("1C" or "C1C"). signals with the listed
+*          codes are kept as they are, without priority among codes of a
+*          frequency. systems not in sel are not output
+*-----------------------------------------------------------------------------*/
+static int setcodesel(rtcmprof_t *prof, const char *sel)
+{
+    const char *p=sel;
+    char str[4];
+    uint8_t code;
+    int i,n,s,sys,ord;
+
+    for (i=0;i<7;i++) setfrqpri(prof,i,NULL);
+
+    while (*p) {
+        while (*p==' '||*p==';') p++;
+        if (!*p) break;
+
+        switch (*p) {
+            case 'G': sys=SYS_GPS; break;
+            case 'R': sys=SYS_GLO; break;
+            case 'E': sys=SYS_GAL; break;
+            case 'J': sys=SYS_QZS; break;
+            case 'S': sys=SYS_SBS; break;
+            case 'C': sys=SYS_CMP; break;
+            case 'I': sys=SYS_IRN; break;
+            default : trace(2,"setcodesel: system error: %s\n",p); return 0;
+        }
+        if (*++p!=':') {
+            trace(2,"setcodesel: syntax error: %s\n",sel);
+            return 0;
+        }
+        s=systbl(sys);
+        prof->bycode[s]=1;
+
+        for (p++;*p&&*p!=';';p+=*p==','?1:0) {
+            while (*p==' ') p++;
+            if (!*p||*p==';') break;
+            for (n=0;p[n]&&p[n]!=','&&p[n]!=';'&&p[n]!=' ';n++) ;
+            if (n==3&&strchr("CLDS",*p)) { /* strip obs type */
+                p++; n--;
+            }
+            if (n!=2) {
+                trace(2,"setcodesel: code error: %s\n",p);
+                return 0;
+            }
+            str[0]=p[0]; str[1]=p[1]; str[2]='\0';
+            p+=2;
+            while (*p==' ') p++;
+
+            if ((code=obs2code(str))==CODE_NONE||!to_sigid(sys,code)||
+                (ord=code2ord(sys,code))<0) {
+                trace(2,"setcodesel: code error: sys=%d %s\n",sys,str);
+                return 0;
+            }
+            prof->code[s][code]=1;
 
+            /* frequency order of observation data */
+            if (prof->idx[s][ord]==NFREQ) prof->idx[s][ord]=prof->num[s]++;
+        }
+    }
+    return 1;
 }
 
 static int codeidxtbl(int sys, uint8_t code){
@@ -1022,18 +1556,22 @@ static int getcodepri(int sys, uint8_t code, const char *opt)
     return (p=strchr(codepris[i][j],obs[1]))?14-(int)(p-codepris[i][j]):0;
 }
 
-/* get signal index ----------------------------------------------------------*/
+/* get signal index ------------------------------------------------------------
+* notes  : signals of selected frequencies not of the highest priority (ex=1)
+*          are put in the extended slots before signals of frequencies not
+*          selected (ex=2), so selected codes are not lost by signal ids
+*-----------------------------------------------------------------------------*/
 static void sigindex(int sys, const uint8_t *code, int n, const char *opt,
                      int *idx)
 {
-    int i,nex,pri,pri_h[8]={0},index[8]={0},ex[32]={0};
+    int i,k,nex,pri,pri_h[8]={0},index[8]={0},ex[32]={0};
 
     /* test code priority */
     for (i=0;i<n;i++) {
-        if (!code[i]) continue;
+        if (!code[i]||idx[i]<0) continue; /* unknown code or frequency */
 
         if (idx[i]>=NFREQ) { /* save as extended signal if idx >= NFREQ */
-            ex[i]=1;
+            ex[i]=2;
             continue;
         }
         /* code priority */
@@ -1048,11 +1586,11 @@ static void sigindex(int sys, const uint8_t *code, int n, const char *opt,
         else ex[i]=1;
     }
     /* signal index in obs data */
-    for (i=nex=0;i<n;i++) {
-        if (ex[i]==0) ;
+    for (k=1,nex=0;k<=2;k++) for (i=0;i<n;i++) {
+        if (ex[i]!=k) ;
         else if (nex<NEXOBS) idx[i]=NFREQ+nex++;
         else { /* no space in obs data */
-            trace(1,"rtcm msm: no space in obs data sys=%d code=%d\n",sys,code[i]);
+            trace(2,"rtcm msm: no space in obs data sys=%d code=%d\n",sys,code[i]);
             idx[i]=-1;
         }
 #if 0 /* for debug */
@@ -1091,19 +1629,20 @@ static int decode_msm_head(rtcm_con *rtcm, int sys, int *sync, int *iod,
     msm_h_con h0={0};
     double tow,tod;
     char *msg,tstr[64];
-    int i=24,j,dow,mask,staid,type,ncell=0;
+    uint32_t mask;
+    int i=24,j,k,n,dow,staid,type,ncell=0;
     int temp;
 
     type=getbitu(rtcm->buff,i,12); i+=12;
     //i+=12;
 
     *h=h0;
-    if (i+157<=rtcm->len*8) {
+    if (i+157<=(rtcm->len-3)*8) {
         i+=12;
         i+=30;
         *sync     =getbitu(rtcm->buff,i, 1);       i+= 1;
         if (*sync==0){
-            trace(1,"sync!\n");
+            trace(4,"sync!\n");
             temp=i;
         }
         i+= 3;
@@ -1139,36 +1678,44 @@ static int decode_msm_head(rtcm_con *rtcm, int sys, int *sync, int *iod,
 //        h->clk_ext=getbitu(rtcm->buff,i, 2);       i+= 2;
 //        h->smooth =getbitu(rtcm->buff,i, 1);       i+= 1;
 //        h->tint_s =getbitu(rtcm->buff,i, 3);       i+= 3;
-        for (j=1;j<=64;j++) {
-            mask=getbitu(rtcm->buff,i,1); i+=1;
-            if (mask) h->sats[h->nsat++]=j;
+        mask=getbitu(rtcm->buff,i,32); i+=32;
+        for (j=1;mask;j++,mask<<=1) {
+            if (mask&0x80000000u) h->sats[h->nsat++]=j;
         }
-        for (j=1;j<=32;j++) {
-            mask=getbitu(rtcm->buff,i,1); i+=1;
-            if (mask) h->sigs[h->nsig++]=j;
+        mask=getbitu(rtcm->buff,i,32); i+=32;
+        for (j=33;mask;j++,mask<<=1) {
+            if (mask&0x80000000u) h->sats[h->nsat++]=j;
+        }
+        mask=getbitu(rtcm->buff,i,32); i+=32;
+        for (j=1;mask;j++,mask<<=1) {
+            if (mask&0x80000000u) h->sigs[h->nsig++]=j;
         }
     }
     else {
-        trace(1,"rtcm3 %d length error: len=%d\n",type,rtcm->len);
+        trace(2,"rtcm3 %d length error: len=%d\n",type,rtcm->len);
         return -1;
     }
 //    /* test station id */
 //    if (!test_staid(rtcm,staid)) return -1;
 
     if (h->nsat*h->nsig>64) {
-        trace(1,"rtcm3 %d number of sats and sigs error: nsat=%d nsig=%d\n",
+        trace(2,"rtcm3 %d number of sats and sigs error: nsat=%d nsig=%d\n",
               type,h->nsat,h->nsig);
         return -1;
     }
-    if (i+h->nsat*h->nsig>rtcm->len*8) {
-        trace(1,"rtcm3 %d length error: len=%d nsat=%d nsig=%d\n",type,
+    if (i+h->nsat*h->nsig>(rtcm->len-3)*8) {
+        trace(2,"rtcm3 %d length error: len=%d nsat=%d nsig=%d\n",type,
               rtcm->len,h->nsat,h->nsig);
         return -1;
     }
-    for (j=0;j<h->nsat*h->nsig;j++) {
-        h->cellmask[j]=getbitu(rtcm->buff,i,1); i+=1;
-        if (h->cellmask[j]) ncell++;
+    for (j=0;j<h->nsat*h->nsig;j+=n) { /* cell mask by 32 bits */
+        n=h->nsat*h->nsig-j<32?h->nsat*h->nsig-j:32;
+        mask=getbitu(rtcm->buff,i,n)<<(32-n); i+=n;
+        for (k=j;mask;k++,mask<<=1) {
+            if (mask&0x80000000u) h->cellmask|=(uint64_t)1<<k;
+        }
     }
+    ncell=popcnt64(h->cellmask);
     *hsize=i;
 
 //    time2str(rtcm->time,tstr,2);
@@ -1183,15 +1730,80 @@ static int decode_msm_head(rtcm_con *rtcm, int sys, int *sync, int *iod,
     return ncell;
 }
 
-/* loss-of-lock indicator ----------------------------------------------------*/
-static int lossoflock(rtcm_con *rtcm, int sat, int idx, int lock)
+/* GLONASS frequency channel number -------------------------------------------
+* get GLONASS fcn of satellite from the fcn cache of the stream (MSM5/7
+* extended satellite info or 1020 ephemeris), or from the default table
+* args   : rtcm_con *rtcm   I   rtcm control struct
+*          int    prn       I   slot number
+* return : fcn (-7 to +6, -8: no data)
+*-----------------------------------------------------------------------------*/
+static int glo_fcnget(const rtcm_con *rtcm, int prn)
+{
+    if (prn<1||prn>32) return -8;
+    if (rtcm->glo_fcn[prn-1]) return rtcm->glo_fcn[prn-1]-8;
+    return glo_fcn[prn-1];
+}
+
+/* update GLONASS fcn cache --------------------------------------------------*/
+static void glo_fcnset(rtcm_con *rtcm, int prn, int fcn)
+{
+    if (prn<1||prn>32||fcn<-7||fcn>6) return;
+
+    if (rtcm->glo_fcn[prn-1]!=fcn+8) {
+        trace(3,"glo_fcnset: prn=%2d fcn=%d\n",prn,fcn);
+        rtcm->glo_fcn[prn-1]=(uint8_t)(fcn+8);
+    }
+}
+
+/* MSM satellite ID to satellite number -------------------------------------*/
+static int msm_satno(int sys, int id)
+{
+    if      (sys==SYS_QZS) id+=MINPRNQZS-1;
+    else if (sys==SYS_SBS) id+=MINPRNSBS-1;
+    return satno(sys,id);
+}
+
+/* loss-of-lock indicator -----------------------------------------------------
+* args   : rtcm_con *rtcm   IO  rtcm control struct
+*          int    sat       I   satellite number
+*          int    sig       I   msm signal id (1-32)
+*          int    lock      I   lock time indicator
+* return : loss-of-lock (1:loss of lock or cycle-slip,0:continuous)
+*-----------------------------------------------------------------------------*/
+static int lossoflock(rtcm_con *rtcm, int sat, int sig, int lock)
 {
-//    int lli=(!lock&&!rtcm->lock[sat-1][idx])||lock<rtcm->lock[sat-1][idx];
-//    rtcm->lock[sat-1][idx]=(uint32_t)lock;
-    int lli=!lock;
+    int lli=(!lock&&!rtcm->lock[sat-1][sig-1])||lock<rtcm->lock[sat-1][sig-1];
+    rtcm->lock[sat-1][sig-1]=(uint16_t)lock;
     return lli;
 }
 
+/* update lock state of MSM cells ----------------------------------------------
+* update lock table with lock time indicators of all cells in the message and
+* set loss-of-lock flags of the cells. called for every message so that lock
+* history is kept across epochs even if observations are not requested
+*-----------------------------------------------------------------------------*/
+static void msm_lockupd(rtcm_con *rtcm)
+{
+    msm_cell_con *c=&rtcm->cell;
+    uint64_t mask;
+    int i,k,n,sat,nsig=c->h.nsig;
+
+    c->slip=0;
+
+    for (i=0;i<c->h.nsat;i++) {
+        mask=(c->h.cellmask>>(i*nsig))&(((uint64_t)1<<nsig)-1);
+        if (!mask||!(sat=msm_satno(c->sys,c->h.sats[i]))) continue;
+
+        for (;mask;mask&=mask-1) {
+            k=ctz64(mask);
+            n=i*nsig+k;
+            if (lossoflock(rtcm,sat,c->h.sigs[k],c->lock[n])) {
+                c->slip|=(uint64_t)1<<n;
+            }
+        }
+    }
+}
+
 
 /* save obs data in MSM message ----------------------------------------------*/
 static void save_msm_obs(rtcm_con *rtcm, int sys, msm_h_con *h, const double *r,
@@ -1231,7 +1843,11 @@ static void save_msm_obs(rtcm_con *rtcm, int sys, msm_h_con *h, const double *r,
         }
         /* signal to rinex obs type */
         code[i]=obs2code(sig[i]);
-        idx[i]=code2idx(sys,code[i]);
+        idx[i]=code2idx(rtcm->prof,sys,code[i]);
+
+        /* codes not selected after selected codes of same frequency */
+        if (idx[i]>=0&&rtcm->prof->bycode[systbl(sys)]&&
+            !rtcm->prof->code[systbl(sys)][code[i]]) idx[i]=NFREQ;
 
         if (code[i]!=CODE_NONE) {
             if (q) q+=sprintf(q,"L%s%s",sig[i],i<h->nsig-1?",":"");
@@ -1239,7 +1855,7 @@ static void save_msm_obs(rtcm_con *rtcm, int sys, msm_h_con *h, const double *r,
         else {
             if (q) q+=sprintf(q,"(%d)%s",h->sigs[i],i<h->nsig-1?",":"");
 
-            trace(1,"rtcm3 %d: unknown signal id=%2d\n",type,h->sigs[i]);
+            trace(2,"rtcm3 %d: unknown signal id=%2d\n",type,h->sigs[i]);
         }
     }
     trace(3,"rtcm3 %d: signals=%s\n",type,msm_type);
@@ -1267,8 +1883,7 @@ static void save_msm_obs(rtcm_con *rtcm, int sys, msm_h_con *h, const double *r,
         }
         fcn=0;
         if (sys==SYS_GLO) {
-            fcn=-8; /* no glonass fcn info */
-            fcn = glo_fcn[prn-1]; //change
+            fcn=glo_fcnget(rtcm,prn); /* -8: no glonass fcn info */
 //            if (ex&&ex[i]<=13) {
 //                fcn=ex[i]-7;
 //                if (!rtcm->nav.glo_fcn[prn-1]) {
@@ -1283,7 +1898,7 @@ static void save_msm_obs(rtcm_con *rtcm, int sys, msm_h_con *h, const double *r,
 //            }
         }
         for (k=0;k<h->nsig;k++) {
-            if (!h->cellmask[k+i*h->nsig]) continue;
+            if (!((h->cellmask>>(k+i*h->nsig))&1)) continue;
 
             if (sat&&index>=0&&idx[k]>=0) {
                 freq=fcn<-7?0.0:code2freq(sys,code[k],fcn);
@@ -1298,12 +1913,12 @@ static void save_msm_obs(rtcm_con *rtcm, int sys, msm_h_con *h, const double *r,
                     rtcm->obs.data[index].L[idx[k]]=(r[i]+cp[j])*freq/CLIGHT;
                 }
                 /* doppler (hz) */
-                if (rr&&rrf&&rrf[j]>-1E12) {
+                if (rr&&rrf&&rr[i]>-1E12&&rrf[j]>-1E12) {
                     rtcm->obs.data[index].D[idx[k]]=
                         (float)(-(rr[i]+rrf[j])*freq/CLIGHT);
                 }
                 rtcm->obs.data[index].LLI[idx[k]]=
-                    lossoflock(rtcm,sat,idx[k],lock[j])+(half[j]?3:0);
+                    (int)((rtcm->cell.slip>>(k+i*h->nsig))&1)+(half[j]?3:0);
                 rtcm->obs.data[index].SNR [idx[k]]=(uint32_t)(cnr[j]/SNR_UNIT+0.5);
                 rtcm->obs.data[index].code[idx[k]]=code[k];
                 rtcm->obs.data[index].locktime[idx[k]]=lock[j];
@@ -1314,258 +1929,504 @@ static void save_msm_obs(rtcm_con *rtcm, int sys, msm_h_con *h, const double *r,
 }
 
 
-/* decode MSM 4: full pseudorange and phaserange plus CNR --------------------*/
-static int decode_msm4(rtcm_con *rtcm, int sys)
+/* decode MSM message ------------------------------------------------------------
+* decode raw msm 4-7 fields to msm cell store
+* args   : rtcm_con *rtcm   IO  rtcm control struct
+*          int    sys       I   satellite system
+*          int    msm       I   msm type (4-7)
+* return : status (-1:error,1:ok)
+* notes  : called with constant msm by decode_msm4-7, so the field widths are
+*          constants in each of them
+*-----------------------------------------------------------------------------*/
+static int decode_msm(rtcm_con *rtcm, int sys, int msm)
 {
-    msm_h_con h={0};
-    double r[64],pr[64],cp[64],cnr[64];
-    int i,j,type,sync,iod,ncell,rng,rng_m,prv,cpv,lock[64],half[64];
+    msm_cell_con *c=&rtcm->cell;
+    const int ext=msm==5||msm==7,hr=msm>=6;
+    const int wpr=hr?20:15,wcp=hr?24:22,wlk=hr?10:4,wcn=hr?10:6;
+    uint8_t pos[64];
+    int i,j,type,sync,iod,ncell;
 
     type=getbitu(rtcm->buff,24,12);
 
 //    /* decode msm header */
-    if ((ncell=decode_msm_head(rtcm,sys,&sync,&iod,&h,&i))<0) return -1;
+    if (rtcm->hcell>=0) { /* msm header decoded on input */
+        ncell=rtcm->hcell;
+        i=rtcm->hsize;
+    }
+    else if ((ncell=decode_msm_head(rtcm,sys,&sync,&iod,&c->h,&i))<0) return -1;
 
-    if (i+h.nsat*18+ncell*48>rtcm->len*8) {
-        trace(1,"rtcm3 %d length error: nsat=%d ncell=%d len=%d\n",type,h.nsat,
+    if (i+c->h.nsat*(ext?36:18)+ncell*(wpr+wcp+wlk+1+wcn+(ext?15:0))>(rtcm->len-3)*8) {
+        trace(2,"rtcm3 %d length error: nsat=%d ncell=%d len=%d\n",type,c->h.nsat,
               ncell,rtcm->len);
         return -1;
     }
-    for (j=0;j<h.nsat;j++) r[j]=0.0;
-    for (j=0;j<ncell;j++) pr[j]=cp[j]=-1E16;
+    c->half=0;
+
+    /* cell position in satellite x signal grid */
+    for (j=ncell=0;j<c->h.nsat*c->h.nsig;j++) {
+        if ((c->h.cellmask>>j)&1) pos[ncell++]=(uint8_t)j;
+    }
+    c->sys=sys;
+    c->msm=msm;
+    c->ncell=ncell;
 
     /* decode satellite data */
-    for (j=0;j<h.nsat;j++) { /* range */
-        rng  =getbitu(rtcm->buff,i, 8); i+= 8;
-        if (rng!=255) r[j]=rng*RANGE_MS;
+    for (j=0;j<c->h.nsat;j++) { /* range */
+        c->rng  [j]=(uint8_t )getbitu(rtcm->buff,i, 8); i+= 8;
     }
-    for (j=0;j<h.nsat;j++) {
-        rng_m=getbitu(rtcm->buff,i,10); i+=10;
-        if (r[j]!=0.0) r[j]+=rng_m*P2_10*RANGE_MS;
+    if (ext) for (j=0;j<c->h.nsat;j++) { /* extended info */
+        c->ex   [j]=(uint8_t )getbitu(rtcm->buff,i, 4); i+= 4;
+    }
+    for (j=0;j<c->h.nsat;j++) {
+        c->rng_m[j]=(uint16_t)getbitu(rtcm->buff,i,10); i+=10;
+    }
+    if (ext) for (j=0;j<c->h.nsat;j++) { /* phaserange rate */
+        c->rate [j]=(int16_t )getbits(rtcm->buff,i,14); i+=14;
     }
     /* decode signal data */
     for (j=0;j<ncell;j++) { /* pseudorange */
-        prv=getbits(rtcm->buff,i,15); i+=15;
-        if (prv!=-16384) pr[j]=prv*P2_24*RANGE_MS;
+        c->prv [pos[j]]=getbits(rtcm->buff,i,wpr); i+=wpr;
     }
     for (j=0;j<ncell;j++) { /* phaserange */
-        cpv=getbits(rtcm->buff,i,22); i+=22;
-        if (cpv!=-2097152) cp[j]=cpv*P2_29*RANGE_MS;
+        c->cpv [pos[j]]=getbits(rtcm->buff,i,wcp); i+=wcp;
     }
     for (j=0;j<ncell;j++) { /* lock time */
-        lock[j]=getbitu(rtcm->buff,i,4); i+=4;
+        c->lock[pos[j]]=(uint16_t)getbitu(rtcm->buff,i,wlk); i+=wlk;
     }
     for (j=0;j<ncell;j++) { /* half-cycle ambiguity */
-        half[j]=getbitu(rtcm->buff,i,1); i+=1;
+        c->half|=(uint64_t)getbitu(rtcm->buff,i,1)<<pos[j]; i+=1;
     }
     for (j=0;j<ncell;j++) { /* cnr */
-        cnr[j]=getbitu(rtcm->buff,i,6)*1.0; i+=6;
+        c->cnr [pos[j]]=(uint16_t)getbitu(rtcm->buff,i,wcn); i+=wcn;
+    }
+    if (ext) for (j=0;j<ncell;j++) { /* phaserange rate */
+        c->rrv [pos[j]]=(int16_t)getbits(rtcm->buff,i,15); i+=15;
+    }
+    rtcm->ncell[0]=ncell;
+
+    /* glonass fcn in extended satellite info */
+    if (ext&&sys==SYS_GLO) {
+        for (j=0;j<c->h.nsat;j++) {
+            if (c->ex[j]<=13) glo_fcnset(rtcm,c->h.sats[j],c->ex[j]-7);
+        }
     }
-//    /* save obs data in msm message */
-    save_msm_obs(rtcm,sys,&h,r,pr,cp,NULL,NULL,cnr,lock,NULL,half);
+    /* loss-of-lock against previous epoch */
+    msm_lockupd(rtcm);
 
 //    rtcm->obsflag=!sync;
 //    return sync?0:1;
     return 1;
 }
-
-
-
-
-
-static void free_rtcm(rtcm_con *rtcm){
-    if(rtcm->obs.data!=NULL){
-        trace(2,"free rtcm obs\n");
-        free(rtcm->obs.data); rtcm->obs.data=NULL; rtcm->obs.n=0;
-    }
+/* decode MSM 4: full pseudorange and phaserange plus CNR --------------------*/
+static int decode_msm4(rtcm_con *rtcm, int sys)
+{
+    return decode_msm(rtcm,sys,4);
 }
-static int init_rtcm(rtcm_con *rtcm){
-    int i;
-    obsd_con data0={{0}};
-    rtcm->len=0;//rtcm->nbyte=rtcm->nbit=rtcm->len=0;
-    rtcm->lensd=0;
-    rtcm->obs.data=NULL;
-    if (!(rtcm->obs.data=(obsd_con *)malloc(sizeof(obsd_con)*MAXOBS))) {
-        trace(1,"init_rtcm: obs or nav malloc fail\n");
-        free_rtcm(rtcm);
-        return 0;
+/* decode MSM 5: full pseudorange, phaserange, phaserangerate and CNR --------*/
+static int decode_msm5(rtcm_con *rtcm, int sys)
+{
+    return decode_msm(rtcm,sys,5);
+}
+/* decode MSM 6: full pseudorange and phaserange plus CNR (high-res) ---------*/
+static int decode_msm6(rtcm_con *rtcm, int sys)
+{
+    return decode_msm(rtcm,sys,6);
+}
+/* decode MSM 7: full pseudorange, phaserange, phaserangerate and CNR (h-res) */
+static int decode_msm7(rtcm_con *rtcm, int sys)
+{
+    return decode_msm(rtcm,sys,7);
+}
+
+/* decode type 1020: GLONASS ephemerides (fcn only) --------------------------*/
+static int decode_type1020(rtcm_con *rtcm)
+{
+    int i=24+12,prn,fcn;
+
+    if (i+11>(rtcm->len-3)*8) {
+        trace(2,"rtcm3 1020 length error: len=%d\n",rtcm->len);
+        return -1;
     }
-    rtcm->obs.n=0;
-    rtcm->nbit=0;
-    memset(rtcm->buffsd,0,1200*sizeof(uint8_t));
-//    int lenobs=malloc_usable_size(rtcm->obs.data);
-//    int conlen=sizeof(obsd_con);
-//    trace(1,"obs len: %d\n",lenobs);
+    prn=getbitu(rtcm->buff,i, 6);   i+= 6;
+    fcn=getbitu(rtcm->buff,i, 5)-7; i+= 5;
 
+    glo_fcnset(rtcm,prn,fcn);
+    return 0;
+}
 
-    for (i=0;i<MAXOBS   ;i++) rtcm->obs.data[i]=data0;
-    return 1;
+/* satellite system of SSR message type ----------------------------------------
+* args   : int    type      I   message type
+*          int    *msg      O   ssr message (SSR_???)
+* return : satellite system (SYS_NONE: not ssr)
+*-----------------------------------------------------------------------------*/
+static int ssrsys(int type, int *msg)
+{
+    static const int sys[]={SYS_GAL,SYS_QZS,SYS_SBS,SYS_CMP};
+    static const int sysp[]={SYS_GPS,SYS_GLO,SYS_GAL,SYS_QZS,SYS_SBS,SYS_CMP};
+
+    if (1057<=type&&type<=1068) { /* gps, glonass */
+        *msg=(type-1057)%6;
+        return type<=1062?SYS_GPS:SYS_GLO;
+    }
+    if (1240<=type&&type<=1263) { /* galileo, qzss, sbas, bds */
+        *msg=(type-1240)%6;
+        return sys[(type-1240)/6];
+    }
+    if (1265<=type&&type<=1270) { /* phase bias */
+        *msg=SSR_PBIAS;
+        return sysp[type-1265];
+    }
+    return SYS_NONE;
+}
+
+/* SSR signal id to obs code -------------------------------------------------*/
+static uint8_t ssr_code(int sys, int id)
+{
+    switch (sys) {
+        case SYS_GPS: return ssr_sig_gps[id];
+        case SYS_GLO: return ssr_sig_glo[id];
+        case SYS_GAL: return ssr_sig_gal[id];
+        case SYS_QZS: return ssr_sig_qzs[id];
+        case SYS_SBS: return ssr_sig_sbs[id];
+        case SYS_CMP: return ssr_sig_cmp[id];
+    }
+    return CODE_NONE;
 }
 
+/* SSR bias of signal selected by profile --------------------------------------
+* notes  : biases of all codes on a selected frequency are kept, since the
+*          rover may track any of them
+*-----------------------------------------------------------------------------*/
+static int ssr_sel(const rtcm_con *rtcm, int sys, uint8_t code)
+{
+    const rtcmprof_t *prof=rtcm->prof;
+    int s=systbl(sys),idx;
+
+    if (code==CODE_NONE) return 0;
+    if (prof->bycode[s]) return prof->code[s][code];
+    return (idx=code2idx(prof,sys,code))>=0&&idx<prof->num[s];
+}
 
-/* generate MSM satellite, signal and cell index -----------------------------*/
-static void gen_msm_index(rtcm_con *rtcm, int sys, int *nsat, int *nsig,
-                          int *ncell, uint8_t *sat_ind, uint8_t *sig_ind,
-                          uint8_t *cell_ind)
+/* decode SSR message for signal filtering -------------------------------------
+* decode the satellites and biases of ssr code and phase bias messages and keep
+* the biases of the signals selected by the profile to rtcm->ssr. satellites
+* without kept biases are dropped, and so are messages without kept biases
+* followed by another message of the epoch (multiple message bit)
+* args   : rtcm_con *rtcm   IO  rtcm control struct
+*          int    type      I   message type
+* return : status (-1:error,0:system not selected,1:ok)
+* notes  : orbit, clock, ura and high-rate clock messages have no signals and
+*          are kept as they are if the system is selected
+*-----------------------------------------------------------------------------*/
+static int decode_ssr(rtcm_con *rtcm, int type)
 {
-    int i,j,sat,sig,cell,sys_idx;
+    ssr_con *r=&rtcm->ssr;
+    int i,j,k,sys,nsat,nbias,nbit=(rtcm->len-3)*8;
 
-    *nsat=*nsig=*ncell=0;
+    sys=ssrsys(type,&r->msg);
+    r->nsat=r->nbias=0;
 
-    /* generate satellite and signal index */
-    for (i=0;i<rtcm->obs.n;i++) {
-        if (!(sat=to_satid(sys,rtcm->obs.data[i].sat))) continue;
-        sys_idx = systbl(sys);
+    if (rtcm->prof->num[systbl(sys)]<=0) return 0; /* system not selected */
+    if (r->msg!=SSR_CBIAS&&r->msg!=SSR_PBIAS) return 1;
 
-        for (j=0;j<m_gnss_frq_num[sys_idx];j++) {  //change
-//        for (j=0;j<NFREQ+NEXOBS;j++) {
-            if (!(sig=to_sigid(sys,rtcm->obs.data[i].code[j]))) continue;
+    r->ns=sys==SYS_QZS?4:6;
+    r->np=sys==SYS_QZS?4:(sys==SYS_GLO?5:6);
+    r->nx=r->msg==SSR_PBIAS?17:0; /* yaw angle and yaw rate */
+    r->nb=r->msg==SSR_PBIAS?32:19;
+    r->hsize=24+12+(sys==SYS_GLO?17:20)+4+1+4+16+4+(r->msg==SSR_PBIAS?2:0);
 
-            sat_ind[sat-1]=sig_ind[sig-1]=1;
-        }
-    }
-    for (i=0;i<64;i++) {
-        if (sat_ind[i]) sat_ind[i]=++(*nsat);
+    if (r->hsize+r->ns>nbit) {
+        trace(2,"rtcm3 %d length error: len=%d\n",type,rtcm->len);
+        return -1;
     }
-    for (i=0;i<32;i++) {
-        if (sig_ind[i]) sig_ind[i]=++(*nsig);
+    nsat=getbitu(rtcm->buff,r->hsize,r->ns);
+
+    for (i=r->hsize+r->ns,j=0;j<nsat;j++) {
+        if (i+r->np+5+r->nx>nbit) {
+            trace(2,"rtcm3 %d length error: len=%d\n",type,rtcm->len);
+            return -1;
+        }
+        r->sat[r->nsat]=(uint16_t)i;
+        r->nbs[r->nsat]=0;
+        nbias=getbitu(rtcm->buff,i+r->np,5);
+        i+=r->np+5+r->nx;
+
+        for (k=0;k<nbias;k++,i+=r->nb) {
+            if (i+r->nb>nbit||r->nbias>=SSR_MAXBIAS) {
+                trace(2,"rtcm3 %d length error: len=%d\n",type,rtcm->len);
+                return -1;
+            }
+            if (!ssr_sel(rtcm,sys,ssr_code(sys,getbitu(rtcm->buff,i,5)))) continue;
+            r->bias[r->nbias++]=(uint16_t)i;
+            r->nbs[r->nsat]++;
+        }
+        if (r->nbs[r->nsat]>0) r->nsat++;
     }
-    /* generate cell index */
-    for (i=0;i<rtcm->obs.n;i++) {
-        if (!(sat=to_satid(sys,rtcm->obs.data[i].sat))) continue;
+    /* empty message dropped unless it ends the ssr epoch */
+    if (r->nsat==0&&getbitu(rtcm->buff,24+12+(sys==SYS_GLO?17:20)+4,1)) return 0;
+    return 1;
+}
 
-        for (j=0;j<m_gnss_frq_num[sys_idx];j++) {// change
-//        for (j=0;j<NFREQ+NEXOBS;j++) {
-            if (!(sig=to_sigid(sys,rtcm->obs.data[i].code[j]))) continue;
+/* carve scratch from epoch arena ----------------------------------------------
+* the arena buffer is allocated on first use and kept by the converter. blocks
+* are 16-byte aligned and released all at once by arena_reset()
+* args   : arena_con *a     IO  arena
+*          size_t size      I   block size (bytes)
+* return : block (NULL: error)
+*-----------------------------------------------------------------------------*/
+static void *arena_get(arena_con *a, size_t size)
+{
+    void *p;
 
-            cell=sig_ind[sig-1]-1+(sat_ind[sat-1]-1)*(*nsig);
-            cell_ind[cell]=1;
+    if (!a->buff) {
+        if (!(a->buff=(uint8_t *)malloc(ARENA_SIZE))) {
+            trace(1,"arena_get: malloc fail\n");
+            return NULL;
         }
+        a->size=ARENA_SIZE;
+        a->used=0;
     }
-    for (i=0;i<*nsat*(*nsig);i++) {
-        if (cell_ind[i]&&*ncell<64) cell_ind[i]=++(*ncell);
+    size=(size+15)&~(size_t)15;
+    if (a->used+size>a->size) {
+        trace(1,"arena_get: overflow size=%d used=%d\n",(int)size,(int)a->used);
+        return NULL;
     }
+    p=a->buff+a->used;
+    a->used+=size;
+    return p;
 }
-
-/* GLONASS frequency channel number in RTCM (FCN+7,-1:error) -----------------*/
-static int fcn_glo(int sat, rtcm_con *rtcm)
+/* release all scratch of epoch arena -----------------------------------------*/
+static void arena_reset(arena_con *a)
 {
-    int prn;
-
-    if (satsys(sat,&prn)!=SYS_GLO) {
-        return -1;
+    a->used=0;
+}
+/* convert MSM cells to observation data in physical units ---------------------
+* the observation data and the scratch are carved from the epoch arena, so the
+* observation data stay valid until the next call
+*-----------------------------------------------------------------------------*/
+static int msm2obs(rtcm_con *rtcm)
+{
+    msm_cell_con *c=&rtcm->cell;
+    const int ext=c->msm==5||c->msm==7,hr=c->msm>=6;
+    const int npr=hr?-524288:-16384,ncp=hr?-8388608:-2097152;
+    const double spr=(hr?P2_29:P2_24)*RANGE_MS,scp=(hr?P2_31:P2_29)*RANGE_MS;
+    arena_con *a=&rtcm->arena;
+    double *r,*rr,*pr,*cp,*rrf,*cnr;
+    int i,j,*lock,*half;
+
+    arena_reset(a);
+    rtcm->obs.n=rtcm->obs.nmax=0;
+
+    if (!(rtcm->obs.data=(obsd_con *)arena_get(a,sizeof(obsd_con)*MAXOBS))||
+        !(r   =(double *)arena_get(a,sizeof(double)*64))||
+        !(rr  =(double *)arena_get(a,sizeof(double)*64))||
+        !(pr  =(double *)arena_get(a,sizeof(double)*64))||
+        !(cp  =(double *)arena_get(a,sizeof(double)*64))||
+        !(rrf =(double *)arena_get(a,sizeof(double)*64))||
+        !(cnr =(double *)arena_get(a,sizeof(double)*64))||
+        !(lock=(int    *)arena_get(a,sizeof(int   )*64))||
+        !(half=(int    *)arena_get(a,sizeof(int   )*64))) {
+        rtcm->obs.data=NULL;
+        return 0;
     }
+    rtcm->obs.nmax=MAXOBS;
 
-    if (glo_fcn[prn-1]>-8) { /* (-8: no data) */
-        return glo_fcn[prn-1]+7;
+    for (i=0;i<c->h.nsat;i++) {
+        r[i]=c->rng[i]==255?0.0:c->rng[i]*RANGE_MS+c->rng_m[i]*P2_10*RANGE_MS;
+        rr[i]=!ext||c->rate[i]==-8192?-1E16:c->rate[i]*1.0;
     }
-    return -1;
+    for (i=j=0;i<c->h.nsat*c->h.nsig;i++) {
+        if (!((c->h.cellmask>>i)&1)) continue;
+        pr  [j]=c->prv[i]==npr?-1E16:c->prv[i]*spr;
+        cp  [j]=c->cpv[i]==ncp?-1E16:c->cpv[i]*scp;
+        rrf [j]=!ext||c->rrv[i]==-16384?-1E16:c->rrv[i]*0.0001;
+        cnr [j]=c->cnr[i]*(hr?0.0625:1.0);
+        lock[j]=c->lock[i];
+        half[j]=(int)((c->half>>i)&1);
+        j++;
+    }
+    save_msm_obs(rtcm,c->sys,&c->h,r,pr,cp,ext?rr:NULL,ext?rrf:NULL,cnr,lock,
+                 NULL,half);
+    return rtcm->obs.n;
 }
 
-/* generate MSM satellite data fields ----------------------------------------*/
-static void gen_msm_sat(rtcm_con *rtcm, int sys, int nsat, const uint8_t *sat_ind,
-                        double *rrng, double *rrate, uint8_t *info)
-{
-    obsd_con *data;
-    double freq;
-    int i,j,k,sat,sig,fcn,sys_idx;
-
-    for (i=0;i<64;i++) rrng[i]=rrate[i]=0.0;
+static void free_rtcm(rtcm_con *rtcm){
+    if(rtcm->arena.buff!=NULL){
+        trace(2,"free rtcm arena\n");
+        free(rtcm->arena.buff); rtcm->arena.buff=NULL;
+    }
+    rtcm->obs.data=NULL; rtcm->obs.n=rtcm->obs.nmax=0;
+    free(rtcm->dlt); rtcm->dlt=NULL;
+    free(rtcm->rep); rtcm->rep=NULL;
+}
+static int init_rtcm(rtcm_con *rtcm){
+    msm_cell_con cell0={0};
+    int i;
+    pext64_init();
+    rtcm->len=0;//rtcm->nbyte=rtcm->nbit=rtcm->len=0;
+    rtcm->lensd=0;
+    rtcm->nbyte=rtcm->nneed=rtcm->skip=0;
+    rtcm->hcell=-1;
+    rtcm->hsize=0;
+    rtcm->ncell[0]=rtcm->ncell[1]=0;
+    rtcm->obs.data=NULL; /* carved from arena when observations are requested */
+    rtcm->obs.n=rtcm->obs.nmax=0;
+    rtcm->arena.buff=NULL;
+    rtcm->arena.size=rtcm->arena.used=0;
+    rtcm->cell=cell0;
+    memset(rtcm->glo_fcn,0,sizeof(rtcm->glo_fcn));
+    memset(rtcm->lock,0,sizeof(rtcm->lock));
+    for (i=0;i<7;i++) setfrqpri(&rtcm->frqp,i,NULL);
+    rtcm->prof=&rtcm->frqp;
+    memset(rtcm->selok,0,sizeof(rtcm->selok));
+    rtcm->tint=rtcm->toff=0;
+    rtcm->nosel=0;
+    rtcm->verify=0;
+    rtcm->dlt=NULL;
+    rtcm->rep=NULL;
+    rtcm->legacy=RTCMLEG_OFF;
+    memset(rtcm->legcp,0,sizeof(rtcm->legcp));
+    rtcm->nbit=0;
+    memset(rtcm->buffsd,0,1200*sizeof(uint8_t));
+//    int lenobs=malloc_usable_size(rtcm->obs.data);
+//    int conlen=sizeof(obsd_con);
+//    trace(1,"obs len: %d\n",lenobs);
 
-    for (i=0;i<rtcm->obs.n;i++) {
-        data=rtcm->obs.data+i;
-        fcn=fcn_glo(data->sat,rtcm); /* fcn+7 */
-        sys_idx = systbl(sys);
+    return 1;
+}
 
-        if (!(sat=to_satid(sys,data->sat))) continue;
 
-        for (j=0;j<m_gnss_frq_num[sys_idx];j++) {  //change
-//        for (j=0;j<NFREQ+NEXOBS;j++) {
-            if (!(sig=to_sigid(sys,data->code[j]))) continue;
-            k=sat_ind[sat-1]-1;
-            freq=code2freq(sys,data->code[j],fcn-7);
+/* MSM signal ID to signal string --------------------------------------------*/
+static const char *msm_sigstr(int sys, int id)
+{
+    switch (sys) {
+        case SYS_GPS: return msm_sig_gps[id-1];
+        case SYS_GLO: return msm_sig_glo[id-1];
+        case SYS_GAL: return msm_sig_gal[id-1];
+        case SYS_QZS: return msm_sig_qzs[id-1];
+        case SYS_SBS: return msm_sig_sbs[id-1];
+        case SYS_CMP: return msm_sig_cmp[id-1];
+        case SYS_IRN: return msm_sig_irn[id-1];
+    }
+    return "";
+}
 
-            /* rough range (ms) and rough phase-range-rate (m/s) */
-            if (rrng[k]==0.0&&data->P[j]!=0.0) {
-                rrng[k]=ROUND( data->P[j]/RANGE_MS/P2_10)*RANGE_MS*P2_10;
-            }
-            if (rrate[k]==0.0&&data->D[j]!=0.0&&freq>0.0) {
-                rrate[k]=ROUND(-data->D[j]*CLIGHT/freq)*1.0;
-            }
-            /* extended satellite info */
-            if (info) info[k]=sys!=SYS_GLO?0:(fcn<0?15:fcn);
+/* valid MSM satellite ids of system -------------------------------------------
+* return : satellite id mask (bit i: satellite id i+1 has satellite number)
+*-----------------------------------------------------------------------------*/
+static uint64_t msm_satmask(int sys)
+{
+    static uint64_t mask[8]; /* 0:not yet computed */
+    uint64_t m;
+    int i,s=systbl(sys);
+
+    if (s<0||s>=8) return 0;
+    if (!(m=STAT_GET(mask[s]))) {
+        for (i=0;i<64;i++) {
+            if (msm_satno(sys,i+1)) m|=(uint64_t)1<<i;
         }
+        STAT_SET(mask[s],m); /* converters of other threads store the same */
     }
+    return m;
 }
 
-/* generate MSM signal data fields -------------------------------------------*/
-static void gen_msm_sig(rtcm_con *rtcm, int sys, int nsat, int nsig, int ncell,
-                        const uint8_t *sat_ind, const uint8_t *sig_ind,
-                        const uint8_t *cell_ind, const double *rrng,
-                        const double *rrate, double *psrng, double *phrng,
-                        double *rate, double *lock, uint8_t *half, float *cnr)
+/* select signals of MSM message by frequency selection ----------------------
+* return : signal keep mask (bit k: signal k of message)
+* notes  : the selection is cached per system by signal mask of message and
+*          recomputed only if signals or frequency selection change
+*-----------------------------------------------------------------------------*/
+static uint32_t sel_msm_sig(rtcm_con *rtcm, int sys, const msm_h_con *h)
 {
-    obsd_con *data;
-    double freq,lambda,psrng_s,phrng_s,rate_s,lt;
-    int i,j,k,sat,sig,fcn,cell,LLI,sys_idx;
-
-    for (i=0;i<ncell;i++) {
-        if (psrng) psrng[i]=0.0;
-        if (phrng) phrng[i]=0.0;
-        if (rate ) rate [i]=0.0;
-    }
-    for (i=0;i<rtcm->obs.n;i++) {
-        data=rtcm->obs.data+i;
-        fcn=fcn_glo(data->sat,rtcm); /* fcn+7 */
-        sys_idx = systbl(sys);
+    uint8_t code[32]={0};
+    uint32_t keep=0,sigs=0;
+    int i,idx[32],s=systbl(sys),num=rtcm->prof->num[s];
 
-        if (!(sat=to_satid(sys,data->sat))) continue;
+    for (i=0;i<h->nsig;i++) sigs|=1u<<(h->sigs[i]-1);
 
-        for (j=0;j<m_gnss_frq_num[sys_idx];j++) {
-            if (!(sig=to_sigid(sys,data->code[j]))) continue;
+    if (rtcm->selok[s]&&rtcm->selsig[s]==sigs) return rtcm->selkeep[s];
 
-            k=sat_ind[sat-1]-1;
-            if ((cell=cell_ind[sig_ind[sig-1]-1+k*nsig])>=64) continue;
+    for (i=0;i<h->nsig;i++) {
+        code[i]=obs2code(msm_sigstr(sys,h->sigs[i]));
+        idx[i]=code2idx(rtcm->prof,sys,code[i]);
+    }
+    if (rtcm->prof->bycode[s]) { /* exact obs codes */
+        for (i=0;i<h->nsig;i++) {
+            if (rtcm->prof->code[s][code[i]]) keep|=1u<<i;
+        }
+    }
+    else {
+        /* one signal per selected frequency by code priority */
+        sigindex(sys,code,h->nsig,"",idx);
 
-            freq=code2freq(sys,data->code[j],fcn-7);
-            lambda=freq==0.0?0.0:CLIGHT/freq;
-            psrng_s=data->P[j]==0.0?0.0:data->P[j]-rrng[k];
-            phrng_s=data->L[j]==0.0||lambda<=0.0?0.0: data->L[j]*lambda-rrng [k];
-            rate_s =data->D[j]==0.0||lambda<=0.0?0.0:-data->D[j]*lambda-rrate[k];
+        for (i=0;i<h->nsig;i++) {
+            if (idx[i]>=0&&idx[i]<num) keep|=1u<<i;
+        }
+    }
+    rtcm->selok[s]=1;
+    rtcm->selsig[s]=sigs;
+    rtcm->selkeep[s]=keep;
+    return keep;
+}
 
-            /* subtract phase - psudorange integer cycle offset */
-            LLI=data->LLI[j];
-            if ((LLI&1)) {
-//            if ((LLI&1)||fabs(phrng_s-rtcm->cp[data->sat-1][j])>1171.0) { //change
-//                rtcm->cp[data->sat-1][j]=ROUND(phrng_s/lambda)*lambda;
-                LLI|=1;
-            }
-//            phrng_s-=rtcm->cp[data->sat-1][j];
+/* generate MSM satellite, signal and cell mask --------------------------------
+* args   : rtcm_con *rtcm   I   rtcm control struct (input msm cells)
+*          int    sys       I   satellite system
+*          uint64_t *satm   O   kept satellites  (bit i: satellite i of message)
+*          uint32_t *sigm   O   kept signals     (bit k: signal k of message)
+*          uint64_t *surv   O   surviving cells  (bit n: cell n of message)
+*          uint64_t *cellm  O   output cell mask (bit n: cell n of output)
+* return : number of output cells
+*-----------------------------------------------------------------------------*/
+static int gen_msm_index(rtcm_con *rtcm, int sys, uint64_t *satm, uint32_t *sigm,
+                         uint64_t *surv, uint64_t *cellm)
+{
+    const msm_cell_con *c=&rtcm->cell;
+    uint64_t grid=0,row,keep,sats;
+    int i,nsig=c->h.nsig;
 
-//            lt=locktime_d(data->time,rtcm->lltime[data->sat-1]+j,LLI);
+    *satm=*sigm=0;
 
-            if (psrng&&psrng_s!=0.0) psrng[cell-1]=psrng_s;
-            if (phrng&&phrng_s!=0.0) phrng[cell-1]=phrng_s;
-            if (rate &&rate_s !=0.0) rate [cell-1]=rate_s;
-            /*if (lock) lock[cell-1]=lt;*/// change ZRZ
-            if (lock) lock[cell-1]=data->locktime[j];
-            if (half) half[cell-1]=(data->LLI[j]&2)?1:0;
-            if (cnr ) cnr [cell-1]=(float)(data->SNR[j]*SNR_UNIT);
-        }
+    /* cells of valid satellites and selected signals */
+    if (rtcm->nosel) {
+        keep=((uint64_t)1<<nsig)-1;
+        sats=~(uint64_t)0;
+    }
+    else {
+        keep=sel_msm_sig(rtcm,sys,&c->h);
+        sats=msm_satmask(sys);
+    }
+    for (i=0;i<c->h.nsat;i++) {
+        if ((sats>>(c->h.sats[i]-1))&1) grid|=keep<<(i*nsig);
     }
+    *surv=c->h.cellmask&grid;
+
+    /* satellites and signals with surviving cells */
+    row=((uint64_t)1<<nsig)-1;
+    for (i=0;i<c->h.nsat;i++) {
+        if (!((*surv>>(i*nsig))&row)) continue;
+        *satm|=(uint64_t)1<<i;
+        *sigm|=(uint32_t)((*surv>>(i*nsig))&row);
+    }
+    /* compact surviving cells to output satellite x signal grid */
+    for (i=0,grid=0;i<c->h.nsat;i++) {
+        if ((*satm>>i)&1) grid|=(uint64_t)*sigm<<(i*nsig);
+    }
+    *cellm=pext64(*surv,grid);
+
+    return popcnt64(*surv);
 }
 
 /* encode MSM header ---------------------------------------------------------*/
 static int encode_msm_head(int type, rtcm_con *rtcm, int sys, int sync, int *nsat,
-                           int *ncell, double *rrng, double *rrate,
-                           uint8_t *info, double *psrng, double *phrng,
-                           double *rate, double *lock, uint8_t *half,
-                           float *cnr)
+                           int *ncell, uint64_t *satm, uint64_t *surv)
 {
+    const msm_cell_con *c=&rtcm->cell;
+    bitw_con w;
+    uint64_t cellm;
+    uint32_t sigm,sat_ind[2]={0},sig_ind=0;
     double tow;
-    uint8_t sat_ind[64]={0},sig_ind[32]={0},cell_ind[32*64]={0};
     uint32_t dow,epoch;
-    int i=24,j,nsig=0;
+    int i=24,j,nsig;
 
     switch (sys) {
         case SYS_GPS: type+=1070; break;
@@ -1577,8 +2438,10 @@ static int encode_msm_head(int type, rtcm_con *rtcm, int sys, int sync, int *nsa
         case SYS_IRN: type+=1130; break;
         default: return 0;
     }
-    /* generate msm satellite, signal and cell index */
-    gen_msm_index(rtcm,sys,nsat,&nsig,ncell,sat_ind,sig_ind,cell_ind);
+    /* generate msm satellite, signal and cell mask */
+    *ncell=gen_msm_index(rtcm,sys,satm,&sigm,surv,&cellm);
+    *nsat=popcnt64(*satm);
+    nsig=popcnt64(sigm);
 
 //    if (sys==SYS_GLO) {
 //        /* GLONASS time (dow + tod-ms) */
@@ -1619,111 +2482,98 @@ static int encode_msm_head(int type, rtcm_con *rtcm, int sys, int sync, int *nsa
     i+= 3;
     memcpy(rtcm->buffsd,rtcm->buff,13*sizeof(uint8_t));  // 24+12+12+30+1+3+7+2+2+1+3 =97
 
-    /* satellite mask */
-    for (j=0;j<64;j++) {
-        setbitu(rtcm->buffsd,i,1,sat_ind[j]?1:0); i+=1;
+    for (j=0;j<c->h.nsat;j++) {
+        if ((*satm>>j)&1) sat_ind[(c->h.sats[j]-1)/32]|=1u<<(31-(c->h.sats[j]-1)%32);
     }
-    /* signal mask */
-    for (j=0;j<32;j++) {
-        setbitu(rtcm->buffsd,i,1,sig_ind[j]?1:0); i+=1;
-    }
-    /* cell mask */
-    for (j=0;j<*nsat*nsig&&j<64;j++) {
-        setbitu(rtcm->buffsd,i,1,cell_ind[j]?1:0); i+=1;
+    for (j=0;j<c->h.nsig;j++) {
+        if ((sigm>>j)&1) sig_ind|=1u<<(32-c->h.sigs[j]);
     }
-    /* generate msm satellite data fields */
-    gen_msm_sat(rtcm,sys,*nsat,sat_ind,rrng,rrate,info);
+    bitw_init(&w,rtcm->buffsd,i);
+
+    /* satellite mask */
+    bitw_put(&w,sat_ind[0],32);
+    bitw_put(&w,sat_ind[1],32);
 
-    /* generate msm signal data fields */
-    gen_msm_sig(rtcm,sys,*nsat,nsig,*ncell,sat_ind,sig_ind,cell_ind,rrng,rrate,
-                psrng,phrng,rate,lock,half,cnr);
+    /* signal mask */
+    bitw_put(&w,sig_ind,32);
 
-    return i;
+    /* cell mask */
+    for (j=0;j<*nsat*nsig;j++) {
+        bitw_put(&w,(uint32_t)(cellm>>j)&1,1);
+    }
+    return bitw_end(&w);
 }
 
 /* encode rough range integer ms ---------------------------------------------*/
-static int encode_msm_int_rrng(rtcm_con *rtcm, int i, const double *rrng,
-                               int nsat)
+static int encode_msm_int_rrng(rtcm_con *rtcm, int i, const uint8_t *rng,
+                               uint64_t satm)
 {
-    uint32_t int_ms;
-    int j;
+    bitw_con w;
 
-    for (j=0;j<nsat;j++) {
-        if (rrng[j]==0.0) {
-            int_ms=255;
-        }
-        else if (rrng[j]<0.0||rrng[j]>RANGE_MS*255.0) {
-//            trace(2,"msm rough range overflow %s rrng=%.3f\n",
-//                 time_str(rtcm->time,0),rrng[j]);
-            int_ms=255;
-        }
-        else {
-            int_ms=ROUND_U(rrng[j]/RANGE_MS/P2_10)>>10;
-        }
-        setbitu(rtcm->buffsd,i,8,int_ms); i+=8;
+    bitw_init(&w,rtcm->buffsd,i);
+    for (;satm;satm&=satm-1) {
+        bitw_put(&w,rng[ctz64(satm)],8);
     }
-    return i;
+    return bitw_end(&w);
 }
+/* encode extended satellite info --------------------------------------------*/
+static int encode_msm_info(rtcm_con *rtcm, int i, const uint8_t *ex, uint64_t satm)
+{
+    bitw_con w;
 
+    bitw_init(&w,rtcm->buffsd,i);
+    for (;satm;satm&=satm-1) {
+        bitw_put(&w,ex[ctz64(satm)],4);
+    }
+    return bitw_end(&w);
+}
 /* encode rough range modulo 1 ms --------------------------------------------*/
-static int encode_msm_mod_rrng(rtcm_con *rtcm, int i, const double *rrng,
-                               int nsat)
+static int encode_msm_mod_rrng(rtcm_con *rtcm, int i, const uint16_t *rng_m,
+                               uint64_t satm)
 {
-    uint32_t mod_ms;
-    int j;
+    bitw_con w;
 
-    for (j=0;j<nsat;j++) {
-        if (rrng[j]<=0.0||rrng[j]>RANGE_MS*255.0) {
-            mod_ms=0;
-        }
-        else {
-            mod_ms=ROUND_U(rrng[j]/RANGE_MS/P2_10)&0x3FFu;
-        }
-        setbitu(rtcm->buffsd,i,10,mod_ms); i+=10;
+    bitw_init(&w,rtcm->buffsd,i);
+    for (;satm;satm&=satm-1) {
+        bitw_put(&w,rng_m[ctz64(satm)],10);
     }
-    return i;
+    return bitw_end(&w);
 }
-/* encode fine pseudorange ---------------------------------------------------*/
-static int encode_msm_psrng(rtcm_con *rtcm, int i, const double *psrng, int ncell)
+/* encode rough phase-range-rate ---------------------------------------------*/
+static int encode_msm_rrate(rtcm_con *rtcm, int i, const int16_t *rate,
+                            uint64_t satm)
 {
-    int j,psrng_val;
+    bitw_con w;
 
-    for (j=0;j<ncell;j++) {
-        if (psrng[j]==0.0) {
-            psrng_val=-16384;
-        }
-        else if (fabs(psrng[j])>292.7) {
-//            trace(2,"msm fine pseudorange overflow %s psrng=%.3f\n",
-//                 time_str(rtcm->time,0),psrng[j]);
-            psrng_val=-16384;
-        }
-        else {
-            psrng_val=ROUND(psrng[j]/RANGE_MS/P2_24);
-        }
-        setbits(rtcm->buffsd,i,15,psrng_val); i+=15;
+    bitw_init(&w,rtcm->buffsd,i);
+    for (;satm;satm&=satm-1) {
+        bitw_put(&w,(uint32_t)rate[ctz64(satm)],14);
     }
-    return i;
+    return bitw_end(&w);
 }
-/* encode fine phase-range ---------------------------------------------------*/
-static int encode_msm_phrng(rtcm_con *rtcm, int i, const double *phrng, int ncell)
+/* encode fine pseudorange (nbit: 15 or 20 (msm6,7)) -------------------------*/
+static int encode_msm_psrng(rtcm_con *rtcm, int i, const int32_t *prv, uint64_t surv,
+                            int nbit)
 {
-    int j,phrng_val;
+    bitw_con w;
 
-    for (j=0;j<ncell;j++) {
-        if (phrng[j]==0.0) {
-            phrng_val=-2097152;
-        }
-        else if (fabs(phrng[j])>1171.0) {
-//            trace(2,"msm fine phase-range overflow %s phrng=%.3f\n",
-//                 time_str(rtcm->time,0),phrng[j]);
-            phrng_val=-2097152;
-        }
-        else {
-            phrng_val=ROUND(phrng[j]/RANGE_MS/P2_29);
-        }
-        setbits(rtcm->buffsd,i,22,phrng_val); i+=22;
+    bitw_init(&w,rtcm->buffsd,i);
+    for (;surv;surv&=surv-1) {
+        bitw_put(&w,(uint32_t)prv[ctz64(surv)],nbit);
     }
-    return i;
+    return bitw_end(&w);
+}
+/* encode fine phase-range (nbit: 22 or 24 (msm6,7)) -------------------------*/
+static int encode_msm_phrng(rtcm_con *rtcm, int i, const int32_t *cpv, uint64_t surv,
+                            int nbit)
+{
+    bitw_con w;
+
+    bitw_init(&w,rtcm->buffsd,i);
+    for (;surv;surv&=surv-1) {
+        bitw_put(&w,(uint32_t)cpv[ctz64(surv)],nbit);
+    }
+    return bitw_end(&w);
 }
 
 /* MSM lock time indicator (ref [17] table 3.5-74) ---------------------------*/
@@ -1747,291 +2597,3853 @@ static int to_msm_lock(double lock)
     return 15;
 }
 
-/* encode lock-time indicator ------------------------------------------------*/
-static int encode_msm_lock(rtcm_con *rtcm, int i, const double *lock, int ncell)
+/* encode lock-time indicator (nbit: 4 or 10 (msm6,7)) ----------------------*/
+static int encode_msm_lock(rtcm_con *rtcm, int i, const uint16_t *lock, uint64_t surv,
+                           int nbit)
 {
-    int j,lock_val;
+    bitw_con w;
 
-    for (j=0;j<ncell;j++) {
+    bitw_init(&w,rtcm->buffsd,i);
+    for (;surv;surv&=surv-1) {
 //        lock_val=to_msm_lock(lock[j]);//change ZRZ
-        lock_val=lock[j];
-        setbitu(rtcm->buffsd,i,4,lock_val); i+=4;
+        bitw_put(&w,lock[ctz64(surv)],nbit);
     }
-    return i;
+    return bitw_end(&w);
 }
 
 /* encode half-cycle-ambiguity indicator -------------------------------------*/
-static int encode_msm_half_amb(rtcm_con *rtcm, int i, const uint8_t *half,
-                               int ncell)
+static int encode_msm_half_amb(rtcm_con *rtcm, int i, uint64_t half,
+                               uint64_t surv)
 {
-    int j;
+    bitw_con w;
+    int j,ncell=popcnt64(surv);
 
+    half=pext64(half,surv); /* gather indicators of surviving cells */
+
+    bitw_init(&w,rtcm->buffsd,i);
     for (j=0;j<ncell;j++) {
-        setbitu(rtcm->buffsd,i,1,half[j]); i+=1;
+        bitw_put(&w,(uint32_t)(half>>j)&1,1);
     }
-    return i;
+    return bitw_end(&w);
 }
 
-/* encode signal CNR ---------------------------------------------------------*/
-static int encode_msm_cnr(rtcm_con *rtcm, int i, const float *cnr, int ncell)
+/* encode signal CNR (nbit: 6 or 10 (msm6,7)) --------------------------------*/
+static int encode_msm_cnr(rtcm_con *rtcm, int i, const uint16_t *cnr, uint64_t surv,
+                          int nbit)
 {
-    int j,cnr_val;
+    bitw_con w;
 
-    for (j=0;j<ncell;j++) {
-        cnr_val=ROUND(cnr[j]/1.0);
-        setbitu(rtcm->buffsd,i,6,cnr_val); i+=6;
+    bitw_init(&w,rtcm->buffsd,i);
+    for (;surv;surv&=surv-1) {
+        bitw_put(&w,cnr[ctz64(surv)],nbit);
     }
-    return i;
+    return bitw_end(&w);
 }
+/* encode fine phase-range-rate ----------------------------------------------*/
+static int encode_msm_rate(rtcm_con *rtcm, int i, const int16_t *rrv, uint64_t surv)
+{
+    bitw_con w;
 
-/* encode MSM 4: full pseudorange and phaserange plus CNR --------------------*/
-static int encode_msm4(rtcm_con *rtcm, int sys, int sync)
+    bitw_init(&w,rtcm->buffsd,i);
+    for (;surv;surv&=surv-1) {
+        bitw_put(&w,(uint32_t)rrv[ctz64(surv)],15);
+    }
+    return bitw_end(&w);
+}
+
+/* encode MSM message ------------------------------------------------------------
+* encode kept cells of msm cell store in msm type of input message
+* args   : rtcm_con *rtcm   IO  rtcm control struct
+*          int    sys       I   satellite system
+*          int    sync      I   sync flag (1:another message follows)
+*          int    msm       I   msm type (4-7)
+* return : status (1:ok,0:error)
+*-----------------------------------------------------------------------------*/
+static int encode_msm(rtcm_con *rtcm, int sys, int sync, int msm)
 {
-    double rrng[64],rrate[64],psrng[64],phrng[64],lock[64];
-    float cnr[64];
-    uint8_t half[64];
+    const msm_cell_con *c=&rtcm->cell;
+    const int ext=msm==5||msm==7,hr=msm>=6;
+    uint64_t satm,surv;
     int i,nsat,ncell;
 
-    trace(3,"encode_msm4: sys=%d sync=%d\n",sys,sync);
+    trace(3,"encode_msm%d: sys=%d sync=%d\n",msm,sys,sync);
 
     /* encode msm header */
-    if (!(i=encode_msm_head(4,rtcm,sys,sync,&nsat,&ncell,rrng,rrate,NULL,psrng,
-                            phrng,NULL,lock,half,cnr))) {
+    if (!(i=encode_msm_head(msm,rtcm,sys,sync,&nsat,&ncell,&satm,&surv))) {
         return 0;
     }
     /* encode msm satellite data */
-    i=encode_msm_int_rrng(rtcm,i,rrng ,nsat ); /* rough range integer ms */
-    i=encode_msm_mod_rrng(rtcm,i,rrng ,nsat ); /* rough range modulo 1 ms */
-
+    i=encode_msm_int_rrng(rtcm,i,c->rng  ,satm); /* rough range integer ms */
+    if (ext) {
+        i=encode_msm_info(rtcm,i,c->ex   ,satm); /* extended satellite info */
+    }
+    i=encode_msm_mod_rrng(rtcm,i,c->rng_m,satm); /* rough range modulo 1 ms */
+    if (ext) {
+        i=encode_msm_rrate(rtcm,i,c->rate,satm); /* rough phase-range-rate */
+    }
     /* encode msm signal data */
-    i=encode_msm_psrng   (rtcm,i,psrng,ncell); /* fine pseudorange */
-    i=encode_msm_phrng   (rtcm,i,phrng,ncell); /* fine phase-range */
-    i=encode_msm_lock    (rtcm,i,lock ,ncell); /* lock-time indicator */
-    i=encode_msm_half_amb(rtcm,i,half ,ncell); /* half-cycle-amb indicator */
-    i=encode_msm_cnr     (rtcm,i,cnr  ,ncell); /* signal cnr */
+    i=encode_msm_psrng   (rtcm,i,c->prv  ,surv,hr?20:15); /* fine pseudorange */
+    i=encode_msm_phrng   (rtcm,i,c->cpv  ,surv,hr?24:22); /* fine phase-range */
+    i=encode_msm_lock    (rtcm,i,c->lock ,surv,hr?10: 4); /* lock-time indicator */
+    i=encode_msm_half_amb(rtcm,i,c->half ,surv);          /* half-cycle-amb indicator */
+    i=encode_msm_cnr     (rtcm,i,c->cnr  ,surv,hr?10: 6); /* signal cnr */
+    if (ext) {
+        i=encode_msm_rate(rtcm,i,c->rrv  ,surv);          /* fine phase-range-rate */
+    }
     rtcm->nbit=i;
+    rtcm->ncell[1]=ncell;
     return 1;
 }
+/* encode MSM 4: full pseudorange and phaserange plus CNR --------------------*/
+static int encode_msm4(rtcm_con *rtcm, int sys, int sync)
+{
+    return encode_msm(rtcm,sys,sync,4);
+}
+/* encode MSM 5: full pseudorange, phaserange, phaserangerate and CNR --------*/
+static int encode_msm5(rtcm_con *rtcm, int sys, int sync)
+{
+    return encode_msm(rtcm,sys,sync,5);
+}
+/* encode MSM 6: full pseudorange and phaserange plus CNR (high-res) ---------*/
+static int encode_msm6(rtcm_con *rtcm, int sys, int sync)
+{
+    return encode_msm(rtcm,sys,sync,6);
+}
+/* encode MSM 7: full pseudorange, phaserange, phaserangerate and CNR (h-res) */
+static int encode_msm7(rtcm_con *rtcm, int sys, int sync)
+{
+    return encode_msm(rtcm,sys,sync,7);
+}
 
-static int encode_rtcm3(rtcm_con *rtcm, int type, int sync){
-    int ret=0;
-
-    trace(3,"encode_rtcm3: type=%d subtype=%d sync=%d\n",type,sync);
-
+/* satellite system of converted legacy observation message type -------------*/
+static int legsys(int type)
+{
     switch (type) {
-        case 1074: ret=encode_msm4(rtcm,SYS_GPS,sync); break;
-        case 1084: ret=encode_msm4(rtcm,SYS_GLO,sync); break;
-        case 1094: ret=encode_msm4(rtcm,SYS_GAL,sync); break;
-        case 1104: ret=encode_msm4(rtcm,SYS_SBS,sync); break;
-        case 1114: ret=encode_msm4(rtcm,SYS_QZS,sync); break;
-        case 1124: ret=encode_msm4(rtcm,SYS_CMP,sync); break;
-        case 1134: ret=encode_msm4(rtcm,SYS_IRN,sync); break;
+        case 1002: case 1004: return SYS_GPS;
+        case 1010: case 1012: return SYS_GLO;
     }
+    return SYS_NONE;
 }
 
-static int decode_rtcm3(rtcm_con *rtcm)
+/* legacy lock time indicator to lock time (s) -------------------------------*/
+static int leg_locktime(int lock)
 {
-	//static resnum = 0;
-    double tow;
-    int ret=-1,type=getbitu(rtcm->buff,24,12),week;
-
-//    trace(3,"decode_rtcm3: len=%3d type=%d\n",rtcm->len,type);
+    if (lock< 24) return lock;
+    if (lock< 48) return lock*2-24;
+    if (lock< 72) return lock*4-120;
+    if (lock< 96) return lock*8-408;
+    if (lock<120) return lock*16-1176;
+    if (lock<127) return lock*32-3096;
+    return 937;
+}
 
-//    if (rtcm->outtype) {
-//        sprintf(rtcm->msgtype,"RTCM %4d (%4d):",type,rtcm->len);
-//    }
-    /* real-time input option */
-//    if (strstr(rtcm->opt,"-RT_INP")) {
-//        tow=time2gpst(utc2gpst(timeget()),&week);
-//        rtcm->time=gpst2time(week,floor(tow));
-//    }
-//    trace(3,"rtcm type:%d\n",type);
-	//trace(4, "resnmum: %d\n", resnum);
-    trace(2,"type : %d\n",type);
-	/*if (resnum > 86400 * 100) {
-		trace(1, "processure time test over!!!");
-		return -1;
-	}*/
-    switch (type) {
-		case 1074: ret = decode_msm4(rtcm, SYS_GPS); break;
-        case 1084: ret=decode_msm4(rtcm,SYS_GLO); break;
-        case 1094: ret=decode_msm4(rtcm,SYS_GAL); break;
-        case 1104: ret=decode_msm4(rtcm,SYS_SBS); break;
-        case 1114: ret=decode_msm4(rtcm,SYS_QZS); break;
-        case 1124: ret=decode_msm4(rtcm,SYS_CMP); break;
-        case 1134: ret=decode_msm4(rtcm,SYS_IRN); break;
+/* lock time (s) to legacy lock time indicator -------------------------------*/
+static int to_leg_lock(double lock)
+{
+    int t=(int)lock;
+
+    if (t<  0) return 0;
+    if (t< 24) return t;
+    if (t< 72) return (t+24  )/2;
+    if (t<168) return (t+120 )/4;
+    if (t<360) return (t+408 )/8;
+    if (t<744) return (t+1176)/16;
+    if (t<937) return (t+3096)/32;
+    return 127;
+}
 
-        default :  trace(1,"unsupposed type : %d\n",type); break;
-    }
-	
-//    if (ret>=0) {
-//        if      (1001<=type&&type<=1299) rtcm->nmsg3[type-1000]++; /*   1-299 */
-//        else if (4070<=type&&type<=4099) rtcm->nmsg3[type-3770]++; /* 300-329 */
-//        else rtcm->nmsg3[0]++; /* other */
-//    }
+/* MSM lock time indicator to lock time (s) (hr: msm6,7) ---------------------*/
+static double msm_locktime(int lock, int hr)
+{
+    int s;
 
-    return ret;
+    if (!hr) return lock?(1<<(lock+4))*1E-3:0.0;
+    if (lock<64) return lock*1E-3;
+    if (lock>704) lock=704;
+    s=(lock>>5)-1;
+    return ((double)(1<<(s+5))+(double)(1<<s)*(lock-32*(s+1)))*1E-3;
 }
 
-/* generate RTCM 3 message -----------------------------------------------------
-* generate RTCM 3 message
-* args   : rtcm_t *rtcm     IO  rtcm control struct
-*          int    type      I   message type
-*          int    subtype   I   message subtype
-*          int    sync      I   sync flag (1:another message follows)
-* return : status (1:ok,0:error)
-* notes  : For rtcm 3 msm, the {nsat} x {nsig} in rtcm->obs should not exceed
-*          64. If {nsat} x {nsig} of the input obs data exceeds 64, separate
-*          them to multiple ones and call gen_rtcm3() multiple times as user
-*          responsibility.
-*          ({nsat} = number of valid satellites, {nsig} = number of signals in
-*          the obs data)
+/* continuous legacy phaserange-pseudorange ------------------------------------
+* undo the roll by 1500 cycles of the legacy encoder against the last epoch
+* args   : rtcm_con *rtcm   IO  rtcm control struct
+*          int    sat       I   satellite number
+*          int    f         I   frequency (0:L1,1:L2)
+*          double ppr       I   phaserange-pseudorange (m)
+*          double lam       I   wavelength (m)
+* return : continuous phaserange-pseudorange (m)
 *-----------------------------------------------------------------------------*/
-static int gen_rtcm3(rtcm_con *rtcm, int type, int sync)
+static double leg_adjcp(rtcm_con *rtcm, int sat, int f, double ppr, double lam)
 {
-    uint32_t crc;
-    int i=0;
+    double *last=&rtcm->legcp[sat-1][f];
 
-    trace(4,"gen_rtcm3: type=%d sync=%d\n",type,sync);
+    if (*last!=0.0) {
+        if      (ppr<*last-750.0*lam) ppr+=1500.0*lam;
+        else if (ppr>*last+750.0*lam) ppr-=1500.0*lam;
+    }
+    return *last=ppr;
+}
 
-//    rtcm->nbit=rtcm->len=rtcm->nbyte=0;
-    rtcm->nbit=0;
-	rtcm->lensd = 0;
+/* legacy phaserange-pseudorange (0.0005 m,0x80000:invalid) ------------------
+* args   : double cp        I   carrier-phase (cycle) (0.0:no data)
+*          double pr        I   L1 pseudorange (m)
+*          double lam       I   wavelength of carrier-phase (m)
+* return : phaserange-pseudorange rolled within +-750 cycles
+*-----------------------------------------------------------------------------*/
+static uint32_t leg_ppr(double cp, double pr, double lam)
+{
+    double x;
 
-    /* set preamble and reserved */
-    setbitu(rtcm->buffsd,i, 8,RTCM3PREAMB); i+= 8;
-    setbitu(rtcm->buffsd,i, 6,0          ); i+= 6;
-    setbitu(rtcm->buffsd,i,10,0          ); i+=10;
+    if (cp==0.0) return 0x80000;
+    x=fmod(cp-pr/lam+750.0,1500.0);
+    if (x<0.0) x+=1500.0;
+    return (uint32_t)ROUND((x-750.0)*lam/0.0005);
+}
+
+/* legacy cnr (0.25 dBHz) ----------------------------------------------------*/
+static uint32_t leg_cnr(uint32_t snr)
+{
+    int cnr=ROUND(snr*SNR_UNIT/0.25);
+    return cnr<0?0:(cnr>255?255:cnr);
+}
+
+/* decode legacy observation message -------------------------------------------
+* decode gps 1002,1004 or glonass 1010,1012 to msm4 cells and write the msm4
+* header of the system to rtcm->buff, so the message is converted and output
+* as msm4 of the system by the msm encoder
+* args   : rtcm_con *rtcm   IO  rtcm control struct
+*          int    type      I   message type
+* return : status (-1:error,1:ok)
+* notes  : glonass msm4 epoch is put on unknown day of week (7). phaserange out
+*          of the msm4 fine phaserange field is set invalid
+*-----------------------------------------------------------------------------*/
+static int decode_legacy(rtcm_con *rtcm, int type)
+{
+    static const uint8_t L2codes[]={CODE_L2X,CODE_L2P,CODE_L2D,CODE_L2W};
+    msm_cell_con *c=&rtcm->cell;
+    const int sys=legsys(type),glo=sys==SYS_GLO,l2=type==1004||type==1012;
+    const int nb=glo?(l2?130:79):(l2?125:74);
+    const double unit=glo?PRUNIT_GLO:PRUNIT_GPS;
+    double P[32][2],L[32][2],freq,r,x;
+    uint8_t sig[32][2]={{0}},lock[32][2],cnr[32][2];
+    uint32_t sigs=0,staid,epoch,sync,smooth,nsat;
+    uint64_t sats=0;
+    int i=24+12,p,j,k,f,n,prn,fcn=0,sat,code,amb,pr21,ppr,rr,isig[32];
+
+    staid =getbitu(rtcm->buff,i,12);        i+=12;
+    epoch =getbitu(rtcm->buff,i,glo?27:30); i+=glo?27:30;
+    sync  =getbitu(rtcm->buff,i, 1);        i+= 1;
+    nsat  =getbitu(rtcm->buff,i, 5);        i+= 5;
+    smooth=getbitu(rtcm->buff,i, 4);        i+= 4; /* smoothing indicator/interval */
+
+    if (i+(int)nsat*nb>(rtcm->len-3)*8) {
+        trace(2,"rtcm3 %d length error: nsat=%d len=%d\n",type,nsat,rtcm->len);
+        return -1;
+    }
+    for (j=0;j<(int)nsat;j++,i=p+nb) {
+        p=i;
+        prn =getbitu(rtcm->buff,i, 6); i+= 6;
+        code=getbitu(rtcm->buff,i, 1); i+= 1;
+        if (glo) {
+            fcn=getbitu(rtcm->buff,i,5)-7; i+= 5;
+            glo_fcnset(rtcm,prn,fcn);
+        }
+        if (prn<1||prn>32||!(sat=satno(sys,prn))) {
+            trace(2,"rtcm3 %d satellite error: prn=%d\n",type,prn);
+            continue;
+        }
+        k=prn-1;
+        sats|=(uint64_t)1<<k;
+
+        /* L1 */
+        sig [k][0]=(uint8_t)to_sigid(sys,code?CODE_L1P:CODE_L1C);
+        freq=code2freq(sys,code?CODE_L1P:CODE_L1C,fcn);
+        P   [k][0]=getbitu(rtcm->buff,i,glo?25:24)*0.02; i+=glo?25:24;
+        ppr       =getbits(rtcm->buff,i,20);             i+=20;
+        lock[k][0]=(uint8_t)to_msm_lock(leg_locktime(getbitu(rtcm->buff,i,7))); i+=7;
+        amb       =getbitu(rtcm->buff,i,glo?7:8);        i+=glo?7:8;
+        cnr [k][0]=(uint8_t)((getbitu(rtcm->buff,i,8)+2)/4); i+=8;
+        P   [k][0]+=amb*unit;
+        L   [k][0]=ppr==-524288||freq<=0.0?0.0:
+                   P[k][0]+leg_adjcp(rtcm,sat,0,ppr*0.0005,CLIGHT/freq);
+        if (cnr[k][0]>63) cnr[k][0]=63;
+        sigs|=1u<<(sig[k][0]-1);
+        if (!l2) continue;
+
+        /* L2 */
+        code=getbitu(rtcm->buff,i,2); i+=2;
+        code=glo?(code?CODE_L2P:CODE_L2C):L2codes[code];
+        sig [k][1]=(uint8_t)to_sigid(sys,(uint8_t)code);
+        freq=code2freq(sys,(uint8_t)code,fcn);
+        pr21      =getbits(rtcm->buff,i,14);             i+=14;
+        ppr       =getbits(rtcm->buff,i,20);             i+=20;
+        lock[k][1]=(uint8_t)to_msm_lock(leg_locktime(getbitu(rtcm->buff,i,7))); i+=7;
+        cnr [k][1]=(uint8_t)((getbitu(rtcm->buff,i,8)+2)/4); i+=8;
+        P   [k][1]=pr21==-8192?0.0:P[k][0]+pr21*0.02;
+        L   [k][1]=ppr==-524288||freq<=0.0?0.0:
+                   P[k][0]+leg_adjcp(rtcm,sat,1,ppr*0.0005,CLIGHT/freq);
+        if (cnr[k][1]>63) cnr[k][1]=63;
+        if (P[k][1]==0.0&&L[k][1]==0.0) sig[k][1]=0;
+        else sigs|=1u<<(sig[k][1]-1);
+    }
+    /* msm header of satellites and signals */
+    c->h.nsat=c->h.nsig=0;
+    for (k=0;k<32;k++) {
+        if ((sats>>k)&1) c->h.sats[c->h.nsat++]=(uint8_t)(k+1);
+        if ((sigs>>k)&1) c->h.sigs[isig[k]=c->h.nsig++]=(uint8_t)(k+1);
+    }
+    if (c->h.nsat*c->h.nsig>64) {
+        trace(2,"rtcm3 %d cells error: nsat=%d nsig=%d\n",type,c->h.nsat,c->h.nsig);
+        return -1;
+    }
+    c->h.cellmask=c->half=0;
+
+    /* msm4 cells relative to rough range of L1 pseudorange */
+    for (j=n=0;j<c->h.nsat;j++) {
+        k=c->h.sats[j]-1;
+        rr=ROUND(P[k][0]/RANGE_MS*1024.0);
+        r=rr*P2_10;
+        c->rng  [j]=rr>>10>254?255:(uint8_t)(rr>>10);
+        c->rng_m[j]=(uint16_t)(rr&1023);
+
+        for (f=0;f<2;f++) {
+            if (!sig[k][f]) continue;
+            i=j*c->h.nsig+isig[sig[k][f]-1];
+            c->h.cellmask|=(uint64_t)1<<i;
+            x=P[k][f]==0.0?1E9:(P[k][f]/RANGE_MS-r)/P2_24;
+            c->prv [i]=fabs(x)>16383.0?-16384:ROUND(x);
+            x=L[k][f]==0.0?1E9:(L[k][f]/RANGE_MS-r)/P2_29;
+            c->cpv [i]=fabs(x)>2097151.0?-2097152:ROUND(x);
+            c->lock[i]=lock[k][f];
+            c->cnr [i]=cnr[k][f];
+            n++;
+        }
+    }
+    c->sys=sys;
+    c->msm=4;
+    c->ncell=n;
+    rtcm->ncell[0]=n;
+
+    /* loss-of-lock against previous epoch */
+    msm_lockupd(rtcm);
+
+    /* msm4 header (ref [15] table 3.5-78) for encoder and epoch of cells */
+    i=24;
+    setbitu(rtcm->buff,i,12,glo?1084:1074);           i+=12;
+    setbitu(rtcm->buff,i,12,staid);                   i+=12;
+    setbitu(rtcm->buff,i,30,glo?(7u<<27)|epoch:epoch); i+=30;
+    setbitu(rtcm->buff,i, 1,sync);                    i+= 1;
+    setbitu(rtcm->buff,i,14,0);                       i+=14; /* iods..ext clock */
+    setbitu(rtcm->buff,i, 4,smooth);
+    return 1;
+}
+
+/* encode legacy observation message -------------------------------------------
+* encode gps 1002,1004 or glonass 1010,1012 of the observation data of msm
+* cells (msm2obs()) of selected signals. the first selected L1 and L2 signal
+* of a satellite are encoded, satellites without L1 pseudorange are dropped
+* args   : rtcm_con *rtcm   IO  rtcm control struct
+*          int    type      I   message type
+*          int    sync      I   sync flag (1:another message follows)
+* return : status (1:ok,0:error)
+*-----------------------------------------------------------------------------*/
+static int encode_legacy(rtcm_con *rtcm, int type, int sync)
+{
+    const msm_cell_con *c=&rtcm->cell;
+    const int sys=legsys(type),glo=sys==SYS_GLO,l2=type==1004||type==1012;
+    const int hr=c->msm>=6;
+    const double unit=glo?PRUNIT_GLO:PRUNIT_GPS;
+    const obsd_con *d;
+    uint8_t sel[MAXCODE+1]={0},code;
+    uint32_t keep,epoch=getbitu(rtcm->buff,48,30);
+    bitw_con w;
+    double P1,lam;
+    int i,j,k,f,prn,fcn=0,amb,pr1,pr21,nsat=0,ncell=0,idx[32],jf[32][2];
+
+    trace(3,"encode_legacy: type=%d sync=%d\n",type,sync);
+
+    /* obs codes of selected signals */
+    keep=rtcm->nosel?0xFFFFFFFFu:sel_msm_sig(rtcm,sys,&c->h);
+    for (k=0;k<c->h.nsig;k++) {
+        if ((keep>>k)&1) sel[obs2code(msm_sigstr(sys,c->h.sigs[k]))]=1;
+    }
+    sel[CODE_NONE]=0;
+
+    /* satellites with L1 pseudorange */
+    msm2obs(rtcm);
+
+    for (i=0;i<rtcm->obs.n&&nsat<31;i++) {
+        d=rtcm->obs.data+i;
+        if (satsys(d->sat,&prn)!=sys||prn>32) continue;
+        if (glo&&glo_fcnget(rtcm,prn)<-7) continue; /* no fcn */
+
+        jf[nsat][0]=jf[nsat][1]=-1;
+        for (j=0;j<NFREQ+NEXOBS;j++) {
+            if (!sel[d->code[j]]||(f=code2ord(sys,d->code[j]))<0||f>1) continue;
+            if (jf[nsat][f]>=0||(d->P[j]==0.0&&(f==0||d->L[j]==0.0))) continue;
+            jf[nsat][f]=j;
+        }
+        if (jf[nsat][0]>=0) idx[nsat++]=i;
+    }
+    /* encode legacy header (ref [15] table 3.5-2,3.5-7) */
+    bitw_init(&w,rtcm->buffsd,24);
+    bitw_put(&w,type,12);
+    bitw_put(&w,getbitu(rtcm->buff,36,12),12);        /* station id */
+    bitw_put(&w,glo?epoch&0x7FFFFFF:epoch,glo?27:30); /* gps tow/glonass tod */
+    bitw_put(&w,sync,1);
+    bitw_put(&w,nsat,5);
+    bitw_put(&w,getbitu(rtcm->buff,93,4),4);          /* smoothing indicator/interval */
+
+    for (i=0;i<nsat;i++) {
+        d=rtcm->obs.data+idx[i];
+        satsys(d->sat,&prn);
+        if (glo) fcn=glo_fcnget(rtcm,prn);
+
+        /* L1 */
+        code=d->code[j=jf[i][0]];
+        amb=(int)floor(d->P[j]/unit);
+        pr1=ROUND((d->P[j]-amb*unit)/0.02);
+        P1=pr1*0.02+amb*unit; /* phaserange relative to encoded pseudorange */
+        lam=CLIGHT/code2freq(sys,code,fcn);
+        bitw_put(&w,prn,6);
+        bitw_put(&w,code==CODE_L1P||code==CODE_L1W,1);
+        if (glo) bitw_put(&w,fcn+7,5);
+        bitw_put(&w,pr1,glo?25:24);
+        bitw_put(&w,leg_ppr(d->L[j],P1,lam),20);
+        bitw_put(&w,to_leg_lock(msm_locktime(d->locktime[j],hr)),7);
+        bitw_put(&w,amb,glo?7:8);
+        bitw_put(&w,leg_cnr(d->SNR[j]),8);
+        ncell++;
+        if (!l2) continue;
+
+        /* L2 */
+        if ((j=jf[i][1])<0) {
+            bitw_put(&w,0,2);
+            bitw_put(&w,0x2000,14);
+            bitw_put(&w,0x80000,20);
+            bitw_put(&w,0,15);
+            continue;
+        }
+        code=d->code[j];
+        lam=CLIGHT/code2freq(sys,code,fcn);
+        pr21=d->P[j]==0.0?-8192:ROUND((d->P[j]-P1)/0.02);
+        bitw_put(&w,code==CODE_L2P?1:(!glo&&code==CODE_L2D?2:(!glo&&code==CODE_L2W?3:0)),2);
+        bitw_put(&w,(uint32_t)(pr21<-8191||pr21>8191?-8192:pr21),14);
+        bitw_put(&w,leg_ppr(d->L[j],P1,lam),20);
+        bitw_put(&w,to_leg_lock(msm_locktime(d->locktime[j],hr)),7);
+        bitw_put(&w,leg_cnr(d->SNR[j]),8);
+        ncell++;
+    }
+    rtcm->nbit=bitw_end(&w);
+    rtcm->ncell[1]=ncell;
+    return 1;
+}
+
+/* output message type of converted observation message ------------------------
+* args   : rtcm_con *rtcm   I   rtcm control struct (decoded msm cells)
+*          int    type      I   input message type
+* return : output message type
+*-----------------------------------------------------------------------------*/
+static int leg_otype(const rtcm_con *rtcm, int type)
+{
+    const int sys=rtcm->cell.sys;
+    int l2;
+
+    if (rtcm->legacy==RTCMLEG_MSM&&legsys(type)!=SYS_NONE) {
+        return sys==SYS_GLO?1084:1074;
+    }
+    if (rtcm->legacy!=RTCMLEG_OUT||(sys!=SYS_GPS&&sys!=SYS_GLO)) return type;
+
+    /* L2/G2 fields if L2/G2 is selected */
+    l2=rtcm->nosel||rtcm->prof->idx[systbl(sys)][1]<NFREQ;
+    return sys==SYS_GPS?(l2?1004:1002):(l2?1012:1010);
+}
+
+/* repeat suppression type index of message type (-1: not suppressed) -------*/
+static int rep_type(int type)
+{
+    static const int types[REP_NEPH+REP_NSTA]={
+        1019,1020,1041,1042,1044,1045,1046, /* ephemerides */
+        1005,1006,1007,1008,1033            /* station */
+    };
+    int i;
+
+    for (i=0;i<REP_NEPH+REP_NSTA;i++) {
+        if (types[i]==type) return i;
+    }
+    return -1;
+}
+/* repeat suppression key of message (ephemeris: by satellite) ---------------*/
+static int rep_key(const uint8_t *buff, int i)
+{
+    if (i>=REP_NEPH) return REP_NEPH*64+i-REP_NEPH;
+    return i*64+(int)getbitu(buff,36,i==4?4:6); /* qzss (1044) prn 4 bits */
+}
+/* advance stream time of repeat suppression -----------------------------------
+* the time only moves forward (within half a week), so messages of systems a
+* little behind in the stream do not move it back. messages forwarded before
+* the first msm epoch are taken as forwarded at that epoch
+*-----------------------------------------------------------------------------*/
+static void rep_time(rep_con *rep, int tow)
+{
+    int i,dt=((tow-rep->tow)%WEEK_MS+WEEK_MS)%WEEK_MS;
+
+    if (rep->tow<0) {
+        for (i=0;i<REP_NKEY;i++) if (rep->hash[i]) rep->tfwd[i]=tow;
+        rep->tow=tow;
+    }
+    else if (dt>0&&dt<WEEK_MS/2) rep->tow=tow;
+}
+/* check repeated ephemeris or station message ---------------------------------
+* args   : rep_con *rep     IO  repeated message suppression
+*          uint8_t *buff    I   message frame
+*          int    len       I   frame length (bytes)
+*          int    key       I   repeat suppression key
+* return : status (1:forward,0:suppress)
+* notes  : the content is compared by fnv-1a hash of the message without
+*          frame header and parity. before the first msm epoch the stream time
+*          is unknown, so copies of a forwarded message are suppressed until
+*          tint after that epoch
+*-----------------------------------------------------------------------------*/
+static int rep_check(rep_con *rep, const uint8_t *buff, int len, int key)
+{
+    uint32_t h=2166136261u;
+    int i;
+
+    for (i=3;i<len-3;i++) h=(h^buff[i])*16777619u;
+    if (!h) h=1;
+
+    if (rep->hash[key]==h&&(rep->tow<0||
+        ((rep->tow-rep->tfwd[key])%WEEK_MS+WEEK_MS)%WEEK_MS<rep->tint)) {
+        return 0;
+    }
+    rep->hash[key]=h;
+    rep->tfwd[key]=rep->tow;
+    return 1;
+}
+/* encode message as it is input ---------------------------------------------*/
+static int encode_copy(rtcm_con *rtcm)
+{
+    bitw_con w;
+
+    bitw_init(&w,rtcm->buffsd,24);
+    bitw_copy(&w,rtcm->buff,24,(rtcm->len-6)*8);
+    rtcm->nbit=bitw_end(&w);
+    return 1;
+}
+/* encode SSR message of kept satellites and biases --------------------------*/
+static int encode_ssr(rtcm_con *rtcm)
+{
+    const ssr_con *r=&rtcm->ssr;
+    bitw_con w;
+    int i,j,k=0;
+
+    trace(3,"encode_ssr: msg=%d nsat=%d nbias=%d\n",r->msg,r->nsat,r->nbias);
+
+    if (r->msg!=SSR_CBIAS&&r->msg!=SSR_PBIAS) return encode_copy(rtcm);
+
+    bitw_init(&w,rtcm->buffsd,24);
+    bitw_copy(&w,rtcm->buff,24,r->hsize-24); /* header */
+    bitw_put(&w,r->nsat,r->ns);
+
+    for (i=0;i<r->nsat;i++) {
+        bitw_copy(&w,rtcm->buff,r->sat[i],r->np); /* satellite id */
+        bitw_put(&w,r->nbs[i],5);
+        bitw_copy(&w,rtcm->buff,r->sat[i]+r->np+5,r->nx); /* yaw angle/rate */
+
+        for (j=0;j<r->nbs[i];j++) {
+            bitw_copy(&w,rtcm->buff,r->bias[k++],r->nb);
+        }
+    }
+    rtcm->nbit=bitw_end(&w);
+    return 1;
+}
+
+/* satellite system of MSM message type -------------------------------------*/
+static int msmsys(int type)
+{
+    switch (type/10) {
+        case 107: return SYS_GPS;
+        case 108: return SYS_GLO;
+        case 109: return SYS_GAL;
+        case 110: return SYS_SBS;
+        case 111: return SYS_QZS;
+        case 112: return SYS_CMP;
+        case 113: return SYS_IRN;
+    }
+    return SYS_NONE;
+}
+
+/* MSM decode/encode kernels by msm type (4-7) -------------------------------*/
+typedef struct {        /* MSM kernel type */
+    int (*decode)(rtcm_con *rtcm, int sys);
+    int (*encode)(rtcm_con *rtcm, int sys, int sync);
+} msm_kern_con;
+
+static const msm_kern_con msm_kern[4]={
+    {decode_msm4,encode_msm4},{decode_msm5,encode_msm5},
+    {decode_msm6,encode_msm6},{decode_msm7,encode_msm7}
+};
+
+/* get MSM kernel of message type (NULL: not msm 4-7) ------------------------*/
+static const msm_kern_con *msm_kernel(int type)
+{
+    if (type%10<4||type%10>7||msmsys(type)==SYS_NONE) return NULL;
+    return msm_kern+type%10-4;
+}
+
+static int encode_rtcm3(rtcm_con *rtcm, int type, int sync){
+    const msm_kern_con *kern;
+    int ret=0,msg;
+
+    trace(3,"encode_rtcm3: type=%d sync=%d\n",type,sync);
+
+    if ((kern=msm_kernel(type))) {
+        ret=kern->encode(rtcm,msmsys(type),sync);
+    }
+    else if (legsys(type)!=SYS_NONE) {
+        ret=encode_legacy(rtcm,type,sync);
+    }
+    else if (ssrsys(type,&msg)!=SYS_NONE) {
+        ret=encode_ssr(rtcm);
+    }
+    else if (rep_type(type)>=0) { /* repeat suppression */
+        ret=encode_copy(rtcm);
+    }
+    return ret;
+}
+
+static int decode_rtcm3(rtcm_con *rtcm)
+{
+    const msm_kern_con *kern;
+	//static resnum = 0;
+    double tow;
+    int ret=-1,type=getbitu(rtcm->buff,24,12),week,msg;
+
+//    trace(3,"decode_rtcm3: len=%3d type=%d\n",rtcm->len,type);
+
+//    if (rtcm->outtype) {
+//        sprintf(rtcm->msgtype,"RTCM %4d (%4d):",type,rtcm->len);
+//    }
+    /* real-time input option */
+//    if (strstr(rtcm->opt,"-RT_INP")) {
+//        tow=time2gpst(utc2gpst(timeget()),&week);
+//        rtcm->time=gpst2time(week,floor(tow));
+//    }
+//    trace(3,"rtcm type:%d\n",type);
+	//trace(4, "resnmum: %d\n", resnum);
+    trace(2,"type : %d\n",type);
+	/*if (resnum > 86400 * 100) {
+		trace(1, "processure time test over!!!");
+		return -1;
+	}*/
+    switch (type) {
+        case 1020: ret=decode_type1020(rtcm); break;
+
+        default :
+            if ((kern=msm_kernel(type))) { /* msm 4-7 */
+                ret=kern->decode(rtcm,msmsys(type));
+                break;
+            }
+            if (ssrsys(type,&msg)!=SYS_NONE) { /* ssr */
+                ret=decode_ssr(rtcm,type);
+                break;
+            }
+            if (rtcm->legacy&&legsys(type)!=SYS_NONE) { /* legacy observables */
+                ret=decode_legacy(rtcm,type);
+                break;
+            }
+            if (rtcm->rep&&rep_type(type)>=0) { /* repeat suppression */
+                ret=0;
+                break;
+            }
+            trace(3,"unsupposed type : %d\n",type);
+            ret=-2; /* not converted */
+            break;
+    }
+	
+//    if (ret>=0) {
+//        if      (1001<=type&&type<=1299) rtcm->nmsg3[type-1000]++; /*   1-299 */
+//        else if (4070<=type&&type<=4099) rtcm->nmsg3[type-3770]++; /* 300-329 */
+//        else rtcm->nmsg3[0]++; /* other */
+//    }
+
+    return ret;
+}
+
+/* message type converted or used by decode_rtcm3() -------------------------*/
+static int rtcm3_type_ok(const rtcm_con *rtcm, int type)
+{
+    int msg;
+
+    return type==1020||msm_kernel(type)!=NULL||ssrsys(type,&msg)!=SYS_NONE||
+           (rtcm->rep&&rep_type(type)>=0)||(rtcm->legacy&&legsys(type)!=SYS_NONE);
+}
+
+/* MSM epoch time to GPS time of week (ms) ----------------------------------
+* notes  : glonass epochs with unknown day of week (7) are put on day 0
+*-----------------------------------------------------------------------------*/
+static int msm_towms(int sys, uint32_t epoch)
+{
+    int tow;
+
+    switch (sys) {
+        case SYS_GLO: /* UTC(SU)+3h dow+tod */
+            tow=(int)(epoch>>27)%7*86400000+(int)(epoch&0x7FFFFFF)-10800000+
+                LEAPS*1000;
+            break;
+        case SYS_CMP: /* BDT tow */
+            tow=(int)epoch+14000; break;
+        default: /* GPST tow */
+            tow=(int)epoch; break;
+    }
+    return (tow%604800000+604800000)%604800000;
+}
+
+/* MSM epoch time to GPS time of day (ms) -----------------------------------*/
+static int msm_todms(int sys, uint32_t epoch)
+{
+    return msm_towms(sys,epoch)%86400000;
+}
+
+/* MSM message on epoch decimation grid ----------------------------------------
+* args   : rtcm_con *rtcm   I   rtcm control struct (rtcm->tint,toff)
+*          uint8_t *buff    I   rtcm frame (needs 10 bytes)
+* return : status (1:pass,0:drop)
+* notes  : only msm and converted legacy observation messages are decimated
+*-----------------------------------------------------------------------------*/
+static int msm_decim(const rtcm_con *rtcm, const uint8_t *buff)
+{
+    int type,tod;
+
+    if (rtcm->tint<=0) return 1;
+
+    type=getbitu(buff,24,12);
+    if (msm_kernel(type)) {
+        tod=msm_todms(msmsys(type),getbitu(buff,48,30));
+    }
+    else if (rtcm->legacy&&legsys(type)==SYS_GPS) { /* tow */
+        tod=msm_todms(SYS_GPS,getbitu(buff,48,30));
+    }
+    else if (rtcm->legacy&&legsys(type)==SYS_GLO) { /* tod */
+        tod=msm_todms(SYS_GLO,(7u<<27)|getbitu(buff,48,27));
+    }
+    else return 1;
+
+    return ((tod-rtcm->toff)%rtcm->tint+rtcm->tint)%rtcm->tint==0;
+}
+
+/* input RTCM 3 frame state ------------------------------------------------------
+* advance input state when rtcm->nneed bytes have been input to rtcm->buff
+* args   : rtcm_con *rtcm   IO  rtcm control struct
+* return : status (0:need more bytes,1:end of frame)
+* notes  : states by input bytes:
+*          3 : message length known, rtcm->len set to frame length
+*          6 : message type known. frame is skipped (not buffered) if the
+*              type is not supported
+*          25: msm epoch and satellite/signal mask known. frame is skipped
+*              if the epoch is not on decimation grid. size of cell mask
+*              computed
+*          hdr: msm header decoded to rtcm->cell.h, header errors skip frame
+*          len: end of frame
+*-----------------------------------------------------------------------------*/
+static int input_state(rtcm_con *rtcm)
+{
+    int i,type,sync,iod,nsat=0,nsig=0,len=rtcm->len;
+
+    if (rtcm->nbyte==len) return 1;
+
+    if (rtcm->nbyte==3) {
+        rtcm->len=len=(int)getbitu(rtcm->buff,14,10)+6;
+        rtcm->nneed=6;
+        return 0;
+    }
+    if (rtcm->nbyte==6) {
+        type=getbitu(rtcm->buff,24,12);
+        if (!rtcm3_type_ok(rtcm,type)) {
+            trace(3,"input_rtcm3: skip type=%d len=%d\n",type,len);
+            rtcm->skip=3;
+            rtcm->nneed=len;
+        }
+        else if (msm_kernel(type)&&len>=25) rtcm->nneed=25; /* msm */
+        else rtcm->nneed=len;
+        return 0;
+    }
+    if (rtcm->nbyte==25&&rtcm->hsize==0) {
+        if (!msm_decim(rtcm,rtcm->buff)) {
+            trace(4,"input_rtcm3: decimated type=%d\n",getbitu(rtcm->buff,24,12));
+            rtcm->skip=2;
+            rtcm->nneed=len;
+            return 0;
+        }
+        for (i=97;i<161;i++) nsat+=getbitu(rtcm->buff,i,1);
+        for (i=161;i<193;i++) nsig+=getbitu(rtcm->buff,i,1);
+        rtcm->hsize=193+nsat*nsig;
+        rtcm->nneed=(rtcm->hsize+7)/8;
+        if (nsat*nsig>64||rtcm->nneed>len) rtcm->nneed=len;
+        else if (rtcm->nneed>25) return 0;
+    }
+    if (rtcm->hsize>0&&rtcm->hcell<0&&rtcm->nbyte>=(rtcm->hsize+7)/8) {
+        type=getbitu(rtcm->buff,24,12);
+        if ((rtcm->hcell=decode_msm_head(rtcm,msmsys(type),&sync,&iod,
+                                         &rtcm->cell.h,&rtcm->hsize))<0) {
+            rtcm->skip=1;
+        }
+    }
+    rtcm->nneed=len;
+    return 0;
+}
+
+/* input RTCM 3 message from stream ----------------------------------------------
+* input bytes of rtcm 3 stream to rtcm->buff. it is resumable at any byte
+* args   : rtcm_con *rtcm   IO  rtcm control struct
+*          uint8_t *data    I   stream data
+*          int    n         I   number of stream data (bytes)
+*          int    *nused    O   number of used data (bytes)
+* return : status (0:need more data,1:frame in rtcm->buff,-1:frame skipped)
+*          (rtcm->skip=2: skipped by decimation,3: type not converted)
+*-----------------------------------------------------------------------------*/
+static int input_rtcm3(rtcm_con *rtcm, const uint8_t *data, int n, int *nused)
+{
+    const uint8_t *p;
+    int i=0,m;
+
+    while (i<n) {
+        if (rtcm->nbyte==0) { /* synchronize frame */
+            if (!(p=(const uint8_t *)memchr(data+i,RTCM3PREAMB,n-i))) {
+                i=n;
+                break;
+            }
+            i=(int)(p-data)+1;
+            rtcm->buff[0]=RTCM3PREAMB;
+            rtcm->nbyte=1;
+            rtcm->nneed=3;
+            rtcm->len=MAXRTCMLEN;
+            rtcm->skip=rtcm->hsize=0;
+            rtcm->hcell=-1;
+            continue;
+        }
+        m=rtcm->nneed-rtcm->nbyte<n-i?rtcm->nneed-rtcm->nbyte:n-i;
+        if (!rtcm->skip||rtcm->nbyte<6) {
+            memcpy(rtcm->buff+rtcm->nbyte,data+i,m);
+        }
+        rtcm->nbyte+=m;
+        i+=m;
+        if (rtcm->nbyte<rtcm->nneed||!input_state(rtcm)) continue;
+
+        rtcm->nbyte=0;
+        *nused=i;
+        return rtcm->skip?-1:1;
+    }
+    *nused=i;
+    return 0;
+}
+
+/* generate RTCM 3 message -----------------------------------------------------
+* generate RTCM 3 message
+* args   : rtcm_t *rtcm     IO  rtcm control struct
+*          int    type      I   message type
+*          int    subtype   I   message subtype
+*          int    sync      I   sync flag (1:another message follows)
+* return : status (1:ok,0:error)
+* notes  : For rtcm 3 msm, the {nsat} x {nsig} in rtcm->obs should not exceed
+*          64. If {nsat} x {nsig} of the input obs data exceeds 64, separate
+*          them to multiple ones and call gen_rtcm3() multiple times as user
+*          responsibility.
+*          ({nsat} = number of valid satellites, {nsig} = number of signals in
+*          the obs data)
+*-----------------------------------------------------------------------------*/
+static int gen_rtcm3(rtcm_con *rtcm, int type, int sync)
+{
+    uint32_t crc;
+    int i=0;
+
+    trace(4,"gen_rtcm3: type=%d sync=%d\n",type,sync);
+
+//    rtcm->nbit=rtcm->len=rtcm->nbyte=0;
+    rtcm->nbit=0;
+	rtcm->lensd = 0;
+
+    /* set preamble and reserved */
+    setbitu(rtcm->buffsd,i, 8,RTCM3PREAMB); i+= 8;
+    setbitu(rtcm->buffsd,i, 6,0          ); i+= 6;
+    setbitu(rtcm->buffsd,i,10,0          ); i+=10;
 
     /* encode rtcm 3 message body */
     if (!encode_rtcm3(rtcm,type,sync)) return 0;
 
-    /* padding to align 8 bit boundary */
-    for (i=rtcm->nbit;i%8;i++) {
-        setbitu(rtcm->buffsd,i,1,0);
+    /* padding to align 8 bit boundary */
+    for (i=rtcm->nbit;i%8;i++) {
+        setbitu(rtcm->buffsd,i,1,0);
+    }
+    /* message length (header+data) (bytes) */
+    if ((rtcm->lensd=i/8)>=3+1024) {
+        trace(2,"generate rtcm 3 message length error len=%d\n",rtcm->len-3);
+        rtcm->nbit=rtcm->lensd=0;
+        return 0;
+    }
+    /* message length without header and parity */
+    setbitu(rtcm->buffsd,14,10,rtcm->lensd-3);
+
+    /* crc-24q */
+    crc=rtk_crc24q(rtcm->buffsd,rtcm->lensd);
+    setbitu(rtcm->buffsd,i,24,crc);
+
+    /* length total (bytes) */
+//    rtcm->nbyte=rtcm->len+3;
+//    rtcm->nbyte=rtcm->len+3;
+
+    return 1;
+}
+
+/* number of valid MSM satellite ids of system (for verification) -----------*/
+static int ver_nsat(int sys)
+{
+    switch (sys) {
+        case SYS_GPS: return NSATGPS;
+        case SYS_GLO: return NSATGLO;
+        case SYS_GAL: return NSATGAL;
+        case SYS_QZS: return NSATQZS;
+        case SYS_SBS: return NSATSBS;
+        case SYS_CMP: return NSATCMP;
+        case SYS_IRN: return NSATIRN;
+    }
+    return 0;
+}
+/* expected kept signals of MSM message (for verification) ---------------------
+* derive the kept signals from the message signals and the profile without the
+* selection of the encoder: by exact obs codes, or per selected frequency the
+* signal with the first code in the code priority of the frequency
+* return : signal keep mask (bit k: signal k of message)
+*-----------------------------------------------------------------------------*/
+static uint32_t ver_sigkeep(const rtcmprof_t *prof, int sys, const msm_h_con *h)
+{
+    const char *obs,*q;
+    uint32_t keep=0;
+    int i,j,s=systbl(sys),ord[32],pri[32];
+
+    for (i=0;i<h->nsig;i++) {
+        obs=msm_sigstr(sys,h->sigs[i]);
+        ord[i]=pri[i]=-1;
+        if (!*obs) continue;
+        if (prof->bycode[s]) {
+            if (prof->code[s][obs2code(obs)]) keep|=1u<<i;
+            continue;
+        }
+        if ((ord[i]=code2ord(sys,obs2code(obs)))<0||ord[i]>=NFREQ||
+            prof->idx[s][ord[i]]>=prof->num[s]) continue;
+        if ((q=strchr(codepris[s][ord[i]],obs[1]))) {
+            pri[i]=(int)(q-codepris[s][ord[i]]);
+        }
+    }
+    if (prof->bycode[s]) return keep;
+
+    for (i=0;i<h->nsig;i++) {
+        if (pri[i]<0) continue;
+        for (j=0;j<h->nsig;j++) {
+            if (j!=i&&ord[j]==ord[i]&&pri[j]>=0&&pri[j]<pri[i]) break;
+        }
+        if (j>=h->nsig) keep|=1u<<i;
+    }
+    return keep;
+}
+/* verify converted MSM message --------------------------------------------------
+* decode converted msm message independently of the encoder and check that it
+* is a valid rtcm 3 frame with the header of the input message and exactly the
+* input cells of valid satellites and selected signals, bit for bit. the
+* expected cells are derived from the input message and the profile again,
+* not by the satellite and signal selection of the encoder
+* args   : rtcm_con *rtcm   IO  rtcm control struct (input msm cells)
+*          uint8_t *buff    I   converted message frame
+*          int    len       I   frame length (bytes)
+* return : status (1:ok,0:error)
+*-----------------------------------------------------------------------------*/
+static int msm_verify(rtcm_con *rtcm, const uint8_t *buff, int len)
+{
+    const msm_cell_con *c=&rtcm->cell;
+    const int ext=c->msm==5||c->msm==7,hr=c->msm>=6;
+    const int wpr=hr?20:15,wcp=hr?24:22,wlk=hr?10:4,wcn=hr?10:6;
+    uint64_t keep,expect=0,cells=0;
+    int i,j,k,n,p=97,nsat=0,nsig=0,ncell=0,msglen,isat[64],isig[32],pos[64];
+    int nmax;
+
+    /* frame and header */
+    msglen=len<6?0:(int)getbitu(buff,14,10)+3;
+    if (len<6||buff[0]!=RTCM3PREAMB||msglen+3!=len||
+        rtk_crc24q(buff,msglen)!=getbitu(buff,msglen*8,24)) {
+        trace(2,"msm_verify: frame error len=%d\n",len);
+        return 0;
+    }
+    if (getbitu(buff,24,32)!=getbitu(rtcm->buff,24,32)||
+        getbitu(buff,56,32)!=getbitu(rtcm->buff,56,32)||
+        getbitu(buff,88, 9)!=getbitu(rtcm->buff,88, 9)||msglen*8<p+96) {
+        trace(2,"msm_verify: header error\n");
+        return 0;
+    }
+    /* satellites and signals of output in input message */
+    for (i=0;i<64;i++,p++) {
+        if (!getbitu(buff,p,1)) continue;
+        for (j=0;j<c->h.nsat&&c->h.sats[j]!=i+1;j++) ;
+        if (j>=c->h.nsat) return 0;
+        isat[nsat++]=j;
+    }
+    for (i=0;i<32;i++,p++) {
+        if (!getbitu(buff,p,1)) continue;
+        for (j=0;j<c->h.nsig&&c->h.sigs[j]!=i+1;j++) ;
+        if (j>=c->h.nsig) return 0;
+        isig[nsig++]=j;
+    }
+    if (nsat*nsig>64||p+nsat*nsig>msglen*8) return 0;
+
+    for (i=0;i<nsat;i++) for (j=0;j<nsig;j++,p++) {
+        if (!getbitu(buff,p,1)) continue;
+        pos[ncell++]=n=isat[i]*c->h.nsig+isig[j];
+        cells|=(uint64_t)1<<n;
+    }
+    /* kept cells = input cells of valid satellites and selected signals */
+    keep=ver_sigkeep(rtcm->prof,c->sys,&c->h);
+    nmax=ver_nsat(c->sys);
+    for (i=0;i<c->h.nsat;i++) {
+        if (c->h.sats[i]<=nmax) expect|=(uint64_t)keep<<(i*c->h.nsig);
+    }
+    expect&=c->h.cellmask;
+    if (cells!=expect) {
+        trace(2,"msm_verify: cell error\n");
+        return 0;
+    }
+    if (p+nsat*(ext?36:18)+ncell*(wpr+wcp+wlk+1+wcn+(ext?15:0))>msglen*8) {
+        return 0;
+    }
+    /* satellite and signal data */
+    for (i=0;i<nsat;i++,p+=8) if (getbitu(buff,p,8)!=c->rng[isat[i]]) return 0;
+    if (ext) for (i=0;i<nsat;i++,p+=4) {
+        if (getbitu(buff,p,4)!=c->ex[isat[i]]) return 0;
+    }
+    for (i=0;i<nsat;i++,p+=10) if (getbitu(buff,p,10)!=c->rng_m[isat[i]]) return 0;
+    if (ext) for (i=0;i<nsat;i++,p+=14) {
+        if (getbits(buff,p,14)!=c->rate[isat[i]]) return 0;
+    }
+    for (k=0;k<ncell;k++,p+=wpr) if (getbits(buff,p,wpr)!=c->prv[pos[k]]) return 0;
+    for (k=0;k<ncell;k++,p+=wcp) if (getbits(buff,p,wcp)!=c->cpv[pos[k]]) return 0;
+    for (k=0;k<ncell;k++,p+=wlk) if (getbitu(buff,p,wlk)!=c->lock[pos[k]]) return 0;
+    for (k=0;k<ncell;k++,p++) {
+        if (getbitu(buff,p,1)!=((c->half>>pos[k])&1)) return 0;
+    }
+    for (k=0;k<ncell;k++,p+=wcn) if (getbitu(buff,p,wcn)!=c->cnr[pos[k]]) return 0;
+    if (ext) for (k=0;k<ncell;k++,p+=15) {
+        if (getbits(buff,p,15)!=c->rrv[pos[k]]) return 0;
+    }
+    /* only padding after message */
+    return msglen*8-p<8&&!getbitu(buff,p,msglen*8-p);
+}
+
+/* MSM4 delta coding -----------------------------------------------------------
+* MSM4 messages of a system are sent as delta messages (type DLTTYPE) against
+* the previous epochs while the header and masks are unchanged. full MSM4
+* messages are sent as keyframes every dlt->nkey epochs, on header or mask
+* change, if the delta message is not shorter and before the sequence number
+* wraps. a delta message contains:
+*
+*   message number (12) | system index (3) | keyframe epoch (30) |
+*   sequence (8) | sync (1) |
+*   epoch residual | rough range residual x nsat |
+*   {phaserange residual | pseudorange residual | lock same (1) [| lock (4)] |
+*    half-cycle (1) | cnr residual} x ncell
+*
+* residuals are coded as signed exp-golomb codes. epoch (modulo 2^30), rough
+* range and phaserange of the first signal of a satellite are predicted
+* linearly from the last two epochs. phaserange of the other signals is
+* predicted by the change of the first signal and pseudorange by the change of
+* the phaserange of the signal, so the residuals are mostly noise, multipath
+* and ionosphere change. cnr is predicted by the last epoch. pseudorange and
+* phaserange include rough range, so the coding is lossless for any fields
+* notes  : the decoder needs the keyframe and all delta messages after it. the
+*          keyframe epoch and the sequence number (1,2,... after keyframe)
+*          identify the state a delta message is coded against. on a lost
+*          keyframe or delta message, delta messages are dropped until next
+*          keyframe
+*-----------------------------------------------------------------------------*/
+
+/* put/get signed exp-golomb code --------------------------------------------*/
+static void dlt_putv(bitw_con *w, int64_t v)
+{
+    uint64_t x=(v<0?((uint64_t)(-(v+1))<<1)|1:(uint64_t)v<<1)+1;
+    int i,n=0;
+
+    while (x>>(n+1)) n++;
+    for (i=n;i>0;i-=32) bitw_put(w,0,i<32?i:32);
+    if (n+1>32) {
+        bitw_put(w,(uint32_t)(x>>32),n+1-32);
+        bitw_put(w,(uint32_t)x,32);
+    }
+    else bitw_put(w,(uint32_t)x,n+1);
+}
+static int dlt_getv(const uint8_t *buff, int *i, int nbit, int64_t *v)
+{
+    uint64_t x;
+    int n=0;
+
+    while (*i<nbit&&!getbitu(buff,*i,1)) {
+        (*i)++;
+        if (++n>62) return 0;
+    }
+    if (*i+n+1>nbit) return 0;
+    if (n+1>32) {
+        x=(uint64_t)getbitu(buff,*i,n+1-32)<<32;
+        x|=getbitu(buff,*i+n+1-32,32);
+    }
+    else x=getbitu(buff,*i,n+1);
+    *i+=n+1;
+    x-=1;
+    *v=(x&1)?-(int64_t)(x>>1)-1:(int64_t)(x>>1);
+    return 1;
+}
+
+/* prediction by last two epochs ---------------------------------------------*/
+static int64_t dlt_pred(int nep, int64_t x1, int64_t x2)
+{
+    return nep>=2?2*x1-x2:x1;
+}
+static uint32_t dlt_epoch(const dlt_sys_con *st)
+{
+    return (st->nep>=2?2*st->m.epoch-st->epoch:st->m.epoch)&0x3FFFFFFF;
+}
+
+/* predict phaserange of cell k (lead: first cell of satellite) --------------*/
+static int64_t dlt_predcp(const dlt_sys_con *st, const int64_t *cp, int k,
+                          int lead)
+{
+    if (k==lead) return dlt_pred(st->nep,st->m.cp[k],st->cp[k]);
+    return st->m.cp[k]+cp[lead]-st->m.cp[lead];
+}
+/* predict pseudorange of cell k by phaserange change ------------------------*/
+static int64_t dlt_predpr(const dlt_sys_con *st, const int64_t *cp, int k)
+{
+    return st->m.pr[k]+(cp[k]-st->m.cp[k])/32; /* 2^-29 ms -> 2^-24 ms */
+}
+
+/* unpack MSM4 message to integers -------------------------------------------*/
+static int dlt_unpack(const uint8_t *buff, int len, dlt_msm_con *m)
+{
+    uint64_t n;
+    int i=24,j,k,isat,nbit=(len-3)*8;
+
+    if (nbit<193) return 0;
+    m->type =getbitu(buff,i,12); i+=12;
+    m->staid=getbitu(buff,i,12); i+=12;
+    m->epoch=getbitu(buff,i,30); i+=30;
+    m->sync =getbitu(buff,i, 1); i+= 1;
+    m->info =getbitu(buff,i,18); i+=18;
+    m->satm[0]=getbitu(buff,i,32); i+=32;
+    m->satm[1]=getbitu(buff,i,32); i+=32;
+    m->sigm   =getbitu(buff,i,32); i+=32;
+    m->nsat=popcnt64(((uint64_t)m->satm[0]<<32)|m->satm[1]);
+    m->nsig=popcnt64(m->sigm);
+    if (m->nsat*m->nsig>64||i+m->nsat*m->nsig>nbit) return 0;
+
+    for (j=0,m->cellm=0;j<m->nsat*m->nsig;j++) {
+        if (getbitu(buff,i++,1)) m->cellm|=(uint64_t)1<<j;
+    }
+    m->ncell=popcnt64(m->cellm);
+    if (i+m->nsat*18+m->ncell*48>nbit) return 0;
+
+    for (j=0;j<m->nsat;j++,i+=8) m->rr[j]=(int64_t)getbitu(buff,i,8)<<10;
+    for (j=0;j<m->nsat;j++,i+=10) m->rr[j]|=getbitu(buff,i,10);
+
+    for (k=0,n=m->cellm;n;k++,n&=n-1) {
+        isat=ctz64(n)/m->nsig;
+        m->pr[k]=m->rr[isat]*16384+getbits(buff,i+k*15,15);
+        m->cp[k]=m->rr[isat]*524288+getbits(buff,i+m->ncell*15+k*22,22);
+    }
+    i+=m->ncell*37;
+    for (k=0;k<m->ncell;k++) {
+        m->lock[k]=(uint8_t)getbitu(buff,i+k*4,4);
+        m->half[k]=(uint8_t)getbitu(buff,i+m->ncell*4+k,1);
+        m->cnr [k]=(uint8_t)getbitu(buff,i+m->ncell*5+k*6,6);
+    }
+    return 1;
+}
+
+/* same header and masks except epoch and sync -------------------------------*/
+static int dlt_same(const dlt_msm_con *a, const dlt_msm_con *b)
+{
+    return a->type==b->type&&a->staid==b->staid&&a->info==b->info&&
+           a->satm[0]==b->satm[0]&&a->satm[1]==b->satm[1]&&a->sigm==b->sigm&&
+           a->cellm==b->cellm;
+}
+
+/* update delta state by message (key: keyframe) -----------------------------*/
+static void dlt_update(dlt_sys_con *st, const dlt_msm_con *m, int key)
+{
+    if (key) {
+        st->nep=1;
+        st->nseq=0;
+        st->kepoch=m->epoch;
+    }
+    else {
+        st->epoch=st->m.epoch;
+        memcpy(st->rr,st->m.rr,sizeof(st->rr));
+        memcpy(st->pr,st->m.pr,sizeof(st->pr));
+        memcpy(st->cp,st->m.cp,sizeof(st->cp));
+        st->nep=2;
+        st->nseq++;
+    }
+    st->m=*m;
+}
+
+/* encode MSM4 message to delta message --------------------------------------
+* args   : dlt_con *dlt     IO  msm4 delta coding
+*          uint8_t *buff    IO  msm4 message frame (replaced by delta message)
+*          int    len       I   frame length (bytes)
+* return : frame length (bytes) (len: keyframe)
+*-----------------------------------------------------------------------------*/
+static int dlt_encode(dlt_con *dlt, uint8_t *buff, int len)
+{
+    dlt_msm_con m;
+    dlt_sys_con *st;
+    bitw_con w;
+    uint8_t out[4096];
+    uint64_t n;
+    uint32_t res;
+    int i,s,isat,last=-1,lead=0,len_d;
+
+    if (!dlt_unpack(buff,len,&m)) return len;
+
+    st=dlt->sys+(s=systbl(msmsys(m.type)));
+
+    if (st->nep==0||st->nseq+1>=dlt->nkey||st->nseq+1>=DLTSEQ||
+        !dlt_same(&st->m,&m)) {
+        dlt_update(st,&m,1);
+        return len;
+    }
+    bitw_init(&w,out,24);
+    bitw_put(&w,DLTTYPE,12);
+    bitw_put(&w,s,3);
+    bitw_put(&w,st->kepoch,30);
+    bitw_put(&w,st->nseq+1,8);
+    bitw_put(&w,m.sync,1);
+    res=(m.epoch-dlt_epoch(st))&0x3FFFFFFF;
+    dlt_putv(&w,res&0x20000000?(int64_t)res-0x40000000:(int64_t)res);
+
+    for (i=0;i<m.nsat;i++) {
+        dlt_putv(&w,m.rr[i]-dlt_pred(st->nep,st->m.rr[i],st->rr[i]));
+    }
+    for (i=0,n=m.cellm;n;i++,n&=n-1) {
+        if ((isat=ctz64(n)/m.nsig)!=last) lead=i;
+        last=isat;
+        dlt_putv(&w,m.cp[i]-dlt_predcp(st,m.cp,i,lead));
+        dlt_putv(&w,m.pr[i]-dlt_predpr(st,m.cp,i));
+        if (m.lock[i]==st->m.lock[i]) bitw_put(&w,0,1);
+        else bitw_put(&w,0x10|m.lock[i],5);
+        bitw_put(&w,m.half[i],1);
+        dlt_putv(&w,(int64_t)m.cnr[i]-st->m.cnr[i]);
+    }
+    len_d=(bitw_end(&w)+7)/8;
+
+    if (len_d+3>=len) { /* delta message not shorter */
+        dlt_update(st,&m,1);
+        return len;
+    }
+    setbitu(out, 0, 8,RTCM3PREAMB);
+    setbitu(out, 8, 6,0);
+    setbitu(out,14,10,len_d-3);
+    setbitu(out,len_d*8,24,rtk_crc24q(out,len_d));
+    memcpy(buff,out,len_d+3);
+
+    dlt_update(st,&m,0);
+    return len_d+3;
+}
+
+/* restore MSM4 message from integers ----------------------------------------*/
+static int dlt_restore(rtcm_con *rtcm, const dlt_msm_con *m)
+{
+    msm_cell_con *c=&rtcm->cell;
+    uint64_t n;
+    int i,j,k,isat,ret;
+
+    setbitu(rtcm->buff, 0, 8,RTCM3PREAMB);
+    setbitu(rtcm->buff, 8, 6,0        );
+    setbitu(rtcm->buff,24,12,m->type );
+    setbitu(rtcm->buff,36,12,m->staid);
+    setbitu(rtcm->buff,48,30,m->epoch);
+    setbitu(rtcm->buff,78, 1,m->sync );
+    setbitu(rtcm->buff,79,18,m->info );
+
+    c->sys=msmsys(m->type);
+    c->msm=4;
+    c->ncell=m->ncell;
+    c->h.nsat=(uint8_t)m->nsat;
+    c->h.nsig=(uint8_t)m->nsig;
+    for (i=j=0;i<64;i++) {
+        if ((m->satm[i/32]>>(31-i%32))&1) c->h.sats[j++]=(uint8_t)(i+1);
+    }
+    for (i=j=0;i<32;i++) {
+        if ((m->sigm>>(31-i))&1) c->h.sigs[j++]=(uint8_t)(i+1);
+    }
+    c->h.cellmask=m->cellm;
+    c->half=c->slip=0;
+
+    for (i=0;i<m->nsat;i++) {
+        c->rng  [i]=(uint8_t)(m->rr[i]>>10);
+        c->rng_m[i]=(uint16_t)(m->rr[i]&1023);
+    }
+    for (k=0,n=m->cellm;n;k++,n&=n-1) {
+        j=ctz64(n);
+        isat=j/m->nsig;
+        c->prv [j]=(int32_t)(m->pr[k]-m->rr[isat]*16384);
+        c->cpv [j]=(int32_t)(m->cp[k]-m->rr[isat]*524288);
+        c->lock[j]=m->lock[k];
+        c->cnr [j]=m->cnr[k];
+        if (m->half[k]) c->half|=(uint64_t)1<<j;
+    }
+    /* all cells of message output */
+    rtcm->nosel=1;
+    ret=gen_rtcm3(rtcm,m->type,m->sync);
+    rtcm->nosel=0;
+    return ret;
+}
+
+/* decode delta message to MSM4 message --------------------------------------
+* args   : rtcm_con *rtcm   IO  rtcm control struct (rtcm->dlt: delta coding)
+*          uint8_t *buff    I   delta message frame
+*          int    len       I   frame length (bytes)
+* return : status (1:msm4 message in rtcm->buffsd,0:no state,-1:error)
+*-----------------------------------------------------------------------------*/
+static int dlt_decode(rtcm_con *rtcm, const uint8_t *buff, int len)
+{
+    dlt_msm_con m;
+    dlt_sys_con *st;
+    uint64_t n;
+    int64_t v;
+    uint32_t kepoch;
+    int i=36,k,s,seq,isat,last=-1,lead=0,nbit=(len-3)*8;
+
+    if (nbit<78||(s=getbitu(buff,i,3))>=7) return -1;
+    st=rtcm->dlt->sys+s;
+    kepoch=getbitu(buff,i+3,30);
+    seq=getbitu(buff,i+33,8);
+
+    /* delta message against other keyframe or after lost message */
+    if (st->nep==0||kepoch!=st->kepoch||seq!=st->nseq+1) {
+        trace(2,"dlt_decode: no delta state sys=%d kepoch=%u seq=%d\n",s,
+              kepoch,seq);
+        st->nep=0; /* wait for next keyframe */
+        return 0;
+    }
+    m=st->m;
+    m.sync=getbitu(buff,i+41,1);
+    i+=42;
+
+    if (!dlt_getv(buff,&i,nbit,&v)) goto err;
+    m.epoch=(dlt_epoch(st)+(uint32_t)v)&0x3FFFFFFF;
+
+    for (k=0;k<m.nsat;k++) {
+        if (!dlt_getv(buff,&i,nbit,&v)) goto err;
+        m.rr[k]=dlt_pred(st->nep,st->m.rr[k],st->rr[k])+v;
+    }
+    for (k=0,n=m.cellm;n;k++,n&=n-1) {
+        if ((isat=ctz64(n)/m.nsig)!=last) lead=k;
+        last=isat;
+        if (!dlt_getv(buff,&i,nbit,&v)) goto err;
+        m.cp[k]=dlt_predcp(st,m.cp,k,lead)+v;
+        if (!dlt_getv(buff,&i,nbit,&v)) goto err;
+        m.pr[k]=dlt_predpr(st,m.cp,k)+v;
+        if (i+1>nbit) goto err;
+        if (getbitu(buff,i++,1)) {
+            if (i+4>nbit) goto err;
+            m.lock[k]=(uint8_t)getbitu(buff,i,4); i+=4;
+        }
+        if (i+1>nbit) goto err;
+        m.half[k]=(uint8_t)getbitu(buff,i++,1);
+        if (!dlt_getv(buff,&i,nbit,&v)) goto err;
+        m.cnr[k]=(uint8_t)(st->m.cnr[k]+v);
+    }
+    dlt_update(st,&m,0);
+
+    return dlt_restore(rtcm,&m)?1:-1;
+err:
+    trace(2,"dlt_decode: message error sys=%d len=%d\n",s,len);
+    st->nep=0;
+    return -1;
+}
+
+/* set frequency selection profile of message --------------------------------*/
+static void set_prof(rtcm_con *rtcm, const rtcmprof_t *prof)
+{
+    if (prof==rtcm->prof) return;
+    rtcm->prof=prof;
+    memset(rtcm->selok,0,sizeof(rtcm->selok)); /* signal selection changed */
+}
+
+/* frequency selection strings to profile --------------------------------------
+* compile freq_c into the profile of rtcm control struct. systems are compiled
+* again only if the strings differ from those of the last message
+* return : profile (NULL: unknown frequency in freq_c)
+*-----------------------------------------------------------------------------*/
+static const rtcmprof_t *freq2prof(rtcm_con *rtcm, char **freq_c)
+{
+    const char *frq;
+    int i,err=0;
+
+    for (i=0;i<7;i++) {
+        frq=freq_c&&freq_c[i]?freq_c[i]:"";
+
+        /* freq_c[i] may be shorter than 40 bytes */
+        if (!strncmp(rtcm->frqp.frq[i],frq,sizeof(rtcm->frqp.frq[i])-1)) continue;
+
+        if (!setfrqpri(&rtcm->frqp,i,frq)) {
+            trace(1,"frequency selection error: sys=%d freq=%s\n",i,frq);
+        }
+        rtcm->selok[i]=0; /* signal selection changed */
+    }
+    for (i=0;i<7;i++) err|=rtcm->frqp.err[i];
+    return err?NULL:&rtcm->frqp;
+}
+
+/* convert RTCM 3 frame with rtcm control struct ---------------------------*/
+static int cvt_rtcm3(rtcm_con *rtcm, rtcmstat_t *stat, int sync,
+                     unsigned char *buff_in, int len,
+                     unsigned char *buff_sd, int *len_sd)
+{
+    uint64_t t0,t1,t2;
+    int k,ret,type,otype,msglen;
+
+    t0=stat?tickget_ns():0;
+    *len_sd=0;
+
+    if (len<0||len>(int)sizeof(rtcm->buff)) {
+        trace(2,"rtcm3 input length error: len=%d\n",len);
+        if (stat) STAT_ADD(stat->nerr,1);
+        return -1;
+    }
+    if (buff_in!=rtcm->buff) { /* else frame input by input_rtcm3() */
+        memcpy(rtcm->buff,buff_in,len*sizeof(uint8_t));
+        rtcm->hcell=-1;
+    }
+    rtcm->len=len;
+    rtcm->obs.n=0;
+    rtcm->cell.sys=SYS_NONE;
+    rtcm->ncell[0]=rtcm->ncell[1]=0;
+
+    if (stat) STAT_ADD(stat->bytein,len);
+
+    /* check preamble, message length and parity */
+    msglen=len<6?0:(int)getbitu(rtcm->buff,14,10)+3;
+    if (len<6||rtcm->buff[0]!=RTCM3PREAMB||msglen+3>len) {
+        trace(2,"rtcm3 frame length error: len=%d\n",len);
+        if (stat) STAT_ADD(stat->nerr,1);
+        return -1;
+    }
+    /* message type only if the message holds its 12 bits */
+	type = msglen>=5?getbitu(rtcm->buff, 24, 12):0;
+	trace(2, "type : %d\n", type);
+
+    if (stat) STAT_ADD(stat->nin[stat_typeidx(type)],1);
+    if (rtk_crc24q(rtcm->buff,msglen)!=getbitu(rtcm->buff,msglen*8,24)) {
+        trace(2,"rtcm3 parity error: len=%d\n",len);
+        if (stat) STAT_ADD(stat->ncrc,1);
+        return -1;
+    }
+    /* decoders check fields against the message, not against the input */
+    rtcm->len=msglen+3;
+    if (rtcm->rep&&msm_kernel(type)) { /* stream time of repeat suppression */
+        rep_time(rtcm->rep,msm_towms(msmsys(type),getbitu(rtcm->buff,48,30)));
+    }
+    if (!msm_decim(rtcm,rtcm->buff)) { /* not on decimation grid */
+        if (stat) STAT_ADD(stat->ndec,1);
+        return 0;
+    }
+    ret = decode_rtcm3(rtcm);
+
+    if (ret==0&&rtcm->rep&&(k=rep_type(type))>=0) { /* ephemeris, station */
+        ret=rep_check(rtcm->rep,rtcm->buff,rtcm->len,rep_key(rtcm->buff,k));
+        if (!ret&&stat) STAT_ADD(stat->nrep,1);
+    }
+    t1=stat?tickget_ns():0;
+
+    //type = getbitu(rtcm->buff,24,12);
+    if (ret==-2) { /* type not converted */
+        if (stat) STAT_ADD(stat->nunsup,1);
+        ret=-1;
+    }
+    else if (ret<0){
+
+        trace(2,"type error: %d\n",type);
+        if (stat) STAT_ADD(stat->nerr,1);
+    }
+    else if (ret==0) { /* no observation data (fcn cache update only) */
+        *len_sd=0;
+    }
+    else {
+        otype=leg_otype(rtcm,type);
+        ret= gen_rtcm3(rtcm, otype, sync);
+
+		if (ret>0&&rtcm->verify&&msm_kernel(otype)&&!msm_verify(rtcm,rtcm->buffsd,rtcm->lensd+3)) {
+			trace(1,"rtcm3 %d verify error\n",type);
+			if (stat) STAT_ADD(stat->nverr,1);
+			ret=-1;
+		}
+
+		if (ret>0) {
+			*len_sd = rtcm->lensd + 3;
+			memcpy(buff_sd, rtcm->buffsd, *len_sd * sizeof(uint8_t));
+
+			if (rtcm->dlt&&otype%10==4&&msm_kernel(otype)) { /* msm4 delta coding */
+				*len_sd = dlt_encode(rtcm->dlt, buff_sd, *len_sd);
+			}
+		}
+		else {
+			*len_sd = 0;
+		}
+        if (stat) {
+            t2=tickget_ns();
+            stat_lat(stat,0,t0,t1);
+            stat_lat(stat,1,t1,t2);
+            stat_lat(stat,2,t0,t2);
+            STAT_ADD(stat->ncell,rtcm->ncell[0]);
+            if (ret>0) {
+                STAT_ADD(stat->nout[stat_typeidx(getbitu(buff_sd,24,12))],1);
+                STAT_ADD(stat->byteout,*len_sd);
+                STAT_ADD(stat->ndrop,rtcm->ncell[0]-rtcm->ncell[1]);
+            }
+        }
+    }
+    return ret;
+}
+
+/* convert RTCM 3 message -----------------------------------------------------
+* generate RTCM 3 message
+* args   : uint8_t *buff_in I   rtcm binary data
+*          int    len       I   length of received rtcm data (<=1200)
+*          char  **freq_c   I   sent frequency
+*          uint8_t *buff_sd o   converted rtcm data (need to be sent)
+*          int    *len_sd   o   results length
+* return : status (1:ok,0,-1:error or no rtcm data)
+*
+* freq_c selection :
+*
+* "L1", "L2", "L5",                            GPS
+* "G1", "G2", "G3", "G1a","G2a",               GLO
+* "E1", "E5b","E5a","E6", "E5ab",              GAL
+* "L1", "L2", "L5", "L6",                      QZS
+* "L1", "L5",                                  SBS
+* "B1I","B3I","B2a","B1C","B2ab","B2I", "B2b", BDS
+* "L5", "S",                                   IRN
+*
+* freq_c format: char *freq_c[7]={
+*                    "L1",                     //GPS
+*                    "",                       //GLONASS
+*                    "E1+E5b",                 //Galileo
+*                    "L1+L2",                  //QZSS
+*                    "L1+L5",                  //SBAS
+*                    "B1I+B2I+B3I",            //BDS
+*                    "L5+S"                    //IRN
+*                   };
+* note: Taking the above as an example, the rtcm data will be encoded:
+* GPS L1 data will be obtained, while the corresponding L2 and L3 are discarded.
+* GLONASS no data will be sent;
+* BDS B1I, B2I, B3I will be obtained in new rtcm buff.
+* "G3", "G1a","G2a" in rtcm ICD are not provided. therefore, please do not choose the three.
+*-----------------------------------------------------------------------------*/
+
+
+API_DECLSPEC int rtcmCvt(int sync,unsigned char *buff_in,int len,char **freq_c,unsigned char *buff_sd,int *len_sd){
+    const rtcmprof_t *prof;
+    int ret;
+    rtcm_con rtcm_in;
+
+    *len_sd=0;
+
+    if (!init_rtcm(&rtcm_in)) return -1;
+
+    if (!(prof=freq2prof(&rtcm_in,freq_c))) {
+        free_rtcm(&rtcm_in);
+        return -1;
+    }
+    set_prof(&rtcm_in,prof);
+    ret = cvt_rtcm3(&rtcm_in,NULL,sync,buff_in,len,buff_sd,len_sd);
+
+    free_rtcm(&rtcm_in);
+    return ret;
+
+}
+
+/* open RTCM stream converter ------------------------------------------------*/
+API_DECLSPEC rtcmcvt_t *rtcmcvtopen(void)
+{
+    rtcmcvt_t *cvt;
+
+    trace(3,"rtcmcvtopen:\n");
+
+    if (!(cvt=(rtcmcvt_t *)calloc(1,sizeof(rtcmcvt_t)))) {
+        trace(1,"rtcmcvtopen: malloc fail\n");
+        return NULL;
+    }
+    if (!init_rtcm(&cvt->rtcm)) {
+        free(cvt);
+        return NULL;
+    }
+    return cvt;
+}
+
+/* close RTCM stream converter -----------------------------------------------*/
+API_DECLSPEC void rtcmcvtclose(rtcmcvt_t *cvt)
+{
+    trace(3,"rtcmcvtclose:\n");
+
+    if (!cvt) return;
+    free_rtcm(&cvt->rtcm);
+    free(PROF_XCHG(cvt->next,NULL));
+    free(cvt->prof);
+    free(cvt);
+}
+
+/* set frequency selection profile of converter input ------------------------
+* take the pending profile of rtcmcvtsetprof() and select the profile of the
+* message. the hot path costs one load while no profile is pending
+* return : status (1:ok,0:unknown frequency in freq_c)
+*-----------------------------------------------------------------------------*/
+static int cvt_prof(rtcmcvt_t *cvt, char **freq_c)
+{
+    rtcm_con *rtcm=&cvt->rtcm;
+    const rtcmprof_t *q;
+    rtcmprof_t *p;
+
+    if (PROF_GET(cvt->next)&&(p=PROF_XCHG(cvt->next,NULL))) {
+        trace(3,"cvt_prof: profile swapped\n");
+        if (rtcm->prof==cvt->prof) set_prof(rtcm,p);
+        free(cvt->prof); /* no other reference after swap */
+        cvt->prof=p;
+    }
+    if (freq_c) {
+        if (!(q=freq2prof(rtcm,freq_c))) return 0;
+        set_prof(rtcm,q);
+    }
+    else if (cvt->prof) set_prof(rtcm,cvt->prof);
+    return 1;
+}
+
+/* convert RTCM 3 message with stream converter ------------------------------*/
+API_DECLSPEC int rtcmcvtinput(rtcmcvt_t *cvt,int sync,unsigned char *buff_in,int len,char **freq_c,unsigned char *buff_sd,int *len_sd)
+{
+    if (!cvt_prof(cvt,freq_c)) {
+        *len_sd=0;
+        return -1;
+    }
+    return cvt_rtcm3(&cvt->rtcm,&cvt->stat,sync,buff_in,len,buff_sd,len_sd);
+}
+
+/* input RTCM 3 stream to converter ------------------------------------------*/
+API_DECLSPEC int rtcmcvtinputs(rtcmcvt_t *cvt,const unsigned char *data,int n,int *nused,char **freq_c,unsigned char *buff_sd,int *len_sd)
+{
+    rtcm_con *rtcm=&cvt->rtcm;
+    int ret,type;
+
+    *len_sd=0;
+
+    if (!cvt_prof(cvt,freq_c)) { /* stream dropped */
+        *nused=n;
+        return -1;
+    }
+    if (!(ret=input_rtcm3(rtcm,data,n,nused))) return -2;
+
+    type=getbitu(rtcm->buff,24,12);
+
+    if (ret<0) { /* frame skipped */
+        STAT_ADD(cvt->stat.nin[stat_typeidx(type)],1);
+        STAT_ADD(cvt->stat.bytein,rtcm->len);
+        if (rtcm->skip==2) { /* decimated */
+            STAT_ADD(cvt->stat.ndec,1);
+            return 0;
+        }
+        if (rtcm->skip==3) STAT_ADD(cvt->stat.nunsup,1);
+        else STAT_ADD(cvt->stat.nerr,1);
+        return -1;
+    }
+    /* multiple message bit of input msm or legacy message kept */
+    return cvt_rtcm3(rtcm,&cvt->stat,getbitu(rtcm->buff,
+                     legsys(type)==SYS_GLO?75:78,1),rtcm->buff,rtcm->len,
+                     buff_sd,len_sd);
+}
+
+/* new frequency selection profile -------------------------------------------*/
+API_DECLSPEC rtcmprof_t *rtcmprofnew(char **freq_c)
+{
+    rtcmprof_t *prof;
+    int i;
+
+    if (!(prof=(rtcmprof_t *)calloc(1,sizeof(rtcmprof_t)))) {
+        trace(1,"rtcmprofnew: malloc fail\n");
+        return NULL;
+    }
+    for (i=0;i<7;i++) {
+        if (setfrqpri(prof,i,freq_c?freq_c[i]:NULL)) continue;
+        trace(1,"rtcmprofnew: frequency selection error: sys=%d freq=%s\n",i,
+              freq_c[i]);
+        free(prof);
+        return NULL;
+    }
+    return prof;
+}
+
+/* new signal selection profile by obs codes ---------------------------------*/
+API_DECLSPEC rtcmprof_t *rtcmprofsig(const char *sel)
+{
+    rtcmprof_t *prof;
+
+    if (!(prof=(rtcmprof_t *)calloc(1,sizeof(rtcmprof_t)))) {
+        trace(1,"rtcmprofsig: malloc fail\n");
+        return NULL;
+    }
+    if (!sel||!setcodesel(prof,sel)) {
+        free(prof);
+        return NULL;
+    }
+    return prof;
+}
+
+/* free frequency selection profile ------------------------------------------*/
+API_DECLSPEC void rtcmproffree(rtcmprof_t *prof)
+{
+    free(prof);
+}
+
+/* set frequency selection profile of stream converter -----------------------*/
+API_DECLSPEC void rtcmcvtsetprof(rtcmcvt_t *cvt,rtcmprof_t *prof)
+{
+    trace(3,"rtcmcvtsetprof:\n");
+
+    /* a profile pending and not yet taken by the converter is replaced */
+    free(PROF_XCHG(cvt->next,prof));
+}
+
+/* set MSM4 delta coding of stream converter --------------------------------*/
+API_DECLSPEC int rtcmcvtdelta(rtcmcvt_t *cvt,int nkey)
+{
+    rtcm_con *rtcm=&cvt->rtcm;
+
+    trace(3,"rtcmcvtdelta: nkey=%d\n",nkey);
+
+    if (nkey<=0) {
+        free(rtcm->dlt); rtcm->dlt=NULL;
+        return 1;
+    }
+    if (!rtcm->dlt&&!(rtcm->dlt=(dlt_con *)calloc(1,sizeof(dlt_con)))) {
+        trace(1,"rtcmcvtdelta: malloc fail\n");
+        return 0;
+    }
+    rtcm->dlt->nkey=nkey;
+    return 1;
+}
+
+/* set verification of converted MSM messages --------------------------------*/
+API_DECLSPEC void rtcmcvtverify(rtcmcvt_t *cvt,int ena)
+{
+    trace(3,"rtcmcvtverify: ena=%d\n",ena);
+
+    cvt->rtcm.verify=ena!=0;
+}
+
+/* set MSM epoch decimation of stream converter -----------------------------*/
+API_DECLSPEC void rtcmcvtdecim(rtcmcvt_t *cvt,int tint,int toff)
+{
+    trace(3,"rtcmcvtdecim: tint=%d toff=%d\n",tint,toff);
+
+    cvt->rtcm.tint=tint>0?tint:0;
+    cvt->rtcm.toff=tint>0?toff%tint:0;
+}
+
+/* set repeated message suppression of stream converter ---------------------*/
+API_DECLSPEC int rtcmcvtrepeat(rtcmcvt_t *cvt,int tint)
+{
+    rtcm_con *rtcm=&cvt->rtcm;
+    int i;
+
+    trace(3,"rtcmcvtrepeat: tint=%d\n",tint);
+
+    if (tint<=0) {
+        free(rtcm->rep); rtcm->rep=NULL;
+        return 1;
+    }
+    if (!rtcm->rep) {
+        if (!(rtcm->rep=(rep_con *)malloc(sizeof(rep_con)))) {
+            trace(1,"rtcmcvtrepeat: malloc fail\n");
+            return 0;
+        }
+        rtcm->rep->tow=-1;
+        for (i=0;i<REP_NKEY;i++) {
+            rtcm->rep->hash[i]=0;
+            rtcm->rep->tfwd[i]=-1;
+        }
+    }
+    rtcm->rep->tint=tint;
+    return 1;
+}
+
+/* set legacy observation message conversion of stream converter ------------*/
+API_DECLSPEC void rtcmcvtlegacy(rtcmcvt_t *cvt,int mode)
+{
+    trace(3,"rtcmcvtlegacy: mode=%d\n",mode);
+
+    cvt->rtcm.legacy=mode==RTCMLEG_OUT||mode==RTCMLEG_MSM?mode:RTCMLEG_OFF;
+}
+
+/* restore MSM4 message from MSM4 delta message ------------------------------*/
+API_DECLSPEC int rtcmcvtundelta(rtcmcvt_t *cvt,const unsigned char *buff_in,int len,unsigned char *buff_sd,int *len_sd)
+{
+    rtcm_con *rtcm=&cvt->rtcm;
+    dlt_msm_con m;
+    int ret,type,msglen;
+
+    *len_sd=0;
+
+    if (!rtcm->dlt&&!(rtcm->dlt=(dlt_con *)calloc(1,sizeof(dlt_con)))) {
+        trace(1,"rtcmcvtundelta: malloc fail\n");
+        return -1;
+    }
+    msglen=len<6?0:(int)getbitu(buff_in,14,10)+3;
+    if (len<6||buff_in[0]!=RTCM3PREAMB||msglen+3>len) {
+        trace(2,"rtcmcvtundelta: frame length error: len=%d\n",len);
+        return -1;
+    }
+    if (rtk_crc24q(buff_in,msglen)!=getbitu(buff_in,msglen*8,24)) {
+        trace(2,"rtcmcvtundelta: parity error: len=%d\n",len);
+        return -1;
+    }
+    type=getbitu(buff_in,24,12);
+
+    if (type==DLTTYPE) {
+        if ((ret=dlt_decode(rtcm,buff_in,msglen+3))<=0) return ret;
+        *len_sd=rtcm->lensd+3;
+        memcpy(buff_sd,rtcm->buffsd,*len_sd);
+        return 1;
+    }
+    /* msm4 keyframe */
+    if (msmsys(type)!=SYS_NONE&&type%10==4&&dlt_unpack(buff_in,msglen+3,&m)) {
+        dlt_update(rtcm->dlt->sys+systbl(msmsys(type)),&m,1);
+    }
+    *len_sd=msglen+3;
+    memcpy(buff_sd,buff_in,*len_sd);
+    return 1;
+}
+
+/* satellite number to satellite id ------------------------------------------*/
+static void satno2id(int sat, char *id)
+{
+    int prn;
+
+    switch (satsys(sat,&prn)) {
+        case SYS_GPS: sprintf(id,"G%02d",prn-MINPRNGPS+1); return;
+        case SYS_GLO: sprintf(id,"R%02d",prn-MINPRNGLO+1); return;
+        case SYS_GAL: sprintf(id,"E%02d",prn-MINPRNGAL+1); return;
+        case SYS_QZS: sprintf(id,"J%02d",prn-MINPRNQZS+1); return;
+        case SYS_CMP: sprintf(id,"C%02d",prn-MINPRNCMP+1); return;
+        case SYS_IRN: sprintf(id,"I%02d",prn-MINPRNIRN+1); return;
+        case SYS_SBS: sprintf(id,"S%02d",prn-100); return;
+    }
+    strcpy(id,"");
+}
+
+/* get observation data of last message in physical units --------------------*/
+API_DECLSPEC int rtcmcvtobs(rtcmcvt_t *cvt,rtcmobs_t *obs,int nmax)
+{
+    obsd_con *data;
+    int i,j,n=0;
+
+    if (cvt->rtcm.cell.sys==SYS_NONE||!msm2obs(&cvt->rtcm)) return 0;
+
+    for (i=0;i<cvt->rtcm.obs.n;i++) {
+        data=cvt->rtcm.obs.data+i;
+
+        for (j=0;j<NFREQ+NEXOBS&&n<nmax;j++) {
+            if (!data->code[j]) continue;
+            satno2id(data->sat,obs[n].sat);
+            strcpy(obs[n].code,code2obs(data->code[j]));
+            obs[n].P   =data->P[j];
+            obs[n].L   =data->L[j];
+            obs[n].D   =data->D[j];
+            obs[n].SNR =(float)(data->SNR[j]*SNR_UNIT);
+            obs[n].LLI =data->LLI[j];
+            obs[n].lock=(unsigned short)data->locktime[j];
+            n++;
+        }
+    }
+    return n;
+}
+
+/* MSM epoch of last message to gps time ---------------------------------------
+* args   : rtcm_con *rtcm   I   rtcm control struct (msm message in buff)
+*          int    *week     IO  gps week (updated on week rollover)
+*          int    *tow      IO  time of week of last epoch (ms) (-1:no)
+* return : gps time (ms since 1980/1/6)
+*-----------------------------------------------------------------------------*/
+static int64_t msm_gpst(const rtcm_con *rtcm, int *week, int *tow)
+{
+    int t=msm_towms(rtcm->cell.sys,getbitu(rtcm->buff,48,30));
+
+    if (*tow>=0&&t<*tow-302400000) (*week)++;
+    else if (*tow>=0&&t>*tow+302400000&&*week>0) (*week)--;
+    *tow=t;
+    return (int64_t)*week*604800000+t;
+}
+
+/* write columnar export chunk ---------------------------------------------*/
+static int col_write(rtcmcol_t *col, const void *data, int size)
+{
+    static const uint8_t pad[8]={0};
+    int npad=(8-size%8)%8; /* columns aligned to 8 bytes */
+
+    if (fwrite(data,1,size,col->fp)<(size_t)size||
+        fwrite(pad,1,npad,col->fp)<(size_t)npad) {
+        trace(2,"col_write: write error\n");
+        return 0;
+    }
+    col->off+=size+npad;
+    return 1;
+}
+
+static int col_flush(rtcmcol_t *col)
+{
+    colchk_con *chk;
+    const void *data[COL_NCOL];
+    int i,n=col->n,size[COL_NCOL];
+
+    if (n<=0) return 1;
+
+    if (col->nchk>=col->nchkmax) {
+        col->nchkmax=col->nchkmax?col->nchkmax*2:64;
+        if (!(chk=(colchk_con *)realloc(col->chk,sizeof(colchk_con)*col->nchkmax))) {
+            trace(1,"col_flush: malloc fail\n");
+            return 0;
+        }
+        col->chk=chk;
+    }
+    chk=col->chk+col->nchk++;
+    chk->nrow=(uint32_t)n;
+    chk->reserved=0;
+    chk->tmin=col->tmin;
+    chk->tmax=col->tmax;
+
+    data[0]=col->epoch; size[0]=n*(int)sizeof(int64_t);
+    data[1]=col->sat;   size[1]=n*(int)sizeof(uint16_t);
+    data[2]=col->sig;   size[2]=n;
+    data[3]=col->P;     size[3]=n*(int)sizeof(double);
+    data[4]=col->L;     size[4]=n*(int)sizeof(double);
+    data[5]=col->D;     size[5]=n*(int)sizeof(float);
+    data[6]=col->SNR;   size[6]=n*(int)sizeof(float);
+    data[7]=col->LLI;   size[7]=n;
+    data[8]=col->lock;  size[8]=n*(int)sizeof(uint16_t);
+
+    for (i=0;i<COL_NCOL;i++) {
+        chk->off[i]=col->off;
+        if (!col_write(col,data[i],size[i])) return 0;
+    }
+    col->n=0;
+    return 1;
+}
+
+/* open columnar export --------------------------------------------------------
+* layout of file (little-endian, every column and table zero-padded to a
+* multiple of 8 bytes):
+*
+*   header : magic "RTCMCOL1", uint32 version (1), uint32 number of columns
+*   chunks : columns of chunk 0, columns of chunk 1, ...
+*   footer : uint32 ncol,nchunk,nsat,nsig
+*            char sat[nsat][4]  (satellite dictionary, "G01",...)
+*            char sig[nsig][4]  (signal dictionary, "1C",...)
+*            nchunk x {uint32 nrow,reserved; int64 tmin,tmax;
+*                      uint64 offset of column[ncol]}
+*   trailer: uint64 offset of footer, magic "RTCMCOL1"
+*
+*   columns: epoch int64 (gps time ms since 1980/1/6), sat uint16, sig uint8,
+*            P double (m), L double (cycle), D float (Hz), SNR float (dBHz),
+*            LLI uint8, lock uint16 (msm lock time indicator, 10 bits in
+*            msm6/7)
+*-----------------------------------------------------------------------------*/
+API_DECLSPEC rtcmcol_t *rtcmcolopen(const char *file,int nrow,int week)
+{
+    rtcmcol_t *col;
+    uint32_t hdr[2]={1,COL_NCOL};
+
+    trace(3,"rtcmcolopen: file=%s nrow=%d week=%d\n",file,nrow,week);
+
+    if (nrow<=0) nrow=65536;
+
+    if (!(col=(rtcmcol_t *)calloc(1,sizeof(rtcmcol_t)))) {
+        trace(1,"rtcmcolopen: malloc fail\n");
+        return NULL;
+    }
+    col->nmax=nrow;
+    col->week=week<0?0:week;
+    col->tow=-1;
+    if (!(col->epoch=(int64_t  *)malloc(sizeof(int64_t )*nrow))||
+        !(col->sat  =(uint16_t *)malloc(sizeof(uint16_t)*nrow))||
+        !(col->sig  =(uint8_t  *)malloc(nrow))||
+        !(col->P    =(double   *)malloc(sizeof(double  )*nrow))||
+        !(col->L    =(double   *)malloc(sizeof(double  )*nrow))||
+        !(col->D    =(float    *)malloc(sizeof(float   )*nrow))||
+        !(col->SNR  =(float    *)malloc(sizeof(float   )*nrow))||
+        !(col->LLI  =(uint8_t  *)malloc(nrow))||
+        !(col->lock =(uint16_t *)malloc(sizeof(uint16_t)*nrow))) {
+        trace(1,"rtcmcolopen: malloc fail\n");
+        rtcmcolclose(col);
+        return NULL;
+    }
+    if (!(col->fp=fopen(file,"wb"))) {
+        trace(1,"rtcmcolopen: file open error: %s\n",file);
+        rtcmcolclose(col);
+        return NULL;
+    }
+    if (!col_write(col,COL_MAGIC,8)||!col_write(col,hdr,sizeof(hdr))) {
+        rtcmcolclose(col);
+        return NULL;
+    }
+    return col;
+}
+
+/* write observation data of last message to columnar export -----------------*/
+API_DECLSPEC int rtcmcolwrite(rtcmcol_t *col,rtcmcvt_t *cvt)
+{
+    rtcm_con *rtcm=&cvt->rtcm;
+    obsd_con *data;
+    int64_t t;
+    int i,j,k,n=0;
+
+    if (rtcm->cell.sys==SYS_NONE||!msm2obs(rtcm)) return 0;
+
+    t=msm_gpst(rtcm,&col->week,&col->tow);
+
+    for (i=0;i<rtcm->obs.n;i++) {
+        data=rtcm->obs.data+i;
+
+        if (data->sat<=0||data->sat>MAXSAT) continue;
+
+        if (!col->satidx[data->sat]) {
+            satno2id(data->sat,col->sats[col->nsat]);
+            col->satidx[data->sat]=++col->nsat;
+        }
+        for (j=0;j<NFREQ+NEXOBS;j++) {
+            if (!data->code[j]||data->code[j]>MAXCODE) continue;
+
+            if (!col->sigidx[data->code[j]]) {
+                strcpy(col->sigs[col->nsig],code2obs(data->code[j]));
+                col->sigidx[data->code[j]]=++col->nsig;
+            }
+            if (col->n>=col->nmax&&!col_flush(col)) return -1;
+            if (col->n==0) col->tmin=col->tmax=t;
+            else if (t<col->tmin) col->tmin=t;
+            else if (t>col->tmax) col->tmax=t;
+
+            k=col->n++;
+            col->epoch[k]=t;
+            col->sat  [k]=(uint16_t)(col->satidx[data->sat]-1);
+            col->sig  [k]=(uint8_t)(col->sigidx[data->code[j]]-1);
+            col->P    [k]=data->P[j];
+            col->L    [k]=data->L[j];
+            col->D    [k]=data->D[j];
+            col->SNR  [k]=(float)(data->SNR[j]*SNR_UNIT);
+            col->LLI  [k]=data->LLI[j];
+            col->lock [k]=(uint16_t)data->locktime[j];
+            n++;
+        }
+    }
+    return n;
+}
+
+/* close columnar export -----------------------------------------------------*/
+API_DECLSPEC int rtcmcolclose(rtcmcol_t *col)
+{
+    uint32_t ftr[4];
+    uint64_t off;
+    int ret=0;
+
+    trace(3,"rtcmcolclose:\n");
+
+    if (!col) return 0;
+
+    if (col->fp) {
+        ret=col_flush(col);
+        off=col->off;
+        ftr[0]=COL_NCOL;
+        ftr[1]=(uint32_t)col->nchk;
+        ftr[2]=(uint32_t)col->nsat;
+        ftr[3]=(uint32_t)col->nsig;
+        ret=ret&&col_write(col,ftr,sizeof(ftr))&&
+            col_write(col,col->sats,col->nsat*4)&&
+            col_write(col,col->sigs,col->nsig*4)&&
+            col_write(col,col->chk,col->nchk*(int)sizeof(colchk_con))&&
+            col_write(col,&off,sizeof(off))&&col_write(col,COL_MAGIC,8);
+        if (fclose(col->fp)) ret=0;
+    }
+    free(col->epoch); free(col->sat); free(col->sig);
+    free(col->P); free(col->L); free(col->D); free(col->SNR);
+    free(col->LLI); free(col->lock); free(col->chk);
+    free(col);
+    return ret;
+}
+
+/* rinex fixed point F14.3 without printf -------------------------------------
+* blank if value is 0 (no data). out of range values are clamped to the field
+* as rtklib does (a negative value has 9 integer digits at most)
+*-----------------------------------------------------------------------------*/
+static char *rnx_f143(char *p, double v)
+{
+    uint64_t x;
+    int i=13;
+
+    memset(p,' ',14);
+    if (v==0.0||v!=v) return p+14;
+    if      (v> 9999999999.999) v= 9999999999.999;
+    else if (v< -999999999.999) v= -999999999.999;
+
+    x=(uint64_t)(fabs(v)*1000.0+0.5);
+    p[i--]=(char)('0'+x%10); x/=10;
+    p[i--]=(char)('0'+x%10); x/=10;
+    p[i--]=(char)('0'+x%10); x/=10;
+    p[i--]='.';
+    do {
+        p[i--]=(char)('0'+x%10); x/=10;
+    } while (x);
+    if (v<0.0) p[i]='-';
+    return p+14;
+}
+
+/* integer to zero-padded decimal -------------------------------------------*/
+static char *rnx_int(char *p, int v, int w)
+{
+    int i;
+
+    for (i=w-1;i>=0;i--) {
+        p[i]=(char)('0'+v%10);
+        v/=10;
+    }
+    return p+w;
+}
+
+/* gps time (ms) to calendar epoch -------------------------------------------*/
+static void rnx_time2ep(int64_t t, int *ep)
+{
+    int64_t z=t/86400000+3657+719468; /* days since 0000/3/1 */
+    int64_t era=z/146097,doe=z-era*146097;
+    int64_t yoe=(doe-doe/1460+doe/36524-doe/146096)/365;
+    int64_t doy=doe-(365*yoe+yoe/4-yoe/100),mp=(5*doy+2)/153;
+    int ms=(int)(t%86400000);
+
+    ep[2]=(int)(doy-(153*mp+2)/5+1);
+    ep[1]=(int)(mp<10?mp+3:mp-9);
+    ep[0]=(int)(yoe+era*400+(ep[1]<=2));
+    ep[3]=ms/3600000;
+    ep[4]=ms/60000%60;
+    ep[5]=ms%60000; /* ms */
+}
+
+/* system index to rinex system code ------------------------------------------*/
+static char rnx_syscode(int s)
+{
+    return "GREJSCI"[s];
+}
+
+/* output rinex epoch record ------------------------------------------------*/
+static int rnx_flush(rtcmrnx_t *rnx)
+{
+    const rnxsat_con *r;
+    char *p=rnx->buff,*q;
+    int i,j,k,s,ep[6];
+
+    if (rnx->t<0||rnx->nsat<=0) return 1;
+
+    rnx_time2ep(rnx->t,ep);
+    *p++='>'; *p++=' ';
+    p=rnx_int(p,ep[0],4); *p++=' ';
+    p=rnx_int(p,ep[1],2); *p++=' ';
+    p=rnx_int(p,ep[2],2); *p++=' ';
+    p=rnx_int(p,ep[3],2); *p++=' ';
+    p=rnx_int(p,ep[4],2);
+    p=rnx_int(p,ep[5]/1000,3); *p++='.';
+    if (p[-4]=='0') p[-4]=' ';
+    if (p[-3]=='0') p[-3]=' ';
+    p=rnx_int(p,ep[5]%1000,3);
+    memcpy(p,"0000  0",7); p+=7;
+    p=rnx_int(p,rnx->nsat,3);
+    if (p[-3]=='0') p[-3]=' ';
+    if (p[-2]=='0'&&p[-3]==' ') p[-2]=' ';
+    *p++='\n';
+
+    for (i=0;i<rnx->nsat;i++) {
+        r=rnx->sat+i;
+        s=systbl(r->sys);
+        satno2id(r->sat,p); p+=3;
+
+        for (j=0;j<rnx->nsig[s];j++) {
+            for (k=0;k<r->n;k++) if (r->code[k]==rnx->sigs[s][j]) break;
+            if (k>=r->n) {
+                memset(p,' ',64); p+=64;
+                continue;
+            }
+            p=rnx_f143(p,r->P[k]); *p++=' '; *p++=' ';
+            p=rnx_f143(p,r->L[k]);
+            *p++=r->LLI[k]?(char)('0'+(r->LLI[k]&7)):' '; *p++=' ';
+            p=rnx_f143(p,r->D[k]); *p++=' '; *p++=' ';
+            p=rnx_f143(p,r->S[k]); *p++=' '; *p++=' ';
+        }
+        for (q=p;q>rnx->buff&&q[-1]==' ';q--) ; /* trim trailing blanks */
+        p=q;
+        *p++='\n';
+    }
+    if (rnx->ts<0) rnx->ts=rnx->t;
+    rnx->te=rnx->t;
+    rnx->nsat=0;
+
+    if (fwrite(rnx->buff,1,p-rnx->buff,rnx->fb)<(size_t)(p-rnx->buff)) {
+        trace(2,"rnx_flush: write error\n");
+        return 0;
+    }
+    return 1;
+}
+
+/* open rinex observation writer -----------------------------------------------*/
+API_DECLSPEC rtcmrnx_t *rtcmrnxopen(const char *file,const char *marker,int week,double ver)
+{
+    rtcmrnx_t *rnx;
+
+    trace(3,"rtcmrnxopen: file=%s week=%d ver=%.2f\n",file,week,ver);
+
+    if (ver!=0.0&&(ver<3.0||ver>=4.0)) {
+        trace(1,"rtcmrnxopen: unsupported rinex version: ver=%.2f\n",ver);
+        return NULL;
+    }
+    if (!(rnx=(rtcmrnx_t *)calloc(1,sizeof(rtcmrnx_t)))||
+        !(rnx->buff=(char *)malloc(MAXOBS*(4+64*RNX_NSIG)+64))) {
+        trace(1,"rtcmrnxopen: malloc fail\n");
+        free(rnx);
+        return NULL;
+    }
+    rnx->ver=ver>0.0?ver:3.04;
+    if (marker) strcpyn(rnx->marker,marker,sizeof(rnx->marker));
+    rnx->week=week<0?0:week;
+    rnx->tow=-1;
+    rnx->t=rnx->ts=rnx->te=-1;
+
+    if (!(rnx->fp=fopen(file,"w"))||!(rnx->fb=tmpfile())) {
+        trace(1,"rtcmrnxopen: file open error: %s\n",file);
+        if (rnx->fp) fclose(rnx->fp);
+        free(rnx->buff);
+        free(rnx);
+        return NULL;
+    }
+    return rnx;
+}
+
+/* write observation data of last message to rinex ---------------------------*/
+API_DECLSPEC int rtcmrnxwrite(rtcmrnx_t *rnx,rtcmcvt_t *cvt)
+{
+    rtcm_con *rtcm=&cvt->rtcm;
+    const obsd_con *data;
+    rnxsat_con *r;
+    uint8_t sel[MAXCODE+1]={0};
+    uint32_t keep;
+    int64_t t;
+    int i,j,k,s,prn,fcn,n=0,sys=rtcm->cell.sys;
+
+    if (sys==SYS_NONE||!msm2obs(rtcm)) return 0;
+
+    t=msm_gpst(rtcm,&rnx->week,&rnx->tow);
+    if (t!=rnx->t) {
+        if (!rnx_flush(rnx)) return -1;
+        rnx->t=t;
+    }
+    /* signals kept by frequency selection */
+    keep=sel_msm_sig(rtcm,sys,&rtcm->cell.h);
+    for (i=0;i<rtcm->cell.h.nsig;i++) {
+        if ((keep>>i)&1) sel[obs2code(msm_sigstr(sys,rtcm->cell.h.sigs[i]))]=1;
+    }
+    s=systbl(sys);
+
+    for (i=0;i<rtcm->obs.n;i++) {
+        data=rtcm->obs.data+i;
+
+        for (j=0;j<rnx->nsat;j++) if (rnx->sat[j].sat==(int)data->sat) break;
+        if (j>=rnx->nsat) {
+            if (rnx->nsat>=MAXOBS) break;
+            r=rnx->sat+rnx->nsat++;
+            r->sat=data->sat;
+            r->sys=sys;
+            r->n=0;
+
+            if (sys==SYS_GLO&&satsys(r->sat,&prn)&&(fcn=glo_fcnget(rtcm,prn))>-8) {
+                rnx->glo_fcn[prn-1]=(uint8_t)(fcn+8);
+            }
+        }
+        else r=rnx->sat+j;
+
+        for (j=0;j<NFREQ+NEXOBS&&r->n<NFREQ+NEXOBS;j++) {
+            if (!data->code[j]||!sel[data->code[j]]) continue;
+
+            /* obs types of system appended on first appearance */
+            for (k=0;k<rnx->nsig[s];k++) if (rnx->sigs[s][k]==data->code[j]) break;
+            if (k>=rnx->nsig[s]) {
+                if (k>=RNX_NSIG) continue;
+                rnx->sigs[s][rnx->nsig[s]++]=data->code[j];
+            }
+            k=r->n++;
+            r->code[k]=data->code[j];
+            r->P  [k]=data->P[j];
+            r->L  [k]=data->L[j];
+            r->D  [k]=data->D[j];
+            r->S  [k]=(float)(data->SNR[j]*SNR_UNIT);
+            r->LLI[k]=data->LLI[j];
+            n++;
+        }
+    }
+    return n;
+}
+
+/* output rinex header line --------------------------------------------------*/
+static void rnx_line(FILE *fp, const char *str, const char *label)
+{
+    fprintf(fp,"%-60.60s%-20s\n",str,label);
+}
+
+/* output rinex observation header -------------------------------------------*/
+static void rnx_header(rtcmrnx_t *rnx)
+{
+    static const char type[]="CLDS";
+    FILE *fp=rnx->fp;
+    char str[128],*p;
+    time_t now=time(NULL);
+    struct tm *tm=gmtime(&now);
+    int i,j,k,n,ep[6];
+
+    sprintf(str,"%9.2f%-11s%-20s%-20s",rnx->ver,"","OBSERVATION DATA","M");
+    rnx_line(fp,str,"RINEX VERSION / TYPE");
+    sprintf(str,"%-20s%-20s%04d%02d%02d %02d%02d%02d UTC",RNX_PGM,"",
+            tm->tm_year+1900,tm->tm_mon+1,tm->tm_mday,tm->tm_hour,tm->tm_min,
+            tm->tm_sec);
+    rnx_line(fp,str,"PGM / RUN BY / DATE");
+    rnx_line(fp,rnx->marker,"MARKER NAME");
+    rnx_line(fp,"","OBSERVER / AGENCY");
+    rnx_line(fp,"","REC # / TYPE / VERS");
+    rnx_line(fp,"","ANT # / TYPE");
+    sprintf(str,"%14.4f%14.4f%14.4f",0.0,0.0,0.0);
+    rnx_line(fp,str,"APPROX POSITION XYZ");
+    rnx_line(fp,str,"ANTENNA: DELTA H/E/N");
+
+    for (i=0;i<7;i++) {
+        if (!rnx->nsig[i]) continue;
+        n=rnx->nsig[i]*4;
+        p=str+sprintf(str,"%c  %3d",rnx_syscode(i),n);
+        for (j=k=0;j<n;j++) {
+            if (k==13) {
+                rnx_line(fp,str,"SYS / # / OBS TYPES");
+                p=str+sprintf(str,"      ");
+                k=0;
+            }
+            p+=sprintf(p," %c%s",type[j%4],code2obs(rnx->sigs[i][j/4]));
+            k++;
+        }
+        rnx_line(fp,str,"SYS / # / OBS TYPES");
+    }
+    if (rnx->ts>=0) {
+        rnx_time2ep(rnx->ts,ep);
+        sprintf(str,"%6d%6d%6d%6d%6d%13.7f     GPS",ep[0],ep[1],ep[2],ep[3],
+                ep[4],ep[5]*1E-3);
+        rnx_line(fp,str,"TIME OF FIRST OBS");
+        rnx_time2ep(rnx->te,ep);
+        sprintf(str,"%6d%6d%6d%6d%6d%13.7f     GPS",ep[0],ep[1],ep[2],ep[3],
+                ep[4],ep[5]*1E-3);
+        rnx_line(fp,str,"TIME OF LAST OBS");
+    }
+    for (i=0;i<7;i++) {
+        if (!rnx->nsig[i]) continue;
+        sprintf(str,"%c",rnx_syscode(i));
+        rnx_line(fp,str,"SYS / PHASE SHIFT");
+    }
+    for (i=n=0;i<32;i++) if (rnx->glo_fcn[i]) n++;
+    p=str+sprintf(str,"%3d",n);
+    for (i=k=0;i<32;i++) {
+        if (!rnx->glo_fcn[i]) continue;
+        if (k==8) {
+            rnx_line(fp,str,"GLONASS SLOT / FRQ #");
+            p=str+sprintf(str,"   ");
+            k=0;
+        }
+        p+=sprintf(p," R%02d %2d",i+1,rnx->glo_fcn[i]-8);
+        k++;
+    }
+    rnx_line(fp,str,"GLONASS SLOT / FRQ #");
+    rnx_line(fp,"","GLONASS COD/PHS/BIS");
+    rnx_line(fp,"","END OF HEADER");
+}
+
+/* close rinex observation writer --------------------------------------------*/
+API_DECLSPEC int rtcmrnxclose(rtcmrnx_t *rnx)
+{
+    char buff[65536];
+    size_t n;
+    int ret;
+
+    trace(3,"rtcmrnxclose:\n");
+
+    if (!rnx) return 0;
+
+    ret=rnx_flush(rnx);
+    rnx_header(rnx);
+
+    /* copy observation records after header */
+    rewind(rnx->fb);
+    while ((n=fread(buff,1,sizeof(buff),rnx->fb))>0) {
+        if (fwrite(buff,1,n,rnx->fp)<n) ret=0;
+    }
+    fclose(rnx->fb);
+    if (fclose(rnx->fp)) ret=0;
+    free(rnx->buff);
+    free(rnx);
+    return ret;
+}
+
+/* RTCM 3 frame index ----------------------------------------------------------
+* layout of index file (little-endian):
+*
+*   header : magic "RTCMIDX1", uint32 version (1), uint32 record size (16)
+*   records: one per frame in order of archive
+*            uint64 offset of frame in archive (bytes)
+*            uint32 epoch (gps time of week,ms). frames other than msm carry
+*                   the epoch of the last msm message before them. epochs
+*                   continue over week rollovers of the archive (+604800000
+*                   per week after the first epoch), so they are monotonic
+*            uint16 message type
+*            uint16 system index (bit 12-15) (0:none,1:GPS,2:GLO,3:GAL,
+*                   4:QZS,5:SBS,6:BDS,7:IRN) and frame length (bit 0-11)
+*-----------------------------------------------------------------------------*/
+
+/* message type to system index of frame index -------------------------------*/
+static int idx_sys(int type)
+{
+    int sys=msmsys(type);
+
+    if (sys==SYS_NONE) {
+        switch (type) {
+            case 1019: sys=SYS_GPS; break;
+            case 1020: sys=SYS_GLO; break;
+            case 1045:
+            case 1046: sys=SYS_GAL; break;
+            case 1044: sys=SYS_QZS; break;
+            case 1042: sys=SYS_CMP; break;
+            case 1041: sys=SYS_IRN; break;
+            default  : return 0;
+        }
+    }
+    return systbl(sys)+1;
+}
+
+/* continuous epoch of msm message -------------------------------------------
+* args   : int64_t t        I   continuous epoch of last msm message (-1:no)
+*          int    sys       I   satellite system
+*          uint32_t epoch   I   msm epoch time
+* return : continuous epoch (ms) (week rollovers after the first epoch added)
+* notes  : glonass epochs with unknown day of week (7) are put on the day
+*          nearest to the last epoch
+*-----------------------------------------------------------------------------*/
+static int64_t idx_time(int64_t t, int sys, uint32_t epoch)
+{
+    int64_t tc;
+    int tow=msm_towms(sys,epoch);
+
+    if (t<0) return tow;
+
+    if (sys==SYS_GLO&&(epoch>>27)==7) {
+        tc=t-t%86400000+tow%86400000;
+        if      (tc<t-43200000) tc+=86400000;
+        else if (tc>t+43200000) tc-=86400000;
+    }
+    else {
+        tc=t-t%604800000+tow;
+        if      (tc<t-302400000) tc+=604800000;
+        else if (tc>t+302400000) tc-=604800000;
+    }
+    if (tc<0) tc=0;
+    if (tc>0xFFFFFFFF) { /* over about 6 weeks of archive */
+        trace(2,"idx_time: epoch overflow\n");
+        tc=0xFFFFFFFF;
+    }
+    return tc;
+}
+
+/* write frame index record --------------------------------------------------*/
+static int idx_write(rtcmidxw_t *w)
+{
+    uint8_t rec[IDX_RSIZE];
+    uint64_t off=w->off-w->len;
+    uint32_t t;
+    int i,type=getbitu(w->buff,24,12),sys=idx_sys(type);
+
+    if (sys&&msmsys(type)!=SYS_NONE&&type%10>=1&&type%10<=7) {
+        w->t=idx_time(w->t,msmsys(type),getbitu(w->buff,48,30));
+    }
+    t=w->t<0?0:(uint32_t)w->t;
+    for (i=0;i<8;i++) rec[i]=(uint8_t)(off>>(8*i));
+    for (i=0;i<4;i++) rec[8+i]=(uint8_t)(t>>(8*i));
+    rec[12]=(uint8_t)type;
+    rec[13]=(uint8_t)(type>>8);
+    rec[14]=(uint8_t)w->len;
+    rec[15]=(uint8_t)(w->len>>8|sys<<4);
+
+    return fwrite(rec,1,IDX_RSIZE,w->fp)==IDX_RSIZE;
+}
+
+/* read frame index record ---------------------------------------------------*/
+static int idx_read(FILE *fp, long long i, rtcmidx_t *idx)
+{
+    uint8_t rec[IDX_RSIZE];
+    int j;
+
+    if (FSEEK64(fp,IDX_HSIZE+i*IDX_RSIZE,SEEK_SET)||
+        fread(rec,1,IDX_RSIZE,fp)<IDX_RSIZE) return 0;
+
+    for (j=7,idx->off=0;j>=0;j--) idx->off=idx->off<<8|rec[j];
+    for (j=3,idx->tow=0;j>=0;j--) idx->tow=idx->tow<<8|rec[8+j];
+    idx->type=rec[12]|rec[13]<<8;
+    idx->len=rec[14]|(rec[15]&0x0F)<<8;
+    idx->sys=rec[15]>>4;
+    return 1;
+}
+
+/* open frame index file -------------------------------------------------------*/
+static FILE *idx_open(const char *file, long long *n)
+{
+    FILE *fp;
+    char hdr[IDX_HSIZE];
+    long long size;
+
+    if (!(fp=fopen(file,"rb"))) {
+        trace(2,"idx_open: file open error: %s\n",file);
+        return NULL;
+    }
+    if (fread(hdr,1,IDX_HSIZE,fp)<IDX_HSIZE||memcmp(hdr,IDX_MAGIC,8)||
+        FSEEK64(fp,0,SEEK_END)||(size=FTELL64(fp))<IDX_HSIZE) {
+        trace(2,"idx_open: index file error: %s\n",file);
+        fclose(fp);
+        return NULL;
+    }
+    *n=(size-IDX_HSIZE)/IDX_RSIZE;
+    return fp;
+}
+
+/* first frame index record at or after epoch (binary search) ----------------*/
+static long long idx_lower(FILE *fp, long long n, int64_t t)
+{
+    rtcmidx_t idx;
+    long long lo=0,hi=n,mid;
+
+    while (lo<hi) {
+        mid=lo+(hi-lo)/2;
+        if (!idx_read(fp,mid,&idx)) return -1;
+        if ((int64_t)idx.tow<t) lo=mid+1; else hi=mid;
+    }
+    return lo;
+}
+
+/* frame index records of epoch window -----------------------------------------
+* args   : FILE   *fp       I   index file
+*          long long n      I   number of index records
+*          uint32_t ts,te   I   epoch window (gps time of week,ms)
+*          long long *i,*j  O   index records i to j-1 of window
+* return : status (1:ok,0:error)
+* notes  : the window is te<ts over the end of week. the stored epochs continue
+*          over week rollovers, so the window is put on the first week of the
+*          archive where it ends after the first epoch
+*-----------------------------------------------------------------------------*/
+static int idx_window(FILE *fp, long long n, uint32_t ts, uint32_t te,
+                      long long *i, long long *j)
+{
+    rtcmidx_t idx;
+    int64_t t0,tl,tw=(int64_t)ts,len=(int64_t)te-ts;
+
+    *i=*j=0;
+    if (te<ts) len+=604800000;
+    if (n<=0||len<=0) return 1;
+    if (!idx_read(fp,0,&idx)) return 0;
+
+    t0=idx.tow;
+    if (tw+len<=t0) tw+=((t0-tw-len)/604800000+1)*604800000;
+    tl=tw+len;
+    return (*i=idx_lower(fp,n,tw))>=0&&(*j=idx_lower(fp,n,tl))>=0;
+}
+
+/* open frame index writer ---------------------------------------------------*/
+API_DECLSPEC rtcmidxw_t *rtcmidxopen(const char *file,unsigned long long off)
+{
+    rtcmidxw_t *w;
+    rtcmidx_t idx;
+    FILE *fp;
+    uint32_t hdr[2]={1,IDX_RSIZE};
+    long long n,size;
+
+    trace(3,"rtcmidxopen: file=%s off=%llu\n",file,off);
+
+    if (!(w=(rtcmidxw_t *)calloc(1,sizeof(rtcmidxw_t)))) {
+        trace(1,"rtcmidxopen: malloc fail\n");
+        return NULL;
+    }
+    if (!(w->fp=fopen(file,"ab"))) {
+        trace(1,"rtcmidxopen: file open error: %s\n",file);
+        free(w);
+        return NULL;
+    }
+    w->off=off;
+    w->t=-1;
+
+    if (FSEEK64(w->fp,0,SEEK_END)||(size=FTELL64(w->fp))<0||
+        (size==0&&(fwrite(IDX_MAGIC,1,8,w->fp)<8||fwrite(hdr,1,8,w->fp)<8))) {
+        trace(1,"rtcmidxopen: file write error: %s\n",file);
+        fclose(w->fp);
+        free(w);
+        return NULL;
+    }
+    /* continue epochs of existing index */
+    if (size>IDX_HSIZE&&(fp=idx_open(file,&n))) {
+        if (n>0&&idx_read(fp,n-1,&idx)) w->t=idx.tow;
+        fclose(fp);
+    }
+    return w;
+}
+
+/* input archive data to frame index writer ----------------------------------*/
+API_DECLSPEC int rtcmidxinput(rtcmidxw_t *w,const unsigned char *data,int n)
+{
+    int i,nrec=0;
+
+    for (i=0;i<n;i++) {
+        w->off++;
+        if (w->nbyte==0) {
+            if (data[i]!=RTCM3PREAMB) continue;
+            w->buff[w->nbyte++]=data[i];
+            continue;
+        }
+        w->buff[w->nbyte++]=data[i];
+
+        if (w->nbyte==3) {
+            w->len=getbitu(w->buff,14,10)+3; /* length without parity */
+            if (w->len+3>(int)sizeof(w->buff)) w->nbyte=0;
+            continue;
+        }
+        if (w->nbyte<3||w->nbyte<w->len+3) continue;
+        w->nbyte=0;
+        w->len+=3;
+
+        if (rtk_crc24q(w->buff,w->len-3)!=getbitu(w->buff,(w->len-3)*8,24)) {
+            trace(3,"rtcmidxinput: parity error: off=%llu\n",w->off-w->len);
+            continue;
+        }
+        if (!idx_write(w)) return -1;
+        nrec++;
+    }
+    if (nrec&&fflush(w->fp)) return -1; /* index kept up to date */
+    return nrec;
+}
+
+/* close frame index writer --------------------------------------------------*/
+API_DECLSPEC int rtcmidxclose(rtcmidxw_t *w)
+{
+    int ret;
+
+    if (!w) return 0;
+    ret=!fclose(w->fp);
+    free(w);
+    return ret;
+}
+
+/* build frame index of archive ----------------------------------------------*/
+API_DECLSPEC int rtcmidxbuild(const char *file,const char *idxfile)
+{
+    rtcmidxw_t *w;
+    FILE *fp;
+    uint8_t buff[65536];
+    size_t n;
+    int nrec=0,ret;
+
+    trace(3,"rtcmidxbuild: file=%s idxfile=%s\n",file,idxfile);
+
+    if (!(fp=fopen(file,"rb"))) {
+        trace(1,"rtcmidxbuild: file open error: %s\n",file);
+        return -1;
+    }
+    remove(idxfile);
+    if (!(w=rtcmidxopen(idxfile,0))) {
+        fclose(fp);
+        return -1;
+    }
+    while ((n=fread(buff,1,sizeof(buff),fp))>0) {
+        if ((ret=rtcmidxinput(w,buff,(int)n))<0) {
+            nrec=-1;
+            break;
+        }
+        nrec+=ret;
+    }
+    fclose(fp);
+    if (!rtcmidxclose(w)) nrec=-1;
+    return nrec;
+}
+
+/* search frame index by epoch and message type ------------------------------*/
+API_DECLSPEC int rtcmidxsearch(const char *idxfile,unsigned int ts,unsigned int te,int type,rtcmidx_t *idx,int nmax)
+{
+    FILE *fp;
+    long long i,j,n;
+    int m=0;
+
+    if (!(fp=idx_open(idxfile,&n))) return -1;
+
+    if (!idx_window(fp,n,ts,te,&i,&j)) m=-1;
+
+    for (;m>=0&&i<j&&m<nmax;i++) {
+        if (!idx_read(fp,i,idx+m)) {
+            m=-1;
+            break;
+        }
+        if (type&&idx[m].type!=type) continue;
+        idx[m++].tow%=604800000;
+    }
+    fclose(fp);
+    return m;
+}
+
+/* archive byte range of epochs ----------------------------------------------*/
+API_DECLSPEC int rtcmidxrange(const char *idxfile,unsigned int ts,unsigned int te,unsigned long long *off,unsigned long long *len)
+{
+    FILE *fp;
+    rtcmidx_t is,ie;
+    long long i,j,n;
+    int ret=0;
+
+    *off=*len=0;
+
+    if (!(fp=idx_open(idxfile,&n))) return -1;
+
+    if (!idx_window(fp,n,ts,te,&i,&j)) ret=-1;
+    else if (i<j&&idx_read(fp,i,&is)&&idx_read(fp,j-1,&ie)) {
+        *off=is.off;
+        *len=ie.off+ie.len-is.off;
+        ret=(int)(j-i);
+    }
+    fclose(fp);
+    return ret;
+}
+
+/* select frame of extraction ------------------------------------------------*/
+static int ext_sel(const ext_con *ext, const rtcmidx_t *idx)
+{
+    int i;
+
+    if (ext->sysmask&&idx->sys&&!(ext->sysmask&(1<<idx->sys))) return 0;
+    if (!ext->types) return 1;
+    for (i=0;i<ext->ntype;i++) {
+        if (ext->types[i]==idx->type) return 1;
+    }
+    return 0;
+}
+
+/* frame of extraction converted (msm or ssr) --------------------------------*/
+static int ext_cvt(int type)
+{
+    int msg;
+
+    return (msmsys(type)!=SYS_NONE&&type%10>=1&&type%10<=7)||
+           ssrsys(type,&msg)!=SYS_NONE;
+}
+
+/* extract frames of archive file --------------------------------------------
+* find the epoch window by the frame index and read the archive byte range of
+* the window in blocks of EXT_NBUF with sequential reads. selected msm and ssr
+* frames are converted with a converter of the file, other frames are copied
+* as they are as by the relay, and written to the output file
+*-----------------------------------------------------------------------------*/
+static int ext_file(const ext_con *ext, int k)
+{
+    rtcmcvt_t *cvt=NULL;
+    rtcmidx_t idx;
+    FILE *fi=NULL,*fa=NULL,*fo=NULL;
+    uint8_t *buff=NULL,*p,out[1200];
+    uint64_t base=0,end=0;
+    size_t nbuf=0,m;
+    long long i=0,j=0,n;
+    char idxfile[1024];
+    int nused,nsd,len,ret,nout=0;
+
+    trace(3,"ext_file: file=%s\n",ext->files[k]);
+
+    snprintf(idxfile,sizeof(idxfile),"%s%s",ext->files[k],IDX_EXT);
+
+    if (!(fi=idx_open(idxfile,&n))) return -1;
+
+    if (!idx_window(fi,n,ext->ts,ext->te,&i,&j)||
+        (i<j&&!idx_read(fi,j-1,&idx))) {
+        nout=-1;
+    }
+    else if (i<j) end=idx.off+idx.len;
+
+    if (nout<0) ;
+    else if (!(fo=fopen(ext->outfiles[k],"wb"))) {
+        trace(1,"ext_file: file open error: %s\n",ext->outfiles[k]);
+        nout=-1;
+    }
+    else if (i<j&&!(fa=fopen(ext->files[k],"rb"))) {
+        trace(1,"ext_file: file open error: %s\n",ext->files[k]);
+        nout=-1;
+    }
+    else if (i<j&&(!(buff=(uint8_t *)malloc(EXT_NBUF))||
+                   (ext->freq_c&&!(cvt=rtcmcvtopen())))) {
+        trace(1,"ext_file: malloc fail\n");
+        nout=-1;
+    }
+    for (;nout>=0&&i<j;i++) {
+        if (!idx_read(fi,i,&idx)) {
+            nout=-1;
+            break;
+        }
+        if (!ext_sel(ext,&idx)) continue;
+
+        if (idx.off<base||idx.off+idx.len>base+nbuf) { /* next block */
+            m=end-idx.off<EXT_NBUF?(size_t)(end-idx.off):EXT_NBUF;
+            base=idx.off;
+            if (FSEEK64(fa,base,SEEK_SET)||(nbuf=fread(buff,1,m,fa))<(size_t)idx.len) {
+                trace(2,"ext_file: archive read error: %s off=%llu\n",ext->files[k],base);
+                nout=-1;
+                break;
+            }
+        }
+        p=buff+(idx.off-base);
+        len=idx.len;
+
+        if (p[0]!=RTCM3PREAMB||(int)getbitu(p,14,10)+6!=len) {
+            trace(2,"ext_file: index not match archive: %s off=%llu\n",ext->files[k],idx.off);
+            nout=-1;
+            break;
+        }
+        /* frames other than msm and ssr output as they are */
+        if (!cvt||!ext_cvt(idx.type)) {
+            if (fwrite(p,1,len,fo)<(size_t)len) nout=-1; else nout++;
+            continue;
+        }
+        for (;len>0;p+=nused,len-=nused) {
+            if ((ret=rtcmcvtinputs(cvt,p,len,&nused,ext->freq_c,out,&nsd))==-2) break;
+            if (ret<=0||nsd<=0) continue;
+            if (fwrite(out,1,nsd,fo)<(size_t)nsd) nout=-1; else nout++;
+        }
+    }
+    if (fo&&fclose(fo)) nout=-1;
+    if (fa) fclose(fa);
+    fclose(fi);
+    free(buff);
+    if (cvt) rtcmcvtclose(cvt);
+    return nout;
+}
+
+/* extraction worker thread --------------------------------------------------*/
+#ifdef _WIN32
+static DWORD WINAPI ext_thread(void *arg)
+#else
+static void *ext_thread(void *arg)
+#endif
+{
+    ext_con *ext=(ext_con *)arg;
+    long k;
+
+    while ((k=JOB_NEXT(ext->next))<ext->nfile) {
+        ext->nout[k]=ext_file(ext,(int)k);
+    }
+    return 0;
+}
+
+/* extract frames of archives by epoch window --------------------------------*/
+API_DECLSPEC int rtcmextract(const char **files,const char **outfiles,int nfile,unsigned int ts,unsigned int te,const int *types,int ntype,const char *sys,char **freq_c,int nthread,int *nout)
+{
+#ifdef _WIN32
+    HANDLE thr[EXT_MAXTHR];
+#else
+    pthread_t thr[EXT_MAXTHR];
+#endif
+    static const char syscode[]="GREJSCI"; /* order of frame index */
+    ext_con ext={0};
+    rtcmprof_t *prof;
+    const char *q;
+    int i,nthr=0,nfrm=0,*n=nout;
+
+    trace(3,"rtcmextract: nfile=%d ts=%u te=%u nthread=%d\n",nfile,ts,te,nthread);
+
+    if (nfile<=0) return 0;
+    if (freq_c) { /* unknown frequency */
+        if (!(prof=rtcmprofnew(freq_c))) return -1;
+        rtcmproffree(prof);
+    }
+    if (!n&&!(n=(int *)calloc(nfile,sizeof(int)))) {
+        trace(1,"rtcmextract: malloc fail\n");
+        return -1;
+    }
+    ext.files=files;
+    ext.outfiles=outfiles;
+    ext.nfile=nfile;
+    ext.ts=ts;
+    ext.te=te;
+    ext.types=ntype>0?types:NULL;
+    ext.ntype=ntype;
+    ext.freq_c=freq_c;
+    ext.nout=n;
+    for (;sys&&*sys;sys++) {
+        if ((q=strchr(syscode,*sys))) ext.sysmask|=1<<(int)(q-syscode+1);
+    }
+    if (nthread<=0) nthread=1;
+    if (nthread>EXT_MAXTHR) nthread=EXT_MAXTHR;
+    if (nthread>nfile) nthread=nfile;
+
+    for (i=1;i<nthread;i++,nthr++) { /* caller is the first worker */
+#ifdef _WIN32
+        if (!(thr[nthr]=CreateThread(NULL,0,ext_thread,&ext,0,NULL))) break;
+#else
+        if (pthread_create(thr+nthr,NULL,ext_thread,&ext)) break;
+#endif
+    }
+    ext_thread(&ext);
+
+    for (i=0;i<nthr;i++) {
+#ifdef _WIN32
+        WaitForSingleObject(thr[i],INFINITE);
+        CloseHandle(thr[i]);
+#else
+        pthread_join(thr[i],NULL);
+#endif
+    }
+    for (i=0;i<nfile;i++) {
+        if (n[i]<0) {
+            trace(2,"rtcmextract: extraction error: %s\n",files[i]);
+            nfrm=-1;
+        }
+        else if (nfrm>=0) nfrm+=n[i];
+    }
+    if (n!=nout) free(n);
+    return nfrm;
+}
+
+/* compressed RTCM 3 archive ---------------------------------------------------
+* layout of archive file (little-endian):
+*
+*   header : magic "RTCMARC1", uint32 version (1), uint32 number of streams
+*   blocks : uint32 number of records, uint32 restored bytes,
+*            uint32 length of streams (bits) x number of streams,
+*            streams (each padded to byte)
+*
+* a record is a frame or up to 1029 bytes of data out of frames. the frame
+* stream holds the record kind and message type (move-to-front list of recent
+* types). msm4-7 messages are split to the header stream (station id, epoch,
+* info and masks, coded as same as last message of the system if unchanged),
+* satellite streams (rough range, extended info, rough rate) and cell streams
+* (fine pseudorange, fine phaserange, lock time, half-cycle, cnr, fine rate).
+* rough range and phaserange are predicted linearly from the last two epochs
+* of the satellite or signal, phaserange of other signals of the satellite by
+* the change of the first signal, pseudorange by the change of phaserange and
+* the other fields by the last epoch. fields without state are stored as they
+* are. residuals are coded by adaptive rice codes with the parameter of the
+* stream. other frames and data out of frames are stored in the raw stream.
+* states are reset at each block
+*-----------------------------------------------------------------------------*/
+#define ARC_MAGIC   "RTCMARC1"  /* magic of compressed archive file */
+#define ARC_NSTR    12          /* number of streams of archive block */
+#define ARC_NREC    4096        /* max number of records of archive block */
+#define ARC_NBYTE   1048576     /* max restored bytes of archive block */
+#define ARC_NMTF    16          /* number of recent message types */
+#define ARC_QMAX    24          /* max quotient of rice code (escape) */
+#define ARC_NADP    64          /* adaptation window of rice parameter */
+
+enum {                  /* streams of archive block */
+    ARC_FRM,ARC_RAW,ARC_HDR,ARC_RR,ARC_EX,ARC_RATE,ARC_PR,ARC_CP,ARC_LOCK,
+    ARC_HALF,ARC_CNR,ARC_RRV
+};
+
+typedef struct {        /* archive field stream type */
+    uint8_t *buff;      /* stream data */
+    int size;           /* size of buffer (bytes) (writer) */
+    bitw_con w;         /* bit writer (writer) */
+    int pos,nbit;       /* read position/number of bits (reader) */
+    int err;            /* error (malloc or read beyond stream) */
+    uint64_t A,N;       /* sum of values/number of values of rice parameter */
+} arc_str_con;
+
+typedef struct {        /* archive satellite state type */
+    int nep;            /* number of epochs (0:no state) */
+    int32_t rr[2];      /* rough range of last two epochs (2^-10 ms) */
+    int32_t ex,rate;    /* extended info/rough phaserange rate */
+} arc_sat_con;
+
+typedef struct {        /* archive signal cell state type */
+    int nep,type;       /* number of epochs (0:no state)/message type */
+    int64_t pr[2],cp[2]; /* pseudorange/phaserange of last two epochs */
+    int32_t lock,cnr;   /* lock time indicator/cnr */
+    int64_t rate;       /* phaserange rate (0.0001 m/s) */
+} arc_cel_con;
+
+typedef struct {        /* archive system state type */
+    int nep;            /* number of messages (0:no state) */
+    uint32_t staid,info; /* station id/iods..smoothing interval */
+    uint32_t epoch[2];  /* epoch of last two messages */
+    uint64_t satm,cellm; /* satellite/cell mask */
+    uint32_t sigm;      /* signal mask */
+    arc_sat_con sat[64]; /* satellite states by satellite id */
+    arc_cel_con cel[64][32]; /* cell states by satellite id and signal id */
+} arc_sys_con;
+
+typedef struct {        /* archive block codec type */
+    arc_str_con str[ARC_NSTR]; /* field streams */
+    int mtf[ARC_NMTF];  /* recent message types */
+    int nrec,nbyte;     /* number of records/restored bytes of block */
+    arc_sys_con sys[7]; /* states of systems */
+} arc_con;
+
+typedef struct {        /* archive msm message type */
+    int type,nsat,nsig,ncell; /* message type/number of satellites/signals/cells */
+    uint32_t staid,epoch,sync,info; /* station id/epoch/sync/iods..smoothing int */
+    uint64_t satm,cellm; /* satellite/cell mask (bit n: n-th in message) */
+    uint32_t sigm;      /* signal mask */
+    uint8_t sat[64],sig[32]; /* satellite/signal ids */
+    int32_t rr[64],ex[64],rate[64]; /* satellite fields */
+    int32_t pr[64],cp[64],lock[64],half[64],cnr[64],rrv[64]; /* cell fields */
+} arc_msm_con;
+
+struct rtcmarcw_tag {   /* compressed archive writer type */
+    FILE *fp;           /* archive file */
+    int nb,nraw;        /* bytes in frame buffer/data out of frames */
+    uint8_t buff[MAXRTCMLEN]; /* frame buffer */
+    uint8_t raw[MAXRTCMLEN]; /* data out of frames */
+    arc_con c;          /* block codec */
+};
+
+struct rtcmarcr_tag {   /* compressed archive reader type */
+    FILE *fp;           /* archive file */
+    uint8_t *data;      /* stream data of block */
+    int nrec;           /* number of records of block */
+    arc_con c;          /* block codec */
+};
+
+/* zigzag mapping of signed value --------------------------------------------*/
+static uint64_t arc_zz(int64_t v)
+{
+    return v<0?((uint64_t)(-(v+1))<<1)|1:(uint64_t)v<<1;
+}
+static int64_t arc_unzz(uint64_t u)
+{
+    return (u&1)?-(int64_t)(u>>1)-1:(int64_t)(u>>1);
+}
+
+/* rice parameter of stream --------------------------------------------------*/
+static int arc_k(const arc_str_con *s)
+{
+    int k=0;
+
+    while ((s->N<<k)<s->A&&k<48) k++;
+    return k;
+}
+static void arc_adapt(arc_str_con *s, uint64_t u)
+{
+    s->A+=u;
+    if (++s->N>=ARC_NADP) {
+        s->A>>=1;
+        s->N>>=1;
     }
-    /* message length (header+data) (bytes) */
-    if ((rtcm->lensd=i/8)>=3+1024) {
-        trace(2,"generate rtcm 3 message length error len=%d\n",rtcm->len-3);
-        rtcm->nbit=rtcm->lensd=0;
+}
+
+/* put raw bits/rice code to stream ------------------------------------------*/
+static void arc_putb(arc_str_con *s, uint64_t v, int n)
+{
+    uint8_t *p;
+
+    if (s->w.pos+16>s->size) {
+        if (!(p=(uint8_t *)realloc(s->buff,s->size*2))) {
+            s->err=1;
+            return;
+        }
+        s->buff=s->w.buff=p;
+        s->size*=2;
+    }
+    if (n>32) {
+        bitw_put(&s->w,(uint32_t)(v>>32),n-32);
+        n=32;
+    }
+    if (n>0) bitw_put(&s->w,(uint32_t)v,n);
+}
+static void arc_putu(arc_str_con *s, uint64_t u)
+{
+    int k=arc_k(s),nb;
+
+    if ((u>>k)<ARC_QMAX) {
+        arc_putb(s,1,(int)(u>>k)+1);
+        arc_putb(s,u,k);
+    }
+    else { /* escape */
+        for (nb=1;nb<64&&(u>>nb);nb++) ;
+        arc_putb(s,0,ARC_QMAX);
+        arc_putb(s,nb-1,6);
+        arc_putb(s,u,nb);
+    }
+    arc_adapt(s,u);
+}
+
+/* get raw bits/rice code from stream ----------------------------------------*/
+static uint64_t arc_getb(arc_str_con *s, int n)
+{
+    uint64_t v=0;
+
+    if (n<=0) return 0;
+    if (s->pos+n>s->nbit) {
+        s->err=1;
+        s->pos=s->nbit;
         return 0;
     }
-    /* message length without header and parity */
-    setbitu(rtcm->buffsd,14,10,rtcm->lensd-3);
+    if (n>32) {
+        v=(uint64_t)getbitu(s->buff,s->pos,n-32)<<32;
+        s->pos+=n-32;
+        n=32;
+    }
+    v|=getbitu(s->buff,s->pos,n);
+    s->pos+=n;
+    return v;
+}
+static uint64_t arc_getu(arc_str_con *s)
+{
+    uint64_t u;
+    uint32_t v;
+    int k=arc_k(s),n=ARC_QMAX,q;
+
+    if (s->nbit-s->pos<n) n=s->nbit-s->pos;
+    if (n<=0||!(v=getbitu(s->buff,s->pos,n))) {
+        if (n<ARC_QMAX) {
+            s->err=1;
+            return 0;
+        }
+        s->pos+=ARC_QMAX; /* escape */
+        u=arc_getb(s,(int)arc_getb(s,6)+1);
+    }
+    else {
+        for (q=0;!((v>>(n-1-q))&1);q++) ;
+        s->pos+=q+1;
+        u=((uint64_t)q<<k)|arc_getb(s,k);
+    }
+    arc_adapt(s,u);
+    return u;
+}
 
-    /* crc-24q */
-    crc=rtk_crc24q(rtcm->buffsd,rtcm->lensd);
-    setbitu(rtcm->buffsd,i,24,crc);
+/* code field as raw bits or as residual of prediction -----------------------
+* encode (dec=0) or decode (dec=1) field x. the decoded field is returned
+*-----------------------------------------------------------------------------*/
+static int64_t arc_bits(arc_str_con *s, int dec, int64_t x, int n, int sgn)
+{
+    uint64_t v;
 
-    /* length total (bytes) */
-//    rtcm->nbyte=rtcm->len+3;
-//    rtcm->nbyte=rtcm->len+3;
+    if (!dec) {
+        arc_putb(s,(uint64_t)x,n);
+        return x;
+    }
+    v=arc_getb(s,n);
+    return sgn&&(v>>(n-1))?(int64_t)v-((int64_t)1<<n):(int64_t)v;
+}
+static int64_t arc_res(arc_str_con *s, int dec, int64_t x, int64_t pred)
+{
+    if (!dec) {
+        arc_putu(s,arc_zz(x-pred));
+        return x;
+    }
+    return pred+arc_unzz(arc_getu(s));
+}
 
-    return 1;
+/* reset block codec ---------------------------------------------------------*/
+static void arc_reset(arc_con *c)
+{
+    int i;
+
+    for (i=0;i<ARC_NSTR;i++) {
+        bitw_init(&c->str[i].w,c->str[i].buff,0);
+        c->str[i].pos=c->str[i].err=0;
+        c->str[i].A=16;
+        c->str[i].N=1;
+    }
+    memset(c->mtf,0,sizeof(c->mtf));
+    memset(c->sys,0,sizeof(c->sys));
+    c->nrec=c->nbyte=0;
 }
 
-/* convert RTCM 3 message -----------------------------------------------------
-* generate RTCM 3 message
-* args   : uint8_t *buff_in I   rtcm binary data
-*          int    len       I   length of received rtcm data
-*          char  **freq_c   I   sent frequency
-*          uint8_t *buff_sd o   converted rtcm data (need to be sent)
-*          int    *len_sd   o   results length
-* return : status (1:ok,0,-1:error or no rtcm data)
-*
-* freq_c selection :
-*
-* "L1", "L2", "L5",                            GPS
-* "G1", "G2", "G3", "G1a","G2a",               GLO
-* "E1", "E5b","E5a","E6", "E5ab",              GAL
-* "L1", "L2", "L5", "L6",                      QZS
-* "L1", "L5",                                  SBS
-* "B1I","B3I","B2a","B1C","B2ab","B2I", "B2b", BDS
-* "L5", "S",                                   IRN
-*
-* freq_c format: char *freq_c[7]={
-*                    "L1",                     //GPS
-*                    "",                       //GLONASS
-*                    "E1+E5b",                 //Galileo
-*                    "L1+L2",                  //QZSS
-*                    "L1+L5",                  //SBAS
-*                    "B1I+B2I+B3I",            //BDS
-*                    "L5+S"                    //IRN
-*                   };
-* note: Taking the above as an example, the rtcm data will be encoded:
-* GPS L1 data will be obtained, while the corresponding L2 and L3 are discarded.
-* GLONASS no data will be sent;
-* BDS B1I, B2I, B3I will be obtained in new rtcm buff.
-* "G3", "G1a","G2a" in rtcm ICD are not provided. therefore, please do not choose the three.
+/* stream error of block codec -----------------------------------------------*/
+static int arc_err(const arc_con *c)
+{
+    int i;
+
+    for (i=0;i<ARC_NSTR;i++) {
+        if (c->str[i].err) return 1;
+    }
+    return 0;
+}
+
+/* move message type to front of recent types (-1:not in list) ---------------*/
+static int arc_mtf(arc_con *c, int type)
+{
+    int i,found;
+
+    for (i=0;i<ARC_NMTF-1&&c->mtf[i]!=type;i++) ;
+    found=c->mtf[i]==type;
+    memmove(c->mtf+1,c->mtf,i*sizeof(int));
+    c->mtf[0]=type;
+    return found?i:-1;
+}
+
+/* message type coded as msm -------------------------------------------------*/
+static int arc_msmtype(int type)
+{
+    return msmsys(type)!=SYS_NONE&&type%10>=4&&type%10<=7;
+}
+
+/* unpack MSM4-7 frame -------------------------------------------------------
+* return : status (1:ok,0:not restored by arc_pack())
 *-----------------------------------------------------------------------------*/
+static int arc_unpack(const uint8_t *buff, int len, arc_msm_con *m)
+{
+    int i=24,j,n,hi,ex,nbit=(len-3)*8;
+
+    if (getbitu(buff,8,6)||len<6+22) return 0; /* reserved bits */
+
+    m->type =getbitu(buff,i,12); i+=12;
+    m->staid=getbitu(buff,i,12); i+=12;
+    m->epoch=getbitu(buff,i,30); i+=30;
+    m->sync =getbitu(buff,i, 1); i+= 1;
+    m->info =getbitu(buff,i,18); i+=18;
+    m->satm =(uint64_t)getbitu(buff,i,32)<<32; i+=32;
+    m->satm|=getbitu(buff,i,32); i+=32;
+    m->sigm =getbitu(buff,i,32); i+=32;
+    m->nsat=popcnt64(m->satm);
+    m->nsig=popcnt64(m->sigm);
+    if (m->nsat*m->nsig>64||i+m->nsat*m->nsig>nbit) return 0;
+
+    for (j=0,m->cellm=0;j<m->nsat*m->nsig;j++) {
+        if (getbitu(buff,i++,1)) m->cellm|=(uint64_t)1<<j;
+    }
+    m->ncell=popcnt64(m->cellm);
+    hi=m->type%10>=6;
+    ex=m->type%10==5||m->type%10==7;
+
+    /* frame restored only with minimum length and zero padding */
+    n=i+m->nsat*(ex?36:18)+m->ncell*((hi?65:48)+(ex?15:0));
+    if (n>nbit||(n+7)/8!=len-3||(n<nbit&&getbitu(buff,n,nbit-n))) return 0;
+
+    for (j=0;j<m->nsat;j++,i+=8) m->rr[j]=(int32_t)getbitu(buff,i,8)<<10;
+    if (ex) for (j=0;j<m->nsat;j++,i+=4) m->ex[j]=getbitu(buff,i,4);
+    for (j=0;j<m->nsat;j++,i+=10) m->rr[j]|=getbitu(buff,i,10);
+    if (ex) for (j=0;j<m->nsat;j++,i+=14) m->rate[j]=getbits(buff,i,14);
+
+    n=m->ncell;
+    for (j=0;j<n;j++,i+=hi?20:15) m->pr  [j]=getbits(buff,i,hi?20:15);
+    for (j=0;j<n;j++,i+=hi?24:22) m->cp  [j]=getbits(buff,i,hi?24:22);
+    for (j=0;j<n;j++,i+=hi?10: 4) m->lock[j]=getbitu(buff,i,hi?10:4);
+    for (j=0;j<n;j++,i++        ) m->half[j]=getbitu(buff,i,1);
+    for (j=0;j<n;j++,i+=hi?10: 6) m->cnr [j]=getbitu(buff,i,hi?10:6);
+    if (ex) for (j=0;j<n;j++,i+=15) m->rrv[j]=getbits(buff,i,15);
+    return 1;
+}
 
+/* pack MSM4-7 frame (length of frame (bytes)) -------------------------------*/
+static int arc_pack(const arc_msm_con *m, uint8_t *buff)
+{
+    bitw_con w;
+    uint32_t crc;
+    int j,n=m->ncell,len,hi=m->type%10>=6,ex=m->type%10==5||m->type%10==7;
+
+    buff[0]=RTCM3PREAMB;
+    bitw_init(&w,buff,24);
+    bitw_put(&w,m->type ,12);
+    bitw_put(&w,m->staid,12);
+    bitw_put(&w,m->epoch,30);
+    bitw_put(&w,m->sync , 1);
+    bitw_put(&w,m->info ,18);
+    bitw_put(&w,(uint32_t)(m->satm>>32),32);
+    bitw_put(&w,(uint32_t)m->satm,32);
+    bitw_put(&w,m->sigm ,32);
+    for (j=0;j<m->nsat*m->nsig;j++) bitw_put(&w,(uint32_t)(m->cellm>>j)&1,1);
+
+    for (j=0;j<m->nsat;j++) bitw_put(&w,m->rr[j]>>10,8);
+    if (ex) for (j=0;j<m->nsat;j++) bitw_put(&w,m->ex[j],4);
+    for (j=0;j<m->nsat;j++) bitw_put(&w,m->rr[j],10);
+    if (ex) for (j=0;j<m->nsat;j++) bitw_put(&w,m->rate[j],14);
+
+    for (j=0;j<n;j++) bitw_put(&w,m->pr  [j],hi?20:15);
+    for (j=0;j<n;j++) bitw_put(&w,m->cp  [j],hi?24:22);
+    for (j=0;j<n;j++) bitw_put(&w,m->lock[j],hi?10: 4);
+    for (j=0;j<n;j++) bitw_put(&w,m->half[j],1);
+    for (j=0;j<n;j++) bitw_put(&w,m->cnr [j],hi?10: 6);
+    if (ex) for (j=0;j<n;j++) bitw_put(&w,m->rrv[j],15);
+
+    len=(bitw_end(&w)+7)/8; /* header and message (bytes) */
+    buff[1]=(uint8_t)((len-3)>>8);
+    buff[2]=(uint8_t)(len-3);
+    crc=rtk_crc24q(buff,len);
+    buff[len  ]=(uint8_t)(crc>>16);
+    buff[len+1]=(uint8_t)(crc>> 8);
+    buff[len+2]=(uint8_t)crc;
+    return len+3;
+}
 
-API_DECLSPEC int rtcmCvt(int sync,unsigned char *buff_in,int len,char **freq_c,unsigned char *buff_sd,int *len_sd){
-    int ret,stringlen,type;
-//    double len_dbe;
-    /*char _freq_def[7][20]={
-        "L1+L2",
-        "G1+G2",
-        "E1+E5b",
-        "L1+L2",
-        "L1+L5",
-        "B1I+B3I",
-        "L5+S"
-    }; */// default frequencies
-    char _freq_sel[40],_freq_ext[40];
+/* encode/decode MSM4-7 message fields ---------------------------------------
+* encode (dec=0) or decode (dec=1) msm message m with the state of the system.
+* encoder and decoder share this function, so predictions are always the same
+* return : status (1:ok,0:error)
+*-----------------------------------------------------------------------------*/
+static int arc_msm(arc_con *c, arc_msm_con *m, int dec)
+{
+    arc_sys_con *st=c->sys+systbl(msmsys(m->type));
+    arc_str_con *s=c->str;
+    arc_sat_con *ss;
+    arc_cel_con *cs;
+    uint64_t n;
+    int64_t pred,r,rp,rc,cp,pr,rt,cpl=0,cpl1=0;
+    int i,j,k,isat=-1,lead=0,fresh,hi=m->type%10>=6;
+    int ex=m->type%10==5||m->type%10==7,scp=hi?21:19,spr=hi?19:14,rcp=hi?4:32;
+
+    /* header and masks */
+    if (arc_bits(s+ARC_HDR,dec,!dec&&st->nep&&m->staid==st->staid,1,0)) {
+        m->staid=st->staid;
+    }
+    else m->staid=(uint32_t)arc_bits(s+ARC_HDR,dec,m->staid,12,0);
 
-    rtcm_con rtcm_in;
+    if (!st->nep) m->epoch=(uint32_t)arc_bits(s+ARC_HDR,dec,m->epoch,30,0);
+    else {
+        pred=(st->nep>=2?2*(int64_t)st->epoch[0]-st->epoch[1]:st->epoch[0])&0x3FFFFFFF;
+        r=(((m->epoch-pred)&0x3FFFFFFF)^0x20000000)-0x20000000; /* modulo 2^30 */
+        m->epoch=(uint32_t)((pred+arc_res(s+ARC_HDR,dec,r,0))&0x3FFFFFFF);
+    }
+    m->sync=(uint32_t)arc_bits(s+ARC_HDR,dec,m->sync,1,0);
+
+    if (arc_bits(s+ARC_HDR,dec,!dec&&st->nep&&m->info==st->info,1,0)) {
+        m->info=st->info;
+    }
+    else m->info=(uint32_t)arc_bits(s+ARC_HDR,dec,m->info,18,0);
 
-    for (int i=0;i<7;i++){
-        memcpy(_freq_ext,freq_c[i],40*sizeof(char));
-        stringlen = strlen(_freq_ext);
-        if(strlen(_freq_ext)==0){
-//            memcpy(_freq_sel,_freq_def[i],20*sizeof(char)); //if default, please uncomment the line, comment the next line.
-            _freq_sel[0]='\0';
+    if (arc_bits(s+ARC_HDR,dec,!dec&&st->nep&&m->satm==st->satm&&
+                 m->sigm==st->sigm&&m->cellm==st->cellm,1,0)) {
+        m->satm=st->satm;
+        m->sigm=st->sigm;
+        m->cellm=st->cellm;
+    }
+    else {
+        m->satm=(uint64_t)arc_bits(s+ARC_HDR,dec,(int64_t)m->satm,64,0);
+        m->sigm=(uint32_t)arc_bits(s+ARC_HDR,dec,m->sigm,32,0);
+        if (popcnt64(m->satm)*popcnt64(m->sigm)>64) return 0;
+        m->cellm=(uint64_t)arc_bits(s+ARC_HDR,dec,(int64_t)m->cellm,
+                                    popcnt64(m->satm)*popcnt64(m->sigm),0);
+    }
+    m->nsat=m->nsig=0;
+    for (j=0;j<64;j++) if ((m->satm>>(63-j))&1) m->sat[m->nsat++]=(uint8_t)(j+1);
+    for (j=0;j<32;j++) if ((m->sigm>>(31-j))&1) m->sig[m->nsig++]=(uint8_t)(j+1);
+    m->ncell=popcnt64(m->cellm);
+
+    st->epoch[1]=st->epoch[0];
+    st->epoch[0]=m->epoch;
+    st->staid=m->staid;
+    st->info=m->info;
+    st->satm=m->satm;
+    st->sigm=m->sigm;
+    st->cellm=m->cellm;
+    st->nep=st->nep<2?st->nep+1:2;
+
+    /* satellite fields */
+    for (j=0;j<m->nsat;j++) {
+        ss=st->sat+m->sat[j]-1;
+        if (!ss->nep) {
+            m->rr[j]=(int32_t)arc_bits(s+ARC_RR,dec,m->rr[j],18,0);
+            if (ex) {
+                m->ex  [j]=(int32_t)arc_bits(s+ARC_EX  ,dec,m->ex  [j], 4,0);
+                m->rate[j]=(int32_t)arc_bits(s+ARC_RATE,dec,m->rate[j],14,1);
+            }
+        }
+        else {
+            pred=ss->nep>=2?2*(int64_t)ss->rr[0]-ss->rr[1]:ss->rr[0];
+            m->rr[j]=(int32_t)arc_res(s+ARC_RR,dec,m->rr[j],pred);
+            if (ex) {
+                m->ex  [j]=(int32_t)arc_res(s+ARC_EX  ,dec,m->ex  [j],ss->ex  );
+                m->rate[j]=(int32_t)arc_res(s+ARC_RATE,dec,m->rate[j],ss->rate);
+            }
+        }
+        ss->rr[1]=ss->rr[0];
+        ss->rr[0]=m->rr[j];
+        if (ex) {
+            ss->ex=m->ex[j];
+            ss->rate=m->rate[j];
+        }
+        ss->nep=ss->nep<2?ss->nep+1:2;
+    }
+    /* cell fields */
+    for (k=0,n=m->cellm;n;k++,n&=n-1) {
+        i=ctz64(n);
+        if (i/m->nsig!=isat) { /* first cell of satellite */
+            isat=i/m->nsig;
+            lead=0;
+        }
+        cs=st->cel[m->sat[isat]-1]+m->sig[i%m->nsig]-1;
+        fresh=!cs->nep||cs->type!=m->type;
+        rc=(int64_t)m->rr[isat]*((int64_t)1<<scp);
+        rp=(int64_t)m->rr[isat]*((int64_t)1<<spr);
+
+        if (fresh) {
+            m->cp  [k]=(int32_t)arc_bits(s+ARC_CP  ,dec,m->cp  [k],hi?24:22,1);
+            m->pr  [k]=(int32_t)arc_bits(s+ARC_PR  ,dec,m->pr  [k],hi?20:15,1);
+            m->lock[k]=(int32_t)arc_bits(s+ARC_LOCK,dec,m->lock[k],hi?10: 4,0);
+            m->half[k]=(int32_t)arc_bits(s+ARC_HALF,dec,m->half[k],1,0);
+            m->cnr [k]=(int32_t)arc_bits(s+ARC_CNR ,dec,m->cnr [k],hi?10: 6,0);
+            if (ex) m->rrv[k]=(int32_t)arc_bits(s+ARC_RRV,dec,m->rrv[k],15,1);
+            cs->nep=0;
+            cs->type=m->type;
         }
         else {
-            memcpy(_freq_sel,_freq_ext,40*sizeof(char));
+            /* phaserange by first signal of satellite or last two epochs */
+            if (lead) pred=cs->cp[0]+cpl-cpl1;
+            else pred=cs->nep>=2?2*cs->cp[0]-cs->cp[1]:cs->cp[0];
+            cp=arc_res(s+ARC_CP,dec,rc+m->cp[k],pred);
+            m->cp[k]=(int32_t)(cp-rc);
+            if (!lead) {
+                lead=1;
+                cpl=cp;
+                cpl1=cs->cp[0];
+            }
+            /* pseudorange by change of phaserange */
+            pr=arc_res(s+ARC_PR,dec,rp+m->pr[k],cs->pr[0]+(cp-cs->cp[0])/rcp);
+            m->pr[k]=(int32_t)(pr-rp);
+
+            m->lock[k]=(int32_t)arc_res(s+ARC_LOCK,dec,m->lock[k],cs->lock);
+            m->half[k]=(int32_t)arc_bits(s+ARC_HALF,dec,m->half[k],1,0);
+            m->cnr [k]=(int32_t)arc_res(s+ARC_CNR ,dec,m->cnr [k],cs->cnr );
+            if (ex) {
+                rt=(int64_t)m->rate[isat]*10000;
+                m->rrv[k]=(int32_t)(arc_res(s+ARC_RRV,dec,rt+m->rrv[k],cs->rate)-rt);
+            }
         }
+        cs->cp[1]=cs->cp[0];
+        cs->cp[0]=rc+m->cp[k];
+        cs->pr[1]=cs->pr[0];
+        cs->pr[0]=rp+m->pr[k];
+        cs->lock=m->lock[k];
+        cs->cnr=m->cnr[k];
+        if (ex) cs->rate=(int64_t)m->rate[isat]*10000+m->rrv[k];
+        cs->nep=cs->nep<2?cs->nep+1:2;
+    }
+    return 1;
+}
+
+/* encode record of data out of frames ---------------------------------------*/
+static void arc_encraw(arc_con *c, const uint8_t *data, int n)
+{
+    int i;
+
+    arc_putu(c->str+ARC_FRM,0);
+    arc_putu(c->str+ARC_RAW,n-1);
+    for (i=0;i<n;i++) arc_putb(c->str+ARC_RAW,data[i],8);
+    c->nrec++;
+    c->nbyte+=n;
+}
+
+/* encode record of frame ----------------------------------------------------*/
+static void arc_encframe(arc_con *c, const uint8_t *buff, int len)
+{
+    arc_msm_con m;
+    int i,type=getbitu(buff,24,12),ok;
 
-        setfrqpri(_freq_sel,i);
+    if (getbitu(buff,8,6)) { /* reserved bits not restored */
+        arc_encraw(c,buff,len);
+        return;
     }
+    i=arc_mtf(c,type);
+    arc_putu(c->str+ARC_FRM,i<0?ARC_NMTF+1:i+1);
+    if (i<0) arc_putb(c->str+ARC_FRM,type,12);
+
+    if (arc_msmtype(type)) {
+        ok=arc_unpack(buff,len,&m);
+        arc_putb(c->str+ARC_HDR,ok,1);
+        if (ok) {
+            arc_msm(c,&m,0);
+            c->nrec++;
+            c->nbyte+=len;
+            return;
+        }
+    }
+    arc_putu(c->str+ARC_RAW,len-6);
+    for (i=3;i<len-3;i++) arc_putb(c->str+ARC_RAW,buff[i],8);
+    c->nrec++;
+    c->nbyte+=len;
+}
 
-    init_rtcm(&rtcm_in);
-    memcpy(rtcm_in.buff,buff_in,len*sizeof(uint8_t));
-    rtcm_in.len=len;
-	type = getbitu(rtcm_in.buff, 24, 12);
-	trace(2, "type : %d\n", type);
+/* decode record (length of record (bytes),-1:error) -------------------------*/
+static int arc_decrec(arc_con *c, uint8_t *buff)
+{
+    arc_msm_con m;
+    uint32_t crc;
+    int i,n,sym,type;
+
+    if (!(sym=(int)arc_getu(c->str+ARC_FRM))) {
+        if ((n=(int)arc_getu(c->str+ARC_RAW)+1)>MAXRTCMLEN) return -1;
+        for (i=0;i<n;i++) buff[i]=(uint8_t)arc_getb(c->str+ARC_RAW,8);
+        return arc_err(c)?-1:n;
+    }
+    if (sym<=ARC_NMTF) type=c->mtf[sym-1];
+    else if (sym==ARC_NMTF+1) type=(int)arc_getb(c->str+ARC_FRM,12);
+    else return -1;
+    arc_mtf(c,type);
+
+    if (arc_msmtype(type)&&arc_getb(c->str+ARC_HDR,1)) {
+        memset(&m,0,sizeof(m));
+        m.type=type;
+        if (!arc_msm(c,&m,1)||arc_err(c)) return -1;
+        return arc_pack(&m,buff);
+    }
+    if ((n=(int)arc_getu(c->str+ARC_RAW))>1023) return -1;
+    buff[0]=RTCM3PREAMB;
+    buff[1]=(uint8_t)(n>>8);
+    buff[2]=(uint8_t)n;
+    for (i=0;i<n;i++) buff[3+i]=(uint8_t)arc_getb(c->str+ARC_RAW,8);
+    if (arc_err(c)) return -1;
+    crc=rtk_crc24q(buff,n+3);
+    buff[n+3]=(uint8_t)(crc>>16);
+    buff[n+4]=(uint8_t)(crc>> 8);
+    buff[n+5]=(uint8_t)crc;
+    return n+6;
+}
 
+/* put/get uint32 little-endian ----------------------------------------------*/
+static void arc_put32(uint8_t *p, uint32_t v)
+{
+    p[0]=(uint8_t)v; p[1]=(uint8_t)(v>>8); p[2]=(uint8_t)(v>>16); p[3]=(uint8_t)(v>>24);
+}
+static uint32_t arc_get32(const uint8_t *p)
+{
+    return p[0]|(uint32_t)p[1]<<8|(uint32_t)p[2]<<16|(uint32_t)p[3]<<24;
+}
 
-    ret = decode_rtcm3(&rtcm_in);
+/* write archive block -------------------------------------------------------*/
+static int arc_flush(rtcmarcw_t *w)
+{
+    arc_con *c=&w->c;
+    uint8_t hdr[8+4*ARC_NSTR];
+    int i,nbit[ARC_NSTR],ret=1;
 
-    //type = getbitu(rtcm_in.buff,24,12);
-    if (ret<0){
+    if (!c->nrec) return 1;
 
-        trace(1,"type error: %d\n",type);
+    arc_put32(hdr,c->nrec);
+    arc_put32(hdr+4,c->nbyte);
+    for (i=0;i<ARC_NSTR;i++) {
+        nbit[i]=bitw_end(&c->str[i].w);
+        arc_put32(hdr+8+4*i,nbit[i]);
     }
-    else {
-        ret= gen_rtcm3(&rtcm_in, type, sync);
+    if (fwrite(hdr,1,sizeof(hdr),w->fp)<sizeof(hdr)) ret=0;
+    for (i=0;i<ARC_NSTR&&ret;i++) {
+        if (fwrite(c->str[i].buff,1,(nbit[i]+7)/8,w->fp)<(size_t)(nbit[i]+7)/8) ret=0;
+    }
+    if (!ret) trace(1,"arc_flush: file write error\n");
+    arc_reset(c);
+    return ret;
+}
 
-		if (ret>0) {
-			*len_sd = rtcm_in.lensd + 3;
-			memcpy(buff_sd, rtcm_in.buffsd, *len_sd * sizeof(uint8_t));
-		}
-		else {
-			*len_sd = 0;
-		}
-        
+/* end of archive record -----------------------------------------------------*/
+static int arc_rec(rtcmarcw_t *w)
+{
+    if (arc_err(&w->c)) {
+        trace(1,"arc_rec: malloc fail\n");
+        return 0;
     }
+    if (w->c.nrec>=ARC_NREC||w->c.nbyte>=ARC_NBYTE) return arc_flush(w);
+    return 1;
+}
 
-    free_rtcm(&rtcm_in);
+/* add/flush data out of frames ----------------------------------------------*/
+static int arc_rawflush(rtcmarcw_t *w)
+{
+    if (!w->nraw) return 1;
+    arc_encraw(&w->c,w->raw,w->nraw);
+    w->nraw=0;
+    return arc_rec(w);
+}
+static int arc_rawadd(rtcmarcw_t *w, const uint8_t *data, int n)
+{
+    int i;
+
+    for (i=0;i<n;i++) {
+        if (w->nraw>=MAXRTCMLEN&&!arc_rawflush(w)) return 0;
+        w->raw[w->nraw++]=data[i];
+    }
+    return 1;
+}
+
+/* assemble frames in frame buffer of archive writer -------------------------
+* frames with parity error are output as data out of frames and the frame is
+* synchronized again from the next byte
+*-----------------------------------------------------------------------------*/
+static int arc_scan(rtcmarcw_t *w)
+{
+    uint8_t *p;
+    int n,len;
+
+    for (;;) {
+        if (w->nb>0&&w->buff[0]!=RTCM3PREAMB) {
+            p=(uint8_t *)memchr(w->buff,RTCM3PREAMB,w->nb);
+            n=p?(int)(p-w->buff):w->nb;
+            if (!arc_rawadd(w,w->buff,n)) return 0;
+        }
+        else {
+            if (w->nb<3||w->nb<(len=getbitu(w->buff,14,10)+6)) return 1;
+
+            if (rtk_crc24q(w->buff,len-3)==getbitu(w->buff,(len-3)*8,24)) {
+                if (!arc_rawflush(w)) return 0;
+                arc_encframe(&w->c,w->buff,len);
+                if (!arc_rec(w)) return 0;
+                n=len;
+            }
+            else {
+                if (!arc_rawadd(w,w->buff,1)) return 0;
+                n=1;
+            }
+        }
+        memmove(w->buff,w->buff+n,w->nb-n);
+        w->nb-=n;
+    }
+}
+
+/* open compressed archive for writing ---------------------------------------*/
+API_DECLSPEC rtcmarcw_t *rtcmarcopen(const char *file)
+{
+    rtcmarcw_t *w;
+    uint8_t hdr[16];
+    int i;
+
+    trace(3,"rtcmarcopen: file=%s\n",file);
+
+    if (!(w=(rtcmarcw_t *)calloc(1,sizeof(rtcmarcw_t)))) {
+        trace(1,"rtcmarcopen: malloc fail\n");
+        return NULL;
+    }
+    for (i=0;i<ARC_NSTR;i++) {
+        if (!(w->c.str[i].buff=(uint8_t *)malloc(4096))) break;
+        w->c.str[i].size=4096;
+    }
+    if (i<ARC_NSTR) {
+        trace(1,"rtcmarcopen: malloc fail\n");
+        rtcmarcclose(w);
+        return NULL;
+    }
+    arc_reset(&w->c);
+
+    memcpy(hdr,ARC_MAGIC,8);
+    arc_put32(hdr+8,1);
+    arc_put32(hdr+12,ARC_NSTR);
+    if (!(w->fp=fopen(file,"wb"))||fwrite(hdr,1,16,w->fp)<16) {
+        trace(1,"rtcmarcopen: file open error: %s\n",file);
+        rtcmarcclose(w);
+        return NULL;
+    }
+    return w;
+}
+
+/* input RTCM 3 stream to compressed archive ---------------------------------*/
+API_DECLSPEC int rtcmarcinput(rtcmarcw_t *w,const unsigned char *data,int n)
+{
+    int i,m;
+
+    for (i=0;i<n;i+=m) {
+        m=n-i<MAXRTCMLEN-w->nb?n-i:MAXRTCMLEN-w->nb;
+        memcpy(w->buff+w->nb,data+i,m);
+        w->nb+=m;
+        if (!arc_scan(w)) return 0;
+    }
+    return 1;
+}
+
+/* close compressed archive --------------------------------------------------*/
+API_DECLSPEC int rtcmarcclose(rtcmarcw_t *w)
+{
+    int i,ret=1;
+
+    if (!w) return 0;
+
+    if (w->fp) {
+        /* incomplete frame stored as data out of frames */
+        if (!arc_rawadd(w,w->buff,w->nb)||!arc_rawflush(w)||!arc_flush(w)) ret=0;
+        if (fclose(w->fp)) ret=0;
+    }
+    else ret=0;
+    for (i=0;i<ARC_NSTR;i++) free(w->c.str[i].buff);
+    free(w);
     return ret;
+}
 
+/* read archive block (1:ok,0:end of archive,-1:error) -----------------------*/
+static int arc_load(rtcmarcr_t *r)
+{
+    arc_con *c=&r->c;
+    uint8_t hdr[8+4*ARC_NSTR],*p;
+    size_t n;
+    int i,nbyte=0;
+
+    if ((n=fread(hdr,1,sizeof(hdr),r->fp))==0&&feof(r->fp)) return 0;
+    if (n<sizeof(hdr)) {
+        trace(2,"arc_load: block header error\n");
+        return -1;
+    }
+    r->nrec=(int)arc_get32(hdr);
+    for (i=0;i<ARC_NSTR;i++) {
+        c->str[i].nbit=(int)arc_get32(hdr+8+4*i);
+        if (c->str[i].nbit<0||c->str[i].nbit>ARC_NBYTE*64) return -1;
+        nbyte+=(c->str[i].nbit+7)/8;
+    }
+    if (r->nrec<=0||r->nrec>ARC_NREC) return -1;
+
+    if (!(p=(uint8_t *)realloc(r->data,nbyte+1))) {
+        trace(1,"arc_load: malloc fail\n");
+        return -1;
+    }
+    r->data=p;
+    if (fread(p,1,nbyte,r->fp)<(size_t)nbyte) {
+        trace(2,"arc_load: block data error\n");
+        return -1;
+    }
+    for (i=0;i<ARC_NSTR;i++) {
+        c->str[i].buff=p;
+        p+=(c->str[i].nbit+7)/8;
+    }
+    arc_reset(c);
+    return 1;
 }
 
+/* open compressed archive for reading ---------------------------------------*/
+API_DECLSPEC rtcmarcr_t *rtcmarcropen(const char *file)
+{
+    rtcmarcr_t *r;
+    uint8_t hdr[16];
+
+    trace(3,"rtcmarcropen: file=%s\n",file);
+
+    if (!(r=(rtcmarcr_t *)calloc(1,sizeof(rtcmarcr_t)))) {
+        trace(1,"rtcmarcropen: malloc fail\n");
+        return NULL;
+    }
+    if (!(r->fp=fopen(file,"rb"))) {
+        trace(1,"rtcmarcropen: file open error: %s\n",file);
+        free(r);
+        return NULL;
+    }
+    if (fread(hdr,1,16,r->fp)<16||memcmp(hdr,ARC_MAGIC,8)||arc_get32(hdr+8)!=1||
+        arc_get32(hdr+12)!=ARC_NSTR) {
+        trace(1,"rtcmarcropen: archive file error: %s\n",file);
+        rtcmarcrclose(r);
+        return NULL;
+    }
+    return r;
+}
 
+/* read next record of compressed archive ------------------------------------*/
+API_DECLSPEC int rtcmarcread(rtcmarcr_t *r,unsigned char *buff)
+{
+    int ret;
 
+    if (r->c.nrec>=r->nrec) {
+        if ((ret=arc_load(r))<=0) return ret;
+    }
+    if ((ret=arc_decrec(&r->c,buff))<0) {
+        trace(2,"rtcmarcread: archive data error\n");
+        r->nrec=r->c.nrec; /* rest of block skipped */
+        return -1;
+    }
+    r->c.nrec++;
+    return ret;
+}
 
+/* close compressed archive reader -------------------------------------------*/
+API_DECLSPEC void rtcmarcrclose(rtcmarcr_t *r)
+{
+    if (!r) return;
+    if (r->fp) fclose(r->fp);
+    free(r->data);
+    free(r);
+}
 
+/* get RTCM convert statistics -----------------------------------------------*/
+API_DECLSPEC void rtcmcvtstat(const rtcmcvt_t *cvt,rtcmstat_t *stat)
+{
+    const rtcmstat_t *s=&cvt->stat;
+    int i,j;
 
+    for (i=0;i<RTCMSTAT_NTYPE;i++) {
+        stat->nin [i]=STAT_GET(s->nin [i]);
+        stat->nout[i]=STAT_GET(s->nout[i]);
+    }
+    stat->bytein =STAT_GET(s->bytein );
+    stat->byteout=STAT_GET(s->byteout);
+    stat->ncrc   =STAT_GET(s->ncrc   );
+    stat->nerr   =STAT_GET(s->nerr   );
+    stat->ncell  =STAT_GET(s->ncell  );
+    stat->ndrop  =STAT_GET(s->ndrop  );
+    stat->ndec   =STAT_GET(s->ndec   );
+    stat->nverr  =STAT_GET(s->nverr  );
+    stat->nrep   =STAT_GET(s->nrep   );
+    stat->nunsup =STAT_GET(s->nunsup );
+    for (i=0;i<RTCMSTAT_NSTAGE;i++) {
+        for (j=0;j<RTCMSTAT_NBIN;j++) stat->lat[i][j]=STAT_GET(s->lat[i][j]);
+        stat->latsum[i]=STAT_GET(s->latsum[i]);
+    }
+}
 
+/* RTCM convert statistics to prometheus text ------------------------------*/
+API_DECLSPEC int rtcmstat2prom(const rtcmstat_t *stat,const char *label,char *buff,int size)
+{
+    static const char *stage[]={"decode","encode","total"};
+    static const char *name[]={"crc_errors","decode_errors","cells","cells_dropped",
+                               "bytes_in","bytes_out","msm_decimated","verify_errors",
+                               "repeats_suppressed","frames_unsupported"};
+    const char *sep=label&&*label?",":"";
+    uint64_t val[10],n;
+    char *p=buff,*end=buff+size;
+    int i,j,k;
+
+    if (!label) label="";
+    val[0]=stat->ncrc; val[1]=stat->nerr; val[2]=stat->ncell; val[3]=stat->ndrop;
+    val[4]=stat->bytein; val[5]=stat->byteout; val[6]=stat->ndec;
+    val[7]=stat->nverr; val[8]=stat->nrep; val[9]=stat->nunsup;
+
+    for (i=0;i<10;i++) {
+        p+=snprintf(p,end-p,"# TYPE rtcmcvt_%s_total counter\n",name[i]);
+        if (p>=end) return -1;
+        p+=snprintf(p,end-p,"rtcmcvt_%s_total{%s} %llu\n",name[i],label,val[i]);
+        if (p>=end) return -1;
+    }
+    for (k=0;k<2;k++) {
+        p+=snprintf(p,end-p,"# TYPE rtcmcvt_frames_%s_total counter\n",k?"out":"in");
+        if (p>=end) return -1;
+        for (i=0;i<RTCMSTAT_NTYPE;i++) {
+            if (!(n=k?stat->nout[i]:stat->nin[i])) continue;
+            p+=snprintf(p,end-p,"rtcmcvt_frames_%s_total{%s%stype=\"%d\"} %llu\n",
+                        k?"out":"in",label,sep,i?stat_idxtype(i):0,n);
+            if (p>=end) return -1;
+        }
+    }
+    p+=snprintf(p,end-p,"# TYPE rtcmcvt_latency_seconds histogram\n");
+    if (p>=end) return -1;
+    for (i=0;i<RTCMSTAT_NSTAGE;i++) {
+        for (j=0,n=0;j<RTCMSTAT_NBIN;j++) {
+            n+=stat->lat[i][j];
+            p+=snprintf(p,end-p,"rtcmcvt_latency_seconds_bucket{%s%sstage=\"%s\",le=\"%.9f\"} %llu\n",
+                        label,sep,stage[i],stat_binub(j)*1E-9,n);
+            if (p>=end) return -1;
+        }
+        p+=snprintf(p,end-p,"rtcmcvt_latency_seconds_bucket{%s%sstage=\"%s\",le=\"+Inf\"} %llu\n"
+                    "rtcmcvt_latency_seconds_sum{%s%sstage=\"%s\"} %.9f\n"
+                    "rtcmcvt_latency_seconds_count{%s%sstage=\"%s\"} %llu\n",
+                    label,sep,stage[i],n,label,sep,stage[i],stat->latsum[i]*1E-9,
+                    label,sep,stage[i],n);
+        if (p>=end) return -1;
+    }
+    return (int)(p-buff);
+}
 
+/* RTCM 3 frame parity -------------------------------------------------------*/
+API_DECLSPEC unsigned int rtcmcrc24q(const unsigned char *buff,int len)
+{
+    return rtk_crc24q(buff,len);
+}
@@ -1,16 +1,71 @@
-#pragma once
-
-#ifdef RTCMCNV_EXPORTS
-#define API_DECLSPEC _declspec(dllexport)
-#else  
-#define API_DECLSPEC _declspec(dllimport)
+#pragma once
+
+#if defined(_WIN32)&&!defined(RTCMCNV_STATIC)
+#ifdef RTCMCNV_EXPORTS
+#define API_DECLSPEC _declspec(dllexport)
+#else  
+#define API_DECLSPEC _declspec(dllimport)
 #endif // RTCMCNV_EXPORTS
+#else
+#define API_DECLSPEC
+#endif
+
+#define RTCMSTAT_NTYPE  400     /* number of message type counters */
+#define RTCMSTAT_NSTAGE 3       /* number of latency stages (decode,encode,total) */
+#define RTCMSTAT_NBIN   105     /* number of latency histogram bins */
+
+#define RTCMLEG_OFF     0       /* legacy observation messages not converted */
+#define RTCMLEG_OUT     1       /* gps/glonass observables output as legacy messages */
+#define RTCMLEG_MSM     2       /* legacy observation messages output as msm4 */
+
+typedef struct rtcmcvt_tag rtcmcvt_t; /* RTCM stream converter (opaque) */
+typedef struct rtcmprof_tag rtcmprof_t; /* frequency selection profile (opaque) */
+typedef struct rtcmcol_tag rtcmcol_t; /* columnar observation export (opaque) */
+typedef struct rtcmrnx_tag rtcmrnx_t; /* rinex observation writer (opaque) */
+typedef struct rtcmidxw_tag rtcmidxw_t; /* RTCM 3 frame index writer (opaque) */
+typedef struct rtcmarcw_tag rtcmarcw_t; /* RTCM 3 archive writer (opaque) */
+typedef struct rtcmarcr_tag rtcmarcr_t; /* RTCM 3 archive reader (opaque) */
+
+typedef struct {                /* RTCM convert statistics type */
+    unsigned long long nin [RTCMSTAT_NTYPE]; /* input frames (1-299:1001-1299,300-329:4070-4099,0:other) */
+    unsigned long long nout[RTCMSTAT_NTYPE]; /* output frames */
+    unsigned long long bytein,byteout; /* input/output bytes */
+    unsigned long long ncrc;    /* number of parity errors */
+    unsigned long long nerr;    /* number of frame length or msm/ssr/legacy decode errors */
+    unsigned long long ncell;   /* number of decoded msm cells */
+    unsigned long long ndrop;   /* number of msm cells dropped by frequency selection */
+    unsigned long long ndec;    /* number of msm messages dropped by epoch decimation */
+    unsigned long long nverr;   /* number of converted msm messages failed verification */
+    unsigned long long nrep;    /* number of repeated ephemeris/station messages suppressed */
+    unsigned long long nunsup;  /* number of frames of types not converted (not errors) */
+    unsigned long long lat[RTCMSTAT_NSTAGE][RTCMSTAT_NBIN]; /* latency histogram */
+    unsigned long long latsum[RTCMSTAT_NSTAGE]; /* latency sum (ns) */
+} rtcmstat_t;
+
+typedef struct {                /* observation data in physical units */
+    char   sat[4];              /* satellite id ("G01","R24",...) */
+    char   code[4];             /* observation code ("1C","2W",...) */
+    double P;                   /* pseudorange (m) (0.0:no data) */
+    double L;                   /* carrier-phase (cycle) (0.0:no data) */
+    float  D;                   /* doppler frequency (Hz) (0.0:no data) */
+    float  SNR;                 /* signal strength (dBHz) */
+    unsigned char LLI;          /* loss of lock indicator */
+    unsigned short lock;        /* msm lock time indicator */
+} rtcmobs_t;
+
+typedef struct {                /* RTCM 3 frame index record */
+    unsigned long long off;     /* byte offset of frame in archive */
+    unsigned int tow;           /* epoch (gps time of week,ms) */
+    int type;                   /* message type */
+    int len;                    /* frame length (bytes) */
+    int sys;                    /* system (0:none,1:GPS,2:GLO,3:GAL,4:QZS,5:SBS,6:BDS,7:IRN) */
+} rtcmidx_t;
 
 
 /* convert RTCM 3 message -----------------------------------------------------
 * generate RTCM 3 message
 * args   : uint8_t *buff_in I   rtcm binary data
-*          int    len       I   length of received rtcm data
+*          int    len       I   length of received rtcm data (<=1200)
 *          char  **freq_c   I   sent frequency
 *          uint8_t *buff_sd o   converted rtcm data (need to be sent)
 *          int    *len_sd   o   results length
@@ -40,6 +95,7 @@
 * GLONASS no data will be sent;
 * BDS B1I, B2I, B3I will be obtained in new rtcm buff.
 * "G3", "G1a","G2a" in rtcm ICD are not provided. therefore, please do not choose the three.
+* an unknown frequency in freq_c is an error (return -1, no conversion).
 *-----------------------------------------------------------------------------*/
 API_DECLSPEC int rtcmCvt(int sync,unsigned char *buff_in,int len,char **freq_c,unsigned char *buff_sd,int *len_sd);
 
@@ -54,3 +110,349 @@ API_DECLSPEC void rtcmlogopen(const char *file);
 API_DECLSPEC void rtcmlogclose(void);
 API_DECLSPEC void rtcmloglevel(int level);
 
+
+/* RTCM stream converter -------------------------------------------------------
+* open/close converter context kept across calls of rtcmcvtinput()
+* rtcmcvtinput() args and return are same as rtcmCvt()
+* note : one converter should be used per station stream and per thread.
+*        freq_c NULL selects the profile set by rtcmcvtsetprof()
+*        ssr messages (1057-1068,1240-1263,1265-1270) are filtered by the
+*        same selection: systems not selected are dropped and code/phase
+*        biases of signals not selected are removed
+*-----------------------------------------------------------------------------*/
+API_DECLSPEC rtcmcvt_t *rtcmcvtopen(void);
+API_DECLSPEC void rtcmcvtclose(rtcmcvt_t *cvt);
+API_DECLSPEC int rtcmcvtinput(rtcmcvt_t *cvt,int sync,unsigned char *buff_in,int len,char **freq_c,unsigned char *buff_sd,int *len_sd);
+
+/* frequency selection profile -------------------------------------------------
+* rtcmprofnew()    : compile frequency selection strings (see rtcmCvt()) into
+*                    a profile
+* rtcmprofsig()    : compile signal selection by rinex obs codes into a
+*                    profile. groups of system letter (G,R,E,J,S,C,I) and
+*                    codes are separated by ';' (ex: "G:1C,2W;E:1X,5X").
+*                    signals of exactly the listed codes are kept, so several
+*                    codes of a frequency can be selected or one can be left
+*                    out. systems not listed are not output
+* rtcmproffree()   : free profile not passed to a converter
+* rtcmcvtsetprof() : set profile of converter. the profile is swapped in by
+*                    the converting thread on its next input, so it can be
+*                    called from any thread while the converter is running
+* args   : char  **freq_c     I   frequency selection (see rtcmCvt())
+*          char   *sel        I   signal selection by obs codes
+*          rtcmprof_t *prof   I   frequency selection profile
+*          rtcmcvt_t *cvt     IO  rtcm stream converter
+* return : rtcmprofnew,rtcmprofsig: profile (NULL:error or unknown frequency
+*                                   or code)
+* notes  : the profile is used by rtcmcvtinput() and rtcmcvtinputs() called
+*          with freq_c NULL. the converter owns and frees a profile once set
+*-----------------------------------------------------------------------------*/
+API_DECLSPEC rtcmprof_t *rtcmprofnew(char **freq_c);
+API_DECLSPEC rtcmprof_t *rtcmprofsig(const char *sel);
+API_DECLSPEC void rtcmproffree(rtcmprof_t *prof);
+API_DECLSPEC void rtcmcvtsetprof(rtcmcvt_t *cvt,rtcmprof_t *prof);
+
+/* verify converted MSM messages ------------------------------------------------
+* decode every converted msm message again, independently of the encoder, and
+* check that it is a valid rtcm 3 frame holding exactly the input cells of
+* valid satellites and selected signals bit for bit. a message failing the
+* check is not output (return -1) and counted in rtcmstat_t nverr
+* args   : rtcmcvt_t *cvt     IO  rtcm stream converter
+*          int    ena         I   verification (1:on,0:off)
+* return : none
+*-----------------------------------------------------------------------------*/
+API_DECLSPEC void rtcmcvtverify(rtcmcvt_t *cvt,int ena);
+
+/* MSM epoch decimation --------------------------------------------------------
+* pass only msm messages of epochs on the output grid. other epochs are
+* dropped by the epoch time of the msm header before the message is decoded
+* args   : rtcmcvt_t *cvt     IO  rtcm stream converter
+*          int    tint        I   output interval (ms) (0:off)
+*          int    toff        I   offset of output grid (ms)
+* return : none
+* notes  : the grid is aligned in gps time of day (bdt+14s, glonass utc(su)
+*          -3h+leap seconds), so tint should be a divisor of 86400000.
+*          messages other than msm and converted legacy observation messages
+*          (rtcmcvtlegacy()) are not decimated. dropped messages are
+*          counted in rtcmstat_t ndec and return 0 (no rtcm data)
+*-----------------------------------------------------------------------------*/
+API_DECLSPEC void rtcmcvtdecim(rtcmcvt_t *cvt,int tint,int toff);
+
+/* repeated message suppression ------------------------------------------------
+* forward ephemeris (1019,1020,1041,1042,1044,1045,1046) and station (1005-
+* 1008,1033) messages only if the content changed (iod or any other field)
+* or tint passed since the message of the satellite or station was forwarded
+* args   : rtcmcvt_t *cvt     IO  rtcm stream converter
+*          int    tint        I   refresh interval (ms) (0:off)
+* return : status (1:ok,0:error)
+* notes  : the interval is measured in the epochs of the msm messages of the
+*          stream. messages forwarded before the first msm message count as
+*          forwarded at its epoch, and their copies before it are suppressed.
+*          suppressed messages are counted in rtcmstat_t nrep and return 0
+*          (no rtcm data). without suppression these messages are not output
+*-----------------------------------------------------------------------------*/
+API_DECLSPEC int rtcmcvtrepeat(rtcmcvt_t *cvt,int tint);
+
+/* legacy observation message conversion ---------------------------------------
+* convert gps and glonass observables between msm and legacy rtcm 3 messages
+* for rovers decoding only one of them. legacy input (1002,1004,1010,1012) is
+* decoded to msm4 cells, so both directions select signals by the profile
+* args   : rtcmcvt_t *cvt     IO  rtcm stream converter
+*          int    mode        I   conversion mode
+*                                 RTCMLEG_OFF: legacy messages not converted
+*                                 RTCMLEG_OUT: gps/glonass msm and legacy
+*                                   messages output as 1004/1012 (1002/1010
+*                                   if L2/G2 is not selected)
+*                                 RTCMLEG_MSM: legacy messages output as msm4
+*                                   (1074/1084)
+* return : none
+* notes  : legacy messages carry one L1 and one L2 signal of a satellite and
+*          no L1 means no satellite. other systems are output as msm.
+*          1001,1003,1009,1011 without integer ms of pseudorange are not
+*          converted. glonass msm4 from legacy input has day of week unknown
+*-----------------------------------------------------------------------------*/
+API_DECLSPEC void rtcmcvtlegacy(rtcmcvt_t *cvt,int mode);
+
+/* input RTCM 3 stream to converter --------------------------------------------
+* input rtcm 3 stream data of any length. the frame is assembled in the
+* converter, so the stream can be split at any byte. the message type and
+* msm header are decoded as soon as they are input and unsupported frames are
+* skipped without buffering
+* args   : rtcmcvt_t *cvt     IO  rtcm stream converter
+*          unsigned char *data I  stream data
+*          int    n           I   number of stream data (bytes)
+*          int    *nused      O   number of used stream data (bytes)
+*          char  **freq_c     I   sent frequency (see rtcmCvt(),NULL:profile)
+*          unsigned char *buff_sd O converted rtcm data (need to be sent)
+*          int    *len_sd     O   results length
+* return : status (1:ok,0,-1:error or no rtcm data,-2:no complete frame)
+* notes  : call again with data+*nused until -2 is returned. the multiple
+*          message bit of the input message is kept in the output. with an
+*          unknown frequency in freq_c, the data is dropped (*nused=n) and
+*          -1 is returned
+*-----------------------------------------------------------------------------*/
+API_DECLSPEC int rtcmcvtinputs(rtcmcvt_t *cvt,const unsigned char *data,int n,int *nused,char **freq_c,unsigned char *buff_sd,int *len_sd);
+
+/* get observation data in physical units ------------------------------------
+* convert the msm cells of the last input message to physical units. the
+* conversion itself keeps the raw msm integer fields and never needs this
+* args   : rtcmcvt_t *cvt     I   rtcm stream converter
+*          rtcmobs_t *obs     O   observation data
+*          int    nmax        I   max number of observation data
+* return : number of observation data
+*-----------------------------------------------------------------------------*/
+API_DECLSPEC int rtcmcvtobs(rtcmcvt_t *cvt,rtcmobs_t *obs,int nmax);
+
+/* columnar export of observation data -----------------------------------------
+* write observation data of converted msm messages to a chunked columnar file
+* for bulk analysis. each field is a column of fixed width values, satellite
+* and signal are dictionary indexes, and the chunk directory in the footer
+* holds the file offsets of columns and epoch min/max of every chunk, so the
+* file can be memory mapped and only the needed columns and chunks read.
+* see rtcmcolopen() in rtcmCnv.c for the file layout
+* rtcmcolopen()  : open export file
+* rtcmcolwrite() : write observation data of last input message of converter
+* rtcmcolclose() : flush last chunk, write footer and close file
+* args   : char   *file       I   output file path
+*          int    nrow        I   rows per chunk (0:65536)
+*          int    week        I   gps week of first epoch (msm epochs carry
+*                                 only time of week)
+*          rtcmcol_t *col     IO  columnar export
+*          rtcmcvt_t *cvt     IO  rtcm stream converter
+* return : rtcmcolopen : columnar export (NULL:error)
+*          rtcmcolwrite: number of rows written (-1:error)
+*          rtcmcolclose: status (1:ok,0:error)
+* notes  : the week is incremented on week rollover of epochs. epochs of
+*          glonass msm with unknown day of week are put on day 0 of the week
+*-----------------------------------------------------------------------------*/
+API_DECLSPEC rtcmcol_t *rtcmcolopen(const char *file,int nrow,int week);
+API_DECLSPEC int rtcmcolwrite(rtcmcol_t *col,rtcmcvt_t *cvt);
+API_DECLSPEC int rtcmcolclose(rtcmcol_t *col);
+
+/* RINEX observation writer ----------------------------------------------------
+* write observation data of converted msm messages as rinex 3 observation
+* file. observations of the msm messages of an epoch are collected and written
+* as one epoch record when the epoch changes. only signals kept by the
+* frequency selection of the converter are written
+* rtcmrnxopen()  : open rinex observation file
+* rtcmrnxwrite() : write observation data of last input message of converter
+* rtcmrnxclose() : write last epoch and header and close file
+* args   : char   *file       I   rinex observation file path
+*          char   *marker     I   marker name (NULL:no)
+*          int    week        I   gps week of first epoch (msm epochs carry
+*                                 only time of week)
+*          double ver         I   rinex version (3.02,3.04,...) (0:3.04)
+*          rtcmrnx_t *rnx     IO  rinex observation writer
+*          rtcmcvt_t *cvt     IO  rtcm stream converter
+* return : rtcmrnxopen : rinex observation writer (NULL:error)
+*          rtcmrnxwrite: number of observation data written (-1:error)
+*          rtcmrnxclose: status (1:ok,0:error)
+* notes  : observation types of a system are appended in order of first
+*          appearance, so the records are kept in a temporary file and the
+*          header is written before them on close. the approximate position
+*          in the header is 0. rinex 4 header records are not written, so
+*          versions other than 3.xx are errors
+*-----------------------------------------------------------------------------*/
+API_DECLSPEC rtcmrnx_t *rtcmrnxopen(const char *file,const char *marker,int week,double ver);
+API_DECLSPEC int rtcmrnxwrite(rtcmrnx_t *rnx,rtcmcvt_t *cvt);
+API_DECLSPEC int rtcmrnxclose(rtcmrnx_t *rnx);
+
+/* RTCM 3 frame index ----------------------------------------------------------
+* sidecar index of rtcm 3 archive with one 16 byte record per frame holding
+* byte offset, message type, system, epoch and frame length. records are in
+* archive order and the epoch of frames other than msm is that of the last
+* msm message, so epochs can be binary searched. see rtcmCnv.c for the layout
+* rtcmidxopen()   : open index file for appending records while recording
+* rtcmidxinput()  : input archive data as written to archive. frames are
+*                   assembled and indexed with the offset counted from off
+* rtcmidxclose()  : close index file
+* rtcmidxbuild()  : build index of existing archive file
+* rtcmidxsearch() : search frames of epochs ts<=tow<te and message type
+* rtcmidxrange()  : byte range of archive holding frames of epochs ts<=tow<te
+* args   : char   *file       I   index file (rtcmidxbuild(): archive file)
+*          unsigned long long off I archive offset of next input data (bytes)
+*          rtcmidxw_t *w      IO  frame index writer
+*          unsigned char *data I  archive data
+*          int    n           I   number of archive data (bytes)
+*          char   *idxfile    I   index file
+*          unsigned int ts,te I   epoch window (gps time of week,ms) (te<ts:
+*                                 window over end of week)
+*          int    type        I   message type (0:all)
+*          rtcmidx_t *idx     O   index records
+*          int    nmax        I   max number of index records
+*          unsigned long long *off,*len O byte offset/length of range
+* return : rtcmidxopen : frame index writer (NULL:error)
+*          rtcmidxclose: status (1:ok,0:error)
+*          others      : number of frames (-1:error)
+* notes  : the index file is flushed on every rtcmidxinput() that adds
+*          records. frames with parity errors are not indexed. glonass and
+*          bds epochs are converted to gps time of week. glonass epochs with
+*          unknown day of week are put on the day of the last epoch. epochs
+*          of the index continue over week rollovers of the archive, so an
+*          archive (or index appended by rtcmidxopen()) can span about 6
+*          weeks. the window is searched in the first week of the archive
+*          where it ends after the first epoch. tow of records output is
+*          time of week
+*-----------------------------------------------------------------------------*/
+API_DECLSPEC rtcmidxw_t *rtcmidxopen(const char *file,unsigned long long off);
+API_DECLSPEC int rtcmidxinput(rtcmidxw_t *w,const unsigned char *data,int n);
+API_DECLSPEC int rtcmidxclose(rtcmidxw_t *w);
+API_DECLSPEC int rtcmidxbuild(const char *file,const char *idxfile);
+API_DECLSPEC int rtcmidxsearch(const char *idxfile,unsigned int ts,unsigned int te,int type,rtcmidx_t *idx,int nmax);
+API_DECLSPEC int rtcmidxrange(const char *idxfile,unsigned int ts,unsigned int te,unsigned long long *off,unsigned long long *len);
+
+/* extract frames of archives by epoch window ----------------------------------
+* extract the frames of epochs ts<=tow<te of message types and systems from
+* rtcm 3 archives, each with frame index file <archive>.idx (see
+* rtcmidxbuild()). the byte range of the window is found by binary search of
+* the index and read sequentially in blocks, so the archive is not scanned.
+* archives are extracted in parallel by worker threads
+* args   : char  **files      I   archive files
+*          char  **outfiles   I   output files (one for each archive)
+*          int    nfile       I   number of archive files
+*          unsigned int ts,te I   epoch window (gps time of week,ms) (te<ts:
+*                                 window over end of week)
+*          int    *types      I   message types (NULL:all)
+*          int    ntype       I   number of message types (0:all)
+*          char   *sys        I   systems of frames (ex: "GRE",NULL:all)
+*                                 G:GPS,R:GLO,E:GAL,J:QZS,S:SBS,C:BDS,I:IRN
+*          char  **freq_c     I   sent frequency (see rtcmCvt(),NULL:frames
+*                                 output without conversion)
+*          int    nthread     I   number of worker threads (<=64)
+*          int    *nout       O   number of frames output of each archive
+*                                 (-1:error) (NULL:no output)
+* return : number of frames output (-1:error of any archive or unknown
+*          frequency in freq_c)
+* notes  : frames of no system (ex: station info) are output regardless of
+*          sys. each archive is converted by its own stream converter. as by
+*          the relay, only msm and ssr frames are converted, so output files
+*          match rtcmcvtinputs() of the selected msm and ssr frames, and the
+*          other frames (ephemeris, station, ...) are copied as they are
+*-----------------------------------------------------------------------------*/
+API_DECLSPEC int rtcmextract(const char **files,const char **outfiles,int nfile,unsigned int ts,unsigned int te,const int *types,int ntype,const char *sys,char **freq_c,int nthread,int *nout);
+
+/* compressed RTCM 3 archive ---------------------------------------------------
+* store rtcm 3 streams in a compressed archive using the msm structure. msm4-7
+* messages are split to header, mask and field streams (rough range, fine
+* pseudorange, fine phaserange, lock time, cnr, ...). fields are predicted
+* from the previous epochs of the satellite and signal and the residuals are
+* adaptive rice coded in the stream of the field. other frames and data out
+* of frames are stored as they are. the archive is restored to the input
+* stream byte by byte. see rtcmarcopen() in rtcmCnv.c for the file layout
+* rtcmarcopen()   : open archive file for writing
+* rtcmarcinput()  : input rtcm 3 stream data of any length
+* rtcmarcclose()  : write pending data and close archive file
+* rtcmarcropen()  : open archive file for reading
+* rtcmarcread()   : read next frame (or data out of frames) of archive
+* rtcmarcrclose() : close archive file
+* args   : char   *file       I   archive file
+*          rtcmarcw_t *w      IO  archive writer
+*          unsigned char *data I  stream data
+*          int    n           I   number of stream data (bytes)
+*          rtcmarcr_t *r      IO  archive reader
+*          unsigned char *buff O  frame or data out of frames (>=1029 bytes)
+* return : rtcmarcopen,rtcmarcropen: archive writer/reader (NULL:error)
+*          rtcmarcinput : status (1:ok,0:error)
+*          rtcmarcclose : status (1:ok,0:error)
+*          rtcmarcread  : length of buff (bytes) (0:end of archive,-1:error)
+* notes  : the archive is written in independent blocks of up to 4096 frames,
+*          so a block is decoded without the preceding blocks. frames are
+*          restored with the parity of gen_rtcm3()
+*-----------------------------------------------------------------------------*/
+API_DECLSPEC rtcmarcw_t *rtcmarcopen(const char *file);
+API_DECLSPEC int rtcmarcinput(rtcmarcw_t *w,const unsigned char *data,int n);
+API_DECLSPEC int rtcmarcclose(rtcmarcw_t *w);
+API_DECLSPEC rtcmarcr_t *rtcmarcropen(const char *file);
+API_DECLSPEC int rtcmarcread(rtcmarcr_t *r,unsigned char *buff);
+API_DECLSPEC void rtcmarcrclose(rtcmarcr_t *r);
+
+/* RTCM convert statistics -----------------------------------------------------
+* rtcmcvtstat()   : take snapshot of converter statistics. counters are written
+*                   only by the converting thread, so a monitoring thread can
+*                   poll them without locks
+* rtcmstat2prom() : output statistics as prometheus text exposition format
+* args   : rtcmcvt_t  *cvt    I   rtcm stream converter
+*          rtcmstat_t *stat   IO  statistics
+*          char  *label       I   additional labels (ex: "station=\"ABCD\"", NULL: no)
+*          char  *buff        O   output text buffer
+*          int    size        I   output buffer size (bytes)
+* return : rtcmstat2prom: output length (bytes) (-1: buffer overflow)
+* note   : latency histogram bins are log-linear: bin 0 < 64ns, then 4 bins for
+*          each power of 2 up to 2^32 ns. stages are decode, encode and total
+*-----------------------------------------------------------------------------*/
+API_DECLSPEC void rtcmcvtstat(const rtcmcvt_t *cvt,rtcmstat_t *stat);
+API_DECLSPEC int rtcmstat2prom(const rtcmstat_t *stat,const char *label,char *buff,int size);
+
+/* RTCM 3 frame parity ---------------------------------------------------------
+* compute crc-24q parity of rtcm 3 frame
+* args   : unsigned char *buff I  frame data (from preamble, without parity)
+*          int    len       I   data length (bytes)
+* return : crc-24q parity
+*-----------------------------------------------------------------------------*/
+API_DECLSPEC unsigned int rtcmcrc24q(const unsigned char *buff,int len);
+
+/* MSM4 delta coding -----------------------------------------------------------
+* rtcmcvtdelta()   : set msm4 delta coding of converter output. while the
+*                    header and masks of msm4 messages of a system do not
+*                    change, the converted messages are output as delta
+*                    messages (type 4088) against previous epochs. a standard
+*                    msm4 message is output as keyframe every nkey epochs
+*                    (at most 256)
+* rtcmcvtundelta() : restore standard msm4 messages from the output of a
+*                    converter with delta coding. other messages are output
+*                    unchanged
+* args   : rtcmcvt_t *cvt     IO  rtcm stream converter
+*          int    nkey        I   keyframe interval (epochs) (0:off)
+*          unsigned char *buff_in I rtcm frame
+*          int    len         I   length of rtcm frame (bytes)
+*          unsigned char *buff_sd O restored rtcm frame
+*          int    *len_sd     O   restored length
+* return : rtcmcvtdelta  : status (1:ok,0:error)
+*          rtcmcvtundelta: status (1:ok,0:no keyframe of delta message,
+*                          -1:error)
+* notes  : use separate converters for coding and restoring. a delta message
+*          carries the epoch of its keyframe and a sequence number, so a lost
+*          keyframe or delta message drops delta messages of the system until
+*          next keyframe. msm5-7 messages are not delta coded
+*-----------------------------------------------------------------------------*/
+API_DECLSPEC int rtcmcvtdelta(rtcmcvt_t *cvt,int nkey);
+API_DECLSPEC int rtcmcvtundelta(rtcmcvt_t *cvt,const unsigned char *buff_in,int len,unsigned char *buff_sd,int *len_sd);
@@ -0,0 +1,1320 @@
+/*------------------------------------------------------------------------------
+* rtcmrelay.c : ntrip relay with rtcm msm frequency extraction
+*
+* notes  : relay for linux (epoll). it accepts ntrip 1.0/2.0
+*          sources (SOURCE / POST) and clients (GET), converts the msm
+*          and ssr messages of a source for every derived mountpoint once by
+*          the frequency selection profile of the mountpoint (rtcmcvtinput())
+*          and fans out the converted stream to all clients of the mountpoint.
+*          other messages (station, ephemerides, ...) are relayed unchanged.
+*
+*          build : cc -O2 -o rtcmrelay rtcmrelay.c rtcmCnv.c -lm -lpthread
+*
+*          usage : rtcmrelay [-a addr] [-p port] [-w passwd] [-t level] [-v]
+*                            [-e tint] [-r file] [-n nwrk]
+*                            -m mount[:src:profile[:tint[:fmt]]] ...
+*
+*          -a addr     listen address (default: 0.0.0.0)
+*          -p port     listen port (default: 2101)
+*          -w passwd   source password (default: no check)
+*          -t level    rtcm convert log level (log to rtcmrelay.log)
+*          -v          verify converted msm messages (rtcmcvtverify())
+*          -e tint     forward unchanged ephemeris and station messages on
+*                      derived mountpoints only every tint s (rtcmcvtrepeat())
+*          -r file     profile file read on start and reloaded on SIGHUP.
+*                      each line is "mount profile" of a derived mountpoint
+*                      ('#': comment). a profile with ':' selects signals by
+*                      rinex obs codes (rtcmprofsig(), ex: "G:1C,2W;E:1X").
+*                      reloaded profiles are swapped into the converters
+*                      (rtcmcvtsetprof()) without reconnection
+*          -n nwrk     number of worker threads (default: 0, all in the main
+*                      thread). source mountpoints are assigned to workers
+*                      in turn and derived mountpoints to the worker of the
+*                      source. workers are pinned to the cpus of numa nodes
+*                      in turn and allocate the mountpoints, converters and
+*                      connections they own, so the memory of a station is
+*                      placed on the node of its worker by first touch. the
+*                      main thread accepts connections and hands them over
+*                      to the worker of the mountpoint after the request
+*                      header
+*          -m mount    source mountpoint (raw stream)
+*          -m mount:src:profile
+*                      mountpoint derived from source mountpoint src with
+*                      frequency selection profile. the profile is freq_c of
+*                      rtcmCvt() separated by ',' in order of GPS,GLONASS,
+*                      Galileo,QZSS,SBAS,BDS,IRNSS (ex: "L1+L2,G1,E1,,,B1I,")
+*          -m mount:src:profile:tint
+*                      same as above with msm epochs decimated to output
+*                      interval tint (s) (ex: "L1,G1,E1,L1,L1,B1I,L5:1")
+*          -m mount:src:profile:tint:fmt
+*                      same as above with gps/glonass observables output in
+*                      format fmt (rtcmcvtlegacy()). "legacy": msm and legacy
+*                      1002/1004/1010/1012 output as 1004/1012 (1002/1010
+*                      without L2/G2), "msm": legacy output as msm4. tint may
+*                      be empty (ex: "L1+L2,G1+G2,,,,,::legacy")
+*
+*          GET /metrics returns conversion statistics of derived mountpoints
+*          in prometheus text format.
+*
+*          local test with loopback sockets:
+*            rtcmrelay -a 127.0.0.1 -m RAW -m L1:RAW:L1,G1,E1,L1,L1,B1I,L5 &
+*            (printf 'SOURCE x /RAW\r\n\r\n'; cat data.rtcm3) | nc 127.0.0.1 2101
+*            printf 'GET /L1 HTTP/1.0\r\n\r\n' | nc 127.0.0.1 2101 > out.rtcm3
+*-----------------------------------------------------------------------------*/
+#define _GNU_SOURCE
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <sched.h>
+#include <pthread.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "rtcmCnv.h"
+
+#define RELAY_VER   "rtcmrelay/1.0"     /* relay agent */
+#define MAXMNT      64                  /* max number of mountpoints */
+#define MAXEVENT    256                 /* max number of epoll events */
+#define MAXREQ      4096                /* max length of request header */
+#define MAXFRM      1029                /* max length of rtcm 3 frame */
+#define NIBUF       16384               /* source input buffer size */
+#define NOBUF       65536               /* mountpoint output buffer size */
+#define MAXOBUF     262144              /* max client output queue (bytes) */
+#define TINT_STAT   60                  /* statistics log interval (s) */
+#define MAXWRK      64                  /* max number of worker threads */
+#define MAXCPU      1024                /* max number of cpus */
+
+#define ST_REQ      0                   /* connection state: request header */
+#define ST_SOURCE   1                   /* connection state: source */
+#define ST_CLIENT   2                   /* connection state: client */
+#define ST_CLOSE    3                   /* connection state: close after flush */
+
+struct conn_tag;
+
+typedef struct {            /* worker type */
+    int id;                 /* worker index (0: main thread) */
+    int node;               /* numa node (-1: not pinned) */
+    pthread_t thr;          /* worker thread */
+    int epfd;               /* epoll instance */
+    int evfd;               /* eventfd of handed over connections */
+    pthread_mutex_t lock;   /* lock of handed over connections */
+    struct conn_tag *hand;  /* handed over connections */
+    struct conn_tag *closed; /* closed connections */
+    time_t tstat;           /* time of statistics log */
+    int ok;                 /* mountpoints opened */
+} wrk_con;
+
+typedef struct conn_tag {   /* connection type */
+    wrk_con *w;             /* worker of connection */
+    int fd;                 /* socket */
+    int state;              /* state (ST_???) */
+    int ver;                /* ntrip version (1,2) */
+    int mnt;                /* mountpoint index */
+    char req[MAXREQ];       /* request header */
+    int nreq;               /* length of request header */
+    int chunk,nchunk;       /* source chunk decode state/remaining bytes */
+    unsigned char *ibuf;    /* source input buffer */
+    int ni;                 /* length of source input buffer */
+    unsigned char *obuf;    /* client output queue */
+    int no,ho,sizeo;        /* length/head/size of client output queue */
+    struct conn_tag *prev,*next; /* client list of mountpoint */
+} conn_con;
+
+typedef struct {            /* mountpoint type */
+    char name[64];          /* mountpoint name */
+    int src;                /* source mountpoint index (-1: source itself) */
+    char fc[7][40];         /* frequency selection profile */
+    int tint;               /* decimation interval (ms) (0: no) */
+    int leg;                /* legacy observation conversion (RTCMLEG_???) */
+    int wrk;                /* worker index of mountpoint */
+    rtcmcvt_t *cvt;         /* rtcm converter (derived mountpoint) */
+    conn_con *source;       /* source connection */
+    conn_con *clients;      /* client connections */
+    int nclient;            /* number of clients */
+    unsigned char out[NOBUF]; /* output of current input (raw stream) */
+    int nout;               /* length of output */
+    unsigned long long bytein,byteout; /* source/sent bytes */
+} mnt_con;
+
+static mnt_con *mnts[MAXMNT];           /* mountpoints */
+static int nmnt=0;                      /* number of mountpoints */
+static wrk_con wrks[MAXWRK+1];          /* workers (0: main thread) */
+static int nwrk=0;                      /* number of worker threads */
+static pthread_barrier_t wrkbar;        /* barrier of worker start */
+static const char *passwd="";           /* source password */
+static int verify=0;                    /* verify converted msm messages */
+static int repint=0;                    /* repeated message refresh interval (s) */
+static const char *proffile=NULL;       /* profile file */
+static volatile sig_atomic_t stop=0;    /* stop flag */
+static volatile sig_atomic_t reload=0;  /* profile reload flag */
+
+static void closeconn(conn_con *c);
+
+/* signal handler ------------------------------------------------------------*/
+static void sigfunc(int sig)
+{
+    if (sig==SIGHUP) reload=1;
+    else stop=1;
+}
+/* set socket non-blocking ---------------------------------------------------*/
+static int setnonblock(int fd)
+{
+    int flags=fcntl(fd,F_GETFL,0);
+    return fcntl(fd,F_SETFL,flags|O_NONBLOCK);
+}
+/* update epoll events of connection -----------------------------------------*/
+static void setevent(conn_con *c, int out)
+{
+    struct epoll_event ev={0};
+
+    ev.events=EPOLLIN|(out?EPOLLOUT:0);
+    ev.data.ptr=c;
+    epoll_ctl(c->w->epfd,EPOLL_CTL_MOD,c->fd,&ev);
+}
+/* search mountpoint ---------------------------------------------------------*/
+static int getmnt(const char *name)
+{
+    int i;
+
+    for (i=0;i<nmnt;i++) {
+        if (!strcmp(mnts[i]->name,name)) return i;
+    }
+    return -1;
+}
+/* parse frequency selection profile -----------------------------------------*/
+static int parseprof(char *q, char fc[7][40])
+{
+    char *r;
+    int i;
+
+    for (i=0;i<7;i++) {
+        if ((r=strchr(q,','))) *r='\0';
+        if (strlen(q)>=sizeof(fc[i])) return 0;
+        strcpy(fc[i],q);
+        q=r?r+1:q+strlen(q);
+    }
+    return 1;
+}
+/* set frequency selection profile of mountpoint -----------------------------*/
+static int setprof(mnt_con *m)
+{
+    rtcmprof_t *prof;
+    char *freq_c[7];
+    int i;
+
+    for (i=0;i<7;i++) freq_c[i]=m->fc[i];
+
+    if (!(prof=rtcmprofnew(freq_c))) return 0;
+    rtcmcvtsetprof(m->cvt,prof);
+    return 1;
+}
+/* load profile file -----------------------------------------------------------
+* args   : char   *file     I   profile file (lines of "mount profile")
+* return : status (1:ok,0:error)
+*-----------------------------------------------------------------------------*/
+static int loadprof(const char *file)
+{
+    FILE *fp;
+    rtcmprof_t *p;
+    char buff[512],name[64],prof[320];
+    int i,n=0,ret=1;
+
+    if (!(fp=fopen(file,"r"))) {
+        fprintf(stderr,"profile file open error: %s\n",file);
+        return 0;
+    }
+    while (fgets(buff,sizeof(buff),fp)) {
+        if (buff[0]=='#') continue;
+        prof[0]='\0';
+        if (sscanf(buff,"%63s %319s",name,prof)<1) continue;
+
+        if ((i=getmnt(name))<0||!mnts[i]->cvt) {
+            fprintf(stderr,"profile error: %s %s\n",name,prof);
+            ret=0;
+            continue;
+        }
+        if (strchr(prof,':')) { /* selection by obs codes */
+            if (!(p=rtcmprofsig(prof))) {
+                fprintf(stderr,"profile error: %s %s\n",name,prof);
+                ret=0;
+                continue;
+            }
+            rtcmcvtsetprof(mnts[i]->cvt,p);
+        }
+        else if (!parseprof(prof,mnts[i]->fc)||!setprof(mnts[i])) {
+            fprintf(stderr,"profile error: %s %s\n",name,prof);
+            ret=0;
+            continue;
+        }
+        n++;
+    }
+    fclose(fp);
+    fprintf(stderr,"%s: profile loaded %s (%d)\n",RELAY_VER,file,n);
+    return ret;
+}
+/* add mountpoint --------------------------------------------------------------
+* args   : char   *arg      I   mountpoint option (mount[:src:profile[:tint[:fmt]]])
+* return : status (1:ok,0:error)
+*-----------------------------------------------------------------------------*/
+static int addmnt(const char *arg)
+{
+    mnt_con *m;
+    char buff[512],*p,*q,*r,*f=NULL;
+    int tint=0,leg=RTCMLEG_OFF;
+
+    if (nmnt>=MAXMNT||strlen(arg)>=sizeof(buff)) return 0;
+    strcpy(buff,arg);
+
+    if (!(m=(mnt_con *)calloc(1,sizeof(mnt_con)))) return 0;
+    m->src=-1;
+
+    if ((p=strchr(buff,':'))) {
+        *p++='\0';
+        if (!(q=strchr(p,':'))) {
+            fprintf(stderr,"no profile: %s\n",arg);
+            free(m);
+            return 0;
+        }
+        *q++='\0';
+        if ((r=strchr(q,':'))) { /* decimation interval (s) */
+            *r++='\0';
+            if ((f=strchr(r,':'))) *f++='\0';
+            if (*r&&(tint=(int)(atof(r)*1000.0+0.5))<=0) {
+                fprintf(stderr,"interval error: %s\n",arg);
+                free(m);
+                return 0;
+            }
+        }
+        if (f) { /* observables format */
+            if      (!strcmp(f,"legacy")) leg=RTCMLEG_OUT;
+            else if (!strcmp(f,"msm"   )) leg=RTCMLEG_MSM;
+            else {
+                fprintf(stderr,"format error: %s\n",arg);
+                free(m);
+                return 0;
+            }
+        }
+        if ((m->src=getmnt(p))<0||mnts[m->src]->src>=0) {
+            fprintf(stderr,"no source mountpoint: %s\n",p);
+            free(m);
+            return 0;
+        }
+        if (!parseprof(q,m->fc)) {
+            free(m);
+            return 0;
+        }
+        m->tint=tint;
+        m->leg=leg;
+    }
+
+    if (!*buff||strlen(buff)>=sizeof(m->name)||getmnt(buff)>=0) {
+        fprintf(stderr,"mountpoint error: %s\n",buff);
+        free(m);
+        return 0;
+    }
+    strcpy(m->name,buff);
+    mnts[nmnt++]=m;
+    return 1;
+}
+/* open mountpoint on owner worker ---------------------------------------------
+* the mountpoint is copied to memory allocated by the worker thread and the
+* converter is opened there, so both are placed on the numa node of the worker
+* args   : int    i         I   mountpoint index
+* return : opened mountpoint (NULL:error)
+* notes  : mnts[i] is not replaced, as other workers read mnts[] while they
+*          open their mountpoints. see setmnt()
+*-----------------------------------------------------------------------------*/
+static mnt_con *openmnt(int i)
+{
+    mnt_con *m;
+
+    if (!(m=(mnt_con *)malloc(sizeof(mnt_con)))) return NULL;
+    memcpy(m,mnts[i],sizeof(mnt_con)); /* first touch by worker */
+
+    if (m->src>=0) {
+        if (!(m->cvt=rtcmcvtopen())) {
+            free(m);
+            return NULL;
+        }
+        if (!setprof(m)) {
+            rtcmcvtclose(m->cvt);
+            free(m);
+            return NULL;
+        }
+        rtcmcvtdecim(m->cvt,m->tint,0);
+        rtcmcvtverify(m->cvt,verify);
+        rtcmcvtlegacy(m->cvt,m->leg);
+        if (repint>0&&!rtcmcvtrepeat(m->cvt,repint*1000)) {
+            rtcmcvtclose(m->cvt);
+            free(m);
+            return NULL;
+        }
+    }
+    return m;
+}
+/* replace mountpoint by opened mountpoint -----------------------------------*/
+static void setmnt(int i, mnt_con *m)
+{
+    free(mnts[i]);
+    mnts[i]=m;
+}
+/* queue data to client output ---------------------------------------------*/
+static int queueout(conn_con *c, const unsigned char *data, int n)
+{
+    unsigned char *p;
+    int size;
+
+    if (c->ho>0&&c->ho+c->no+n>c->sizeo) { /* compact queue */
+        memmove(c->obuf,c->obuf+c->ho,c->no);
+        c->ho=0;
+    }
+    if (c->no+n>c->sizeo) {
+        if (c->no+n>MAXOBUF) return 0; /* slow consumer */
+        for (size=c->sizeo?c->sizeo:4096;size<c->no+n;size*=2) ;
+        if (size>MAXOBUF) size=MAXOBUF;
+        if (!(p=(unsigned char *)realloc(c->obuf,size))) return 0;
+        c->obuf=p;
+        c->sizeo=size;
+    }
+    memcpy(c->obuf+c->ho+c->no,data,n);
+    c->no+=n;
+    return 1;
+}
+/* flush client output queue -----------------------------------------------*/
+static int flushout(conn_con *c)
+{
+    int n;
+
+    while (c->no>0) {
+        if ((n=(int)send(c->fd,c->obuf+c->ho,c->no,MSG_NOSIGNAL))<0) {
+            if (errno==EAGAIN||errno==EWOULDBLOCK) break;
+            if (errno==EINTR) continue;
+            return 0;
+        }
+        c->ho+=n;
+        c->no-=n;
+    }
+    if (c->no==0) c->ho=0;
+    setevent(c,c->no>0);
+    return 1;
+}
+/* send data to client ---------------------------------------------------------
+* write directly to socket if nothing is queued, otherwise queue the data
+*-----------------------------------------------------------------------------*/
+static int sendout(conn_con *c, const unsigned char *data, int n)
+{
+    int ns=0;
+
+    if (c->no==0) {
+        if ((ns=(int)send(c->fd,data,n,MSG_NOSIGNAL))<0) {
+            if (errno!=EAGAIN&&errno!=EWOULDBLOCK&&errno!=EINTR) return 0;
+            ns=0;
+        }
+        if (ns==n) return 1;
+    }
+    if (!queueout(c,data+ns,n-ns)) return 0;
+    setevent(c,1);
+    return 1;
+}
+/* send string to connection -------------------------------------------------*/
+static void sendstr(conn_con *c, const char *str)
+{
+    if (!sendout(c,(const unsigned char *)str,(int)strlen(str))) c->state=ST_CLOSE;
+}
+/* fan out output of mountpoint to clients -------------------------------------
+* the output is encoded once as raw (ntrip 1.0) and once as one http chunk
+* (ntrip 2.0) and then written to all clients of the mountpoint
+*-----------------------------------------------------------------------------*/
+static void fanout(mnt_con *m)
+{
+    static __thread unsigned char chunk[NOBUF+16];
+    conn_con *c,*next;
+    int n,nchunk=0;
+
+    if (m->nout<=0) return;
+
+    for (c=m->clients;c;c=next) {
+        next=c->next;
+        if (c->ver==2) {
+            if (!nchunk) {
+                n=sprintf((char *)chunk,"%X\r\n",m->nout);
+                memcpy(chunk+n,m->out,m->nout);
+                memcpy(chunk+n+m->nout,"\r\n",2);
+                nchunk=n+m->nout+2;
+            }
+            if (sendout(c,chunk,nchunk)) {m->byteout+=m->nout; continue;}
+        }
+        else if (sendout(c,m->out,m->nout)) {m->byteout+=m->nout; continue;}
+
+        fprintf(stderr,"client drop: mnt=%s fd=%d\n",m->name,c->fd);
+        closeconn(c);
+    }
+    m->nout=0;
+}
+/* append frame to output of mountpoint --------------------------------------*/
+static void appendout(mnt_con *m, const unsigned char *data, int n)
+{
+    if (m->nout+n>NOBUF) fanout(m);
+    memcpy(m->out+m->nout,data,n);
+    m->nout+=n;
+}
+/* is rtcm 3 msm message type ------------------------------------------------*/
+static int is_msm(int type)
+{
+    return type>=1071&&type<=1137&&type%10>=1&&type%10<=7;
+}
+/* is rtcm 3 ssr message type (orbit, clock, code and phase bias, ...) ------*/
+static int is_ssr(int type)
+{
+    return (type>=1057&&type<=1068)||(type>=1240&&type<=1263)||
+           (type>=1265&&type<=1270);
+}
+/* is ephemeris or station message type (repeat suppression) ----------------*/
+static int is_rep(int type)
+{
+    return type==1019||type==1020||(type>=1041&&type<=1046&&type!=1043)||
+           (type>=1005&&type<=1008)||type==1033;
+}
+/* is legacy gps/glonass observation message type (converted) ---------------*/
+static int is_leg(int type)
+{
+    return type==1002||type==1004||type==1010||type==1012;
+}
+/* input rtcm 3 frame from source --------------------------------------------*/
+static void inframe(int src, unsigned char *frm, int len)
+{
+    static __thread unsigned char out[MAXFRM+3];
+    mnt_con *m;
+    int i,type,sync,nout,ret;
+
+    if (rtcmcrc24q(frm,len-3)!=(((unsigned int)frm[len-3]<<16)|
+                                ((unsigned int)frm[len-2]<<8)|frm[len-1])) {
+        return;
+    }
+    type=(frm[3]<<4)|(frm[4]>>4);
+    if (type==1010||type==1012) sync=(frm[9]>>4)&1; /* sync flag (bit 75) */
+    else sync=(frm[9]>>1)&1; /* multiple message bit (bit 78) */
+
+    appendout(mnts[src],frm,len);
+
+    for (i=0;i<nmnt;i++) {
+        if ((m=mnts[i])->src!=src) continue;
+        if (!is_msm(type)&&!is_ssr(type)&&!(repint>0&&is_rep(type))&&
+            !(m->leg&&is_leg(type))) {
+            appendout(m,frm,len);
+            continue;
+        }
+        ret=rtcmcvtinput(m->cvt,sync,frm,len,NULL,out,&nout);
+        if (ret>0&&nout>0) appendout(m,out,nout);
+    }
+}
+/* input stream data from source -------------------------------------------*/
+static void instream(conn_con *c, const unsigned char *data, int n)
+{
+    int i,len;
+
+    mnts[c->mnt]->bytein+=n;
+
+    for (i=0;i<n;i++) {
+        if (c->ni==0&&data[i]!=0xD3) continue; /* sync preamble */
+        c->ibuf[c->ni++]=data[i];
+        if (c->ni<3) continue;
+        len=(((c->ibuf[1]&0x3)<<8)|c->ibuf[2])+6;
+        if (c->ni<len) continue;
+        inframe(c->mnt,c->ibuf,len);
+        c->ni=0;
+    }
+}
+/* input chunked stream data from source (ntrip 2.0) -------------------------
+* chunk state: 0:chunk size, 1:chunk extension, 2:chunk data, 3:crlf after data
+*-----------------------------------------------------------------------------*/
+static void inchunk(conn_con *c, const unsigned char *data, int n)
+{
+    int i=0,m,v;
+
+    while (i<n) {
+        switch (c->chunk) {
+            case 0:
+            case 1:
+                if ((v=data[i++])=='\n') {
+                    if (c->nchunk==0) { /* last chunk */
+                        c->state=ST_CLOSE;
+                        return;
+                    }
+                    c->chunk=2;
+                }
+                else if (c->chunk==1||v=='\r') ;
+                else if (v>='0'&&v<='9') c->nchunk=c->nchunk*16+v-'0';
+                else if (v>='a'&&v<='f') c->nchunk=c->nchunk*16+v-'a'+10;
+                else if (v>='A'&&v<='F') c->nchunk=c->nchunk*16+v-'A'+10;
+                else c->chunk=1;
+                break;
+            case 2:
+                m=n-i<c->nchunk?n-i:c->nchunk;
+                instream(c,data+i,m);
+                i+=m;
+                if ((c->nchunk-=m)==0) c->chunk=3;
+                break;
+            default:
+                if (data[i++]=='\n') c->chunk=c->nchunk=0;
+                break;
+        }
+    }
+}
+/* decode base64 ---------------------------------------------------------------*/
+static int decbase64(const char *str, char *out, int size)
+{
+    static const char tbl[]=
+        "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz0123456789+/";
+    const char *p;
+    unsigned int acc=0;
+    int n=0,nbit=0;
+
+    for (;*str&&*str!='='&&*str!='\r'&&*str!='\n';str++) {
+        if (!(p=strchr(tbl,*str))) return 0;
+        acc=(acc<<6)|(unsigned int)(p-tbl);
+        if ((nbit+=6)>=8) {
+            nbit-=8;
+            if (n>=size-1) return 0;
+            out[n++]=(char)((acc>>nbit)&0xFF);
+        }
+    }
+    out[n]='\0';
+    return n;
+}
+/* get header field of request -------------------------------------------------*/
+static const char *getfield(const char *req, const char *name)
+{
+    const char *p;
+    int n=(int)strlen(name);
+
+    for (p=strstr(req,"\n");p;p=strstr(p,"\n")) {
+        p++;
+        if (!strncasecmp(p,name,n)&&p[n]==':') {
+            for (p+=n+1;*p==' ';p++) ;
+            return p;
+        }
+    }
+    return NULL;
+}
+/* test source password ------------------------------------------------------*/
+static int testpasswd(const char *pass)
+{
+    return !*passwd||!strcmp(pass,passwd);
+}
+/* send source table -----------------------------------------------------------*/
+static void sendsrctbl(conn_con *c)
+{
+    char body[MAXMNT*192+32],head[256],*p=body;
+    int i;
+
+    for (i=0;i<nmnt;i++) {
+        p+=sprintf(p,"STR;%s;%s;RTCM 3;;2;;;;0.00;0.00;0;0;%s;none;N;N;0;\r\n",
+                   mnts[i]->name,mnts[i]->name,RELAY_VER);
+    }
+    p+=sprintf(p,"ENDSOURCETABLE\r\n");
+
+    if (c->ver==2) {
+        sprintf(head,"HTTP/1.1 200 OK\r\nNtrip-Version: Ntrip/2.0\r\n"
+                "Server: %s\r\nContent-Type: gnss/sourcetable\r\n"
+                "Content-Length: %d\r\nConnection: close\r\n\r\n",
+                RELAY_VER,(int)(p-body));
+    }
+    else {
+        sprintf(head,"SOURCETABLE 200 OK\r\nServer: %s\r\n"
+                "Content-Type: text/plain\r\nContent-Length: %d\r\n\r\n",
+                RELAY_VER,(int)(p-body));
+    }
+    sendstr(c,head);
+    sendstr(c,body);
+    c->state=ST_CLOSE;
+}
+/* send statistics in prometheus text format ---------------------------------*/
+static void sendmetrics(conn_con *c)
+{
+    static char body[MAXOBUF-256];
+    rtcmstat_t *stat;
+    char head[256],label[128];
+    int i,n=0,m;
+
+    if (!(stat=(rtcmstat_t *)malloc(sizeof(rtcmstat_t)))) {
+        c->state=ST_CLOSE;
+        return;
+    }
+    for (i=0;i<nmnt;i++) {
+        if (!mnts[i]->cvt) continue;
+        rtcmcvtstat(mnts[i]->cvt,stat);
+        sprintf(label,"mount=\"%s\"",mnts[i]->name);
+        if ((m=rtcmstat2prom(stat,label,body+n,(int)sizeof(body)-n))<0) break;
+        n+=m;
+    }
+    free(stat);
+    sprintf(head,"HTTP/1.1 200 OK\r\nServer: %s\r\n"
+            "Content-Type: text/plain; version=0.0.4\r\n"
+            "Content-Length: %d\r\nConnection: close\r\n\r\n",RELAY_VER,n);
+    sendstr(c,head);
+    sendout(c,(unsigned char *)body,n);
+    c->state=ST_CLOSE;
+}
+/* handle request header -------------------------------------------------------
+* ntrip 1.0 source : SOURCE passwd /mount
+* ntrip 2.0 source : POST /mount HTTP/1.1 (Authorization: Basic ...)
+* client           : GET /mount HTTP/1.x  (GET / : source table)
+*-----------------------------------------------------------------------------*/
+static void request(conn_con *c)
+{
+    char method[16],arg1[256],arg2[256],user[256],*pass;
+    const char *auth;
+    int mnt,ver;
+
+    if (sscanf(c->req,"%15s %255s %255s",method,arg1,arg2)<2) {
+        c->state=ST_CLOSE;
+        return;
+    }
+    ver=getfield(c->req,"Ntrip-Version")&&
+        !strncmp(getfield(c->req,"Ntrip-Version"),"Ntrip/2.0",9)?2:1;
+    c->ver=ver;
+
+    if (!strcmp(method,"SOURCE")) { /* ntrip 1.0 source */
+        mnt=getmnt(arg2+(*arg2=='/'));
+        if (!testpasswd(arg1)) {
+            sendstr(c,"ERROR - Bad Password\r\n");
+            c->state=ST_CLOSE;
+            return;
+        }
+        if (mnt<0||mnts[mnt]->src>=0||mnts[mnt]->source) {
+            sendstr(c,"ERROR - Bad Mountpoint\r\n");
+            c->state=ST_CLOSE;
+            return;
+        }
+        sendstr(c,"ICY 200 OK\r\n\r\n");
+    }
+    else if (!strcmp(method,"POST")) { /* ntrip 2.0 source */
+        mnt=getmnt(arg1+(*arg1=='/'));
+        *user='\0';
+        if ((auth=getfield(c->req,"Authorization"))&&!strncmp(auth,"Basic ",6)) {
+            decbase64(auth+6,user,sizeof(user));
+        }
+        pass=(pass=strchr(user,':'))?pass+1:user;
+        if (!testpasswd(pass)) {
+            sendstr(c,"HTTP/1.1 401 Unauthorized\r\nConnection: close\r\n\r\n");
+            c->state=ST_CLOSE;
+            return;
+        }
+        if (mnt<0||mnts[mnt]->src>=0||mnts[mnt]->source) {
+            sendstr(c,"HTTP/1.1 404 Not Found\r\nConnection: close\r\n\r\n");
+            c->state=ST_CLOSE;
+            return;
+        }
+        auth=getfield(c->req,"Transfer-Encoding");
+        c->chunk=auth&&!strncasecmp(auth,"chunked",7)?0:-1;
+        sendstr(c,"HTTP/1.1 200 OK\r\nNtrip-Version: Ntrip/2.0\r\n"
+                "Server: " RELAY_VER "\r\nConnection: close\r\n\r\n");
+    }
+    else if (!strcmp(method,"GET")) { /* client */
+        if (!strcmp(arg1,"/metrics")) {
+            sendmetrics(c);
+            return;
+        }
+        if (!strcmp(arg1,"/")||(mnt=getmnt(arg1+1))<0) {
+            sendsrctbl(c);
+            return;
+        }
+        if (ver==2) {
+            sendstr(c,"HTTP/1.1 200 OK\r\nNtrip-Version: Ntrip/2.0\r\n"
+                    "Server: " RELAY_VER "\r\nContent-Type: gnss/data\r\n"
+                    "Transfer-Encoding: chunked\r\nConnection: close\r\n\r\n");
+        }
+        else {
+            sendstr(c,"ICY 200 OK\r\n\r\n");
+        }
+        if (c->state==ST_CLOSE) return;
+        c->state=ST_CLIENT;
+        c->mnt=mnt;
+        c->next=mnts[mnt]->clients;
+        if (c->next) c->next->prev=c;
+        mnts[mnt]->clients=c;
+        mnts[mnt]->nclient++;
+        fprintf(stderr,"client connect: mnt=%s fd=%d ver=%d n=%d\n",
+                mnts[mnt]->name,c->fd,ver,mnts[mnt]->nclient);
+        return;
+    }
+    else {
+        sendstr(c,"HTTP/1.1 405 Method Not Allowed\r\nConnection: close\r\n\r\n");
+        c->state=ST_CLOSE;
+        return;
+    }
+    /* source connected */
+    if (c->state==ST_CLOSE) return;
+    if (!(c->ibuf=(unsigned char *)malloc(MAXFRM+3))) {
+        c->state=ST_CLOSE;
+        return;
+    }
+    if (!strcmp(method,"SOURCE")) c->chunk=-1;
+    c->state=ST_SOURCE;
+    c->mnt=mnt;
+    mnts[mnt]->source=c;
+    fprintf(stderr,"source connect: mnt=%s fd=%d ver=%d\n",mnts[mnt]->name,
+            c->fd,ver);
+}
+/* input data of source ------------------------------------------------------*/
+static void insource(conn_con *c, const unsigned char *data, int n)
+{
+    int i;
+
+    if (c->chunk>=0) inchunk(c,data,n); else instream(c,data,n);
+
+    fanout(mnts[c->mnt]);
+    for (i=0;i<nmnt;i++) {
+        if (mnts[i]->src==c->mnt) fanout(mnts[i]);
+    }
+}
+/* length of request header (0: incomplete) ---------------------------------*/
+static int headlen(const conn_con *c)
+{
+    const char *p;
+
+    if (!(p=strstr(c->req,"\r\n\r\n"))&&!(p=strstr(c->req,"\n\n"))) return 0;
+    return (int)(p-c->req)+(*p=='\r'?4:2);
+}
+/* mountpoint of request of source or client (-1: none) ---------------------*/
+static int reqmnt(const conn_con *c)
+{
+    char method[16],arg1[256],arg2[256];
+
+    if (sscanf(c->req,"%15s %255s %255s",method,arg1,arg2)<2) return -1;
+    if (!strcmp(method,"SOURCE")) return getmnt(arg2+(*arg2=='/'));
+    if (!strcmp(method,"POST")) return getmnt(arg1+(*arg1=='/'));
+    if (!strcmp(method,"GET")&&*arg1=='/') return getmnt(arg1+1);
+    return -1;
+}
+/* hand over connection to worker --------------------------------------------*/
+static void handover(conn_con *c, wrk_con *w)
+{
+    uint64_t one=1;
+    ssize_t n;
+
+    epoll_ctl(c->w->epfd,EPOLL_CTL_DEL,c->fd,NULL);
+    pthread_mutex_lock(&w->lock);
+    c->next=w->hand;
+    w->hand=c;
+    pthread_mutex_unlock(&w->lock);
+    n=write(w->evfd,&one,sizeof(one)); /* counter never overflows */
+    (void)n;
+}
+/* handle request header and stream data following it ------------------------*/
+static void procreq(conn_con *c, int nhead)
+{
+    request(c);
+
+    if (c->state==ST_SOURCE&&c->nreq>nhead) {
+        insource(c,(unsigned char *)c->req+nhead,c->nreq-nhead);
+    }
+}
+/* read request header -------------------------------------------------------
+* return : status (1:ok,0:connection handed over to worker)
+*-----------------------------------------------------------------------------*/
+static int readreq(conn_con *c, const unsigned char *data, int n)
+{
+    int m,nhead,mnt;
+
+    m=n<MAXREQ-1-c->nreq?n:MAXREQ-1-c->nreq;
+    memcpy(c->req+c->nreq,data,m);
+    c->nreq+=m;
+    c->req[c->nreq]='\0';
+
+    if (!(nhead=headlen(c))) {
+        if (c->nreq>=MAXREQ-1) c->state=ST_CLOSE;
+        return 1;
+    }
+    if (nwrk>0&&(mnt=reqmnt(c))>=0) {
+        handover(c,wrks+mnts[mnt]->wrk);
+        return 0;
+    }
+    procreq(c,nhead);
+
+    /* stream data following request header */
+    if (n>m&&c->state==ST_SOURCE) insource(c,data+m,n-m);
+    return 1;
+}
+/* attach connections handed over to worker ----------------------------------
+* the connection is moved to memory allocated by the worker before the request
+* is handled, so the connection is placed on the numa node of the worker
+*-----------------------------------------------------------------------------*/
+static void attachconn(wrk_con *w)
+{
+    struct epoll_event ev={0};
+    conn_con *list,*h,*c;
+    uint64_t cnt;
+
+    if (read(w->evfd,&cnt,sizeof(cnt))<0) return;
+
+    pthread_mutex_lock(&w->lock);
+    list=w->hand;
+    w->hand=NULL;
+    pthread_mutex_unlock(&w->lock);
+
+    while ((h=list)) {
+        list=h->next;
+        if (!(c=(conn_con *)malloc(sizeof(conn_con)))) {
+            close(h->fd);
+            free(h);
+            continue;
+        }
+        memcpy(c,h,sizeof(conn_con));
+        free(h);
+        c->w=w;
+        c->next=NULL;
+        ev.events=EPOLLIN;
+        ev.data.ptr=c;
+        if (epoll_ctl(w->epfd,EPOLL_CTL_ADD,c->fd,&ev)<0) {
+            close(c->fd);
+            free(c);
+            continue;
+        }
+        procreq(c,headlen(c));
+        if (c->state==ST_CLOSE&&c->no==0) closeconn(c);
+    }
+}
+/* read connection -----------------------------------------------------------*/
+static void readconn(conn_con *c)
+{
+    static __thread unsigned char buff[NIBUF];
+    int n,size;
+
+    for (;;) {
+        /* data after request header left in socket for handover */
+        size=c->state==ST_REQ&&nwrk>0?MAXREQ-1-c->nreq:NIBUF;
+        if ((n=(int)recv(c->fd,buff,size,0))==0) break;
+        if (n<0) {
+            if (errno==EINTR) continue;
+            if (errno==EAGAIN||errno==EWOULDBLOCK) return;
+            break;
+        }
+        if      (c->state==ST_SOURCE) insource(c,buff,n);
+        else if (c->state==ST_REQ   ) {
+            if (!readreq(c,buff,n)) return; /* handed over */
+        }
+
+        if (c->state==ST_CLOSE) {
+            if (c->no==0) break;
+            return; /* close after flush */
+        }
+    }
+    closeconn(c);
+}
+/* close connection ------------------------------------------------------------
+* the connection is freed by freeconn() after the events in process, since
+* a client may be closed by the events of another connection
+*-----------------------------------------------------------------------------*/
+static void closeconn(conn_con *c)
+{
+    mnt_con *m;
+
+    if (c->fd<0) return;
+
+    if (c->state==ST_CLIENT) {
+        m=mnts[c->mnt];
+        if (c->prev) c->prev->next=c->next; else m->clients=c->next;
+        if (c->next) c->next->prev=c->prev;
+        m->nclient--;
+        fprintf(stderr,"client disconnect: mnt=%s fd=%d n=%d\n",m->name,c->fd,
+                m->nclient);
+    }
+    if (c->mnt>=0&&mnts[c->mnt]->source==c) {
+        mnts[c->mnt]->source=NULL;
+        fprintf(stderr,"source disconnect: mnt=%s fd=%d\n",mnts[c->mnt]->name,
+                c->fd);
+    }
+    epoll_ctl(c->w->epfd,EPOLL_CTL_DEL,c->fd,NULL);
+    close(c->fd);
+    c->fd=-1;
+    c->state=ST_CLOSE;
+    c->next=c->w->closed;
+    c->w->closed=c;
+}
+/* free closed connections of worker -----------------------------------------*/
+static void freeconn(wrk_con *w)
+{
+    conn_con *c;
+
+    while ((c=w->closed)) {
+        w->closed=c->next;
+        free(c->ibuf);
+        free(c->obuf);
+        free(c);
+    }
+}
+/* close all connections after workers stopped -------------------------------*/
+static void closeall(void)
+{
+    conn_con *c;
+    int i;
+
+    for (i=0;i<nmnt;i++) {
+        while (mnts[i]->clients) closeconn(mnts[i]->clients);
+        if (mnts[i]->source) closeconn(mnts[i]->source);
+    }
+    for (i=0;i<=nwrk;i++) {
+        while ((c=wrks[i].hand)) {
+            wrks[i].hand=c->next;
+            close(c->fd);
+            free(c);
+        }
+        freeconn(wrks+i);
+    }
+}
+/* accept connections --------------------------------------------------------*/
+static void acceptconn(int sock)
+{
+    struct epoll_event ev={0};
+    conn_con *c;
+    int fd,on=1;
+
+    while ((fd=accept(sock,NULL,NULL))>=0) {
+        if (!(c=(conn_con *)calloc(1,sizeof(conn_con)))) {
+            close(fd);
+            continue;
+        }
+        setnonblock(fd);
+        setsockopt(fd,IPPROTO_TCP,TCP_NODELAY,&on,sizeof(on));
+        c->w=wrks;
+        c->fd=fd;
+        c->state=ST_REQ;
+        c->mnt=-1;
+        c->chunk=-1;
+        ev.events=EPOLLIN;
+        ev.data.ptr=c;
+        if (epoll_ctl(wrks->epfd,EPOLL_CTL_ADD,fd,&ev)<0) {
+            close(fd);
+            free(c);
+        }
+    }
+}
+/* output statistics log of mountpoints of worker ---------------------------*/
+static void logstat(const wrk_con *w)
+{
+    rtcmstat_t *stat;
+    unsigned long long nin,nout;
+    int i,j;
+
+    if (!(stat=(rtcmstat_t *)malloc(sizeof(rtcmstat_t)))) return;
+
+    for (i=0;i<nmnt;i++) {
+        if (mnts[i]->wrk!=w->id) continue;
+        if (!mnts[i]->cvt) {
+            fprintf(stderr,"%-16s source=%d clients=%5d in=%llu bytes\n",
+                    mnts[i]->name,mnts[i]->source!=NULL,mnts[i]->nclient,
+                    mnts[i]->bytein);
+            continue;
+        }
+        rtcmcvtstat(mnts[i]->cvt,stat);
+        for (j=0,nin=nout=0;j<RTCMSTAT_NTYPE;j++) {
+            nin+=stat->nin[j];
+            nout+=stat->nout[j];
+        }
+        fprintf(stderr,"%-16s clients=%5d msm in=%llu out=%llu frames "
+                "%llu->%llu bytes cvt=%.1f us/frame sent=%llu bytes\n",
+                mnts[i]->name,mnts[i]->nclient,nin,nout,stat->bytein,
+                stat->byteout,nin?stat->latsum[2]*1E-3/nin:0.0,
+                mnts[i]->byteout);
+    }
+    free(stat);
+}
+/* process events of worker ----------------------------------------------------
+* args   : wrk_con *w       IO  worker
+*          int    sock      I   listen socket (main thread)
+* return : status (1:ok,0:error)
+*-----------------------------------------------------------------------------*/
+static int wrkevent(wrk_con *w, int sock)
+{
+    struct epoll_event evs[MAXEVENT];
+    conn_con *c;
+    int i,n;
+
+    if ((n=epoll_wait(w->epfd,evs,MAXEVENT,1000))<0) return errno==EINTR;
+
+    for (i=0;i<n;i++) {
+        if (!evs[i].data.ptr) {
+            acceptconn(sock);
+            continue;
+        }
+        if (evs[i].data.ptr==(void *)w) {
+            attachconn(w);
+            continue;
+        }
+        c=(conn_con *)evs[i].data.ptr;
+        if (c->fd<0) continue; /* closed in this loop */
+
+        if (evs[i].events&(EPOLLERR|EPOLLHUP)&&!(evs[i].events&EPOLLIN)) {
+            closeconn(c);
+            continue;
+        }
+        if (evs[i].events&EPOLLOUT) {
+            if (!flushout(c)||(c->state==ST_CLOSE&&c->no==0)) {
+                closeconn(c);
+                continue;
+            }
+        }
+        if (evs[i].events&EPOLLIN) readconn(c);
+    }
+    freeconn(w);
+    if (time(NULL)-w->tstat>=TINT_STAT) {
+        logstat(w);
+        w->tstat=time(NULL);
+    }
+    return 1;
+}
+/* read cpu or node list of sysfs (ex: "0-3,8-11") ---------------------------*/
+static int readlist(const char *file, int *list, int nmax)
+{
+    FILE *fp;
+    char buff[4096],*p;
+    int a,b,n=0;
+
+    if (!(fp=fopen(file,"r"))) return 0;
+    if (!fgets(buff,sizeof(buff),fp)) *buff='\0';
+    fclose(fp);
+
+    for (p=buff;*p>='0'&&*p<='9';p++) {
+        a=b=(int)strtol(p,&p,10);
+        if (*p=='-') b=(int)strtol(p+1,&p,10);
+        for (;a<=b&&n<nmax;a++) list[n++]=a;
+        if (*p!=',') break;
+    }
+    return n;
+}
+/* pin thread to cpus of numa node -------------------------------------------*/
+static int pinnode(int node)
+{
+    cpu_set_t set;
+    char file[64];
+    int i,n,cpu[MAXCPU];
+
+    sprintf(file,"/sys/devices/system/node/node%d/cpulist",node);
+    if ((n=readlist(file,cpu,MAXCPU))<=0) return 0;
+
+    CPU_ZERO(&set);
+    for (i=0;i<n;i++) {
+        if (cpu[i]<CPU_SETSIZE) CPU_SET(cpu[i],&set);
+    }
+    return !pthread_setaffinity_np(pthread_self(),sizeof(set),&set);
+}
+/* open worker -----------------------------------------------------------------*/
+static int openwrk(wrk_con *w, int id, int node)
+{
+    struct epoll_event ev={0};
+
+    w->id=id;
+    w->node=node;
+    w->tstat=time(NULL);
+    pthread_mutex_init(&w->lock,NULL);
+    if ((w->epfd=epoll_create1(0))<0) return 0;
+    if ((w->evfd=eventfd(0,EFD_NONBLOCK))<0) {
+        close(w->epfd);
+        return 0;
+    }
+    ev.events=EPOLLIN;
+    ev.data.ptr=w; /* handed over connections */
+    epoll_ctl(w->epfd,EPOLL_CTL_ADD,w->evfd,&ev);
+    return 1;
+}
+/* worker thread ---------------------------------------------------------------
+* pin the thread to the numa node, open the mountpoints of the worker on the
+* node and run the event loop of the connections handed over. the mountpoints
+* are replaced only after all workers have read mnts[] to open theirs (first
+* barrier), and the event loops start after all are replaced (second barrier)
+*-----------------------------------------------------------------------------*/
+static void *wrkthread(void *arg)
+{
+    wrk_con *w=(wrk_con *)arg;
+    mnt_con *m[MAXMNT]={0};
+    sigset_t set;
+    int i;
+
+    sigfillset(&set);
+    pthread_sigmask(SIG_BLOCK,&set,NULL); /* signals to main thread */
+
+    if (w->node>=0&&!pinnode(w->node)) w->node=-1;
+
+    for (i=0;i<nmnt;i++) {
+        if (mnts[i]->wrk==w->id&&!(m[i]=openmnt(i))) w->ok=0;
+    }
+    pthread_barrier_wait(&wrkbar); /* mountpoints opened */
+
+    for (i=0;i<nmnt;i++) {
+        if (m[i]) setmnt(i,m[i]);
+    }
+    pthread_barrier_wait(&wrkbar); /* mountpoints replaced */
+    if (!w->ok) return NULL;
+
+    while (!stop&&wrkevent(w,-1)) ;
+
+    logstat(w);
+    return NULL;
+}
+/* open listen socket --------------------------------------------------------*/
+static int openlisten(const char *addr, int port)
+{
+    struct sockaddr_in sa={0};
+    int sock,on=1;
+
+    sa.sin_family=AF_INET;
+    sa.sin_port=htons((unsigned short)port);
+    if (inet_pton(AF_INET,addr,&sa.sin_addr)!=1) {
+        fprintf(stderr,"address error: %s\n",addr);
+        return -1;
+    }
+    if ((sock=socket(AF_INET,SOCK_STREAM,0))<0) return -1;
+    setsockopt(sock,SOL_SOCKET,SO_REUSEADDR,&on,sizeof(on));
+
+    if (bind(sock,(struct sockaddr *)&sa,sizeof(sa))<0||listen(sock,1024)<0) {
+        fprintf(stderr,"bind/listen error: %s:%d (%s)\n",addr,port,
+                strerror(errno));
+        close(sock);
+        return -1;
+    }
+    setnonblock(sock);
+    return sock;
+}
+/* raise open file limit for client connections ------------------------------*/
+static void setfilelimit(void)
+{
+    struct rlimit rl;
+
+    if (getrlimit(RLIMIT_NOFILE,&rl)==0&&rl.rlim_cur<rl.rlim_max) {
+        rl.rlim_cur=rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE,&rl);
+    }
+}
+/* main ----------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    struct epoll_event ev={0};
+    mnt_con *m;
+    const char *addr="0.0.0.0";
+    int i,j,sock,port=2101,level=0,node[MAXWRK],nnode,stat=1;
+
+    for (i=1;i<argc;i++) {
+        if      (!strcmp(argv[i],"-a")&&i+1<argc) addr=argv[++i];
+        else if (!strcmp(argv[i],"-p")&&i+1<argc) port=atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-w")&&i+1<argc) passwd=argv[++i];
+        else if (!strcmp(argv[i],"-t")&&i+1<argc) level=atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-v")) verify=1;
+        else if (!strcmp(argv[i],"-e")&&i+1<argc) repint=atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-r")&&i+1<argc) proffile=argv[++i];
+        else if (!strcmp(argv[i],"-n")&&i+1<argc) nwrk=atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-m")&&i+1<argc) {
+            if (!addmnt(argv[++i])) return -1;
+        }
+        else {
+            fprintf(stderr,"usage: rtcmrelay [-a addr] [-p port] [-w passwd] "
+                    "[-t level] [-v] [-e tint] [-r file] [-n nwrk] "
+                    "-m mount[:src:profile[:tint[:fmt]]] ...\n");
+            return -1;
+        }
+    }
+    if (nmnt<=0) {
+        fprintf(stderr,"no mountpoint\n");
+        return -1;
+    }
+    if (nwrk<0) nwrk=0; else if (nwrk>MAXWRK) nwrk=MAXWRK;
+
+    /* sources to workers in turn, derived mountpoints to worker of source */
+    for (i=j=0;i<nmnt;i++) {
+        if (mnts[i]->src>=0) mnts[i]->wrk=mnts[mnts[i]->src]->wrk;
+        else mnts[i]->wrk=nwrk>0?1+j++%nwrk:0;
+    }
+    if (level>0) {
+        rtcmlogopen("rtcmrelay.log");
+        rtcmloglevel(level);
+    }
+    signal(SIGPIPE,SIG_IGN);
+    signal(SIGINT,sigfunc);
+    signal(SIGTERM,sigfunc);
+    signal(SIGHUP,sigfunc);
+    setfilelimit();
+
+    if ((sock=openlisten(addr,port))<0) return -1;
+
+    if (!openwrk(wrks,0,-1)) {
+        close(sock);
+        return -1;
+    }
+    ev.events=EPOLLIN;
+    ev.data.ptr=NULL; /* listen socket */
+    epoll_ctl(wrks->epfd,EPOLL_CTL_ADD,sock,&ev);
+
+    if (nwrk<=0) {
+        for (i=0;i<nmnt;i++) {
+            if (!(m=openmnt(i))) stat=0; else setmnt(i,m);
+        }
+    }
+    else {
+        nnode=readlist("/sys/devices/system/node/online",node,MAXWRK);
+        pthread_barrier_init(&wrkbar,NULL,nwrk+1);
+
+        for (i=1;i<=nwrk;i++) {
+            if (!openwrk(wrks+i,i,nnode>0?node[(i-1)%nnode]:-1)) {
+                fprintf(stderr,"worker open error\n");
+                return -1;
+            }
+            wrks[i].ok=1;
+            if (pthread_create(&wrks[i].thr,NULL,wrkthread,wrks+i)) {
+                fprintf(stderr,"worker create error\n");
+                return -1;
+            }
+        }
+        pthread_barrier_wait(&wrkbar); /* mountpoints opened by workers */
+        pthread_barrier_wait(&wrkbar); /* mountpoints replaced by workers */
+
+        for (i=1;i<=nwrk;i++) {
+            if (!wrks[i].ok) stat=0;
+        }
+    }
+    if (stat&&proffile&&!loadprof(proffile)) stat=0;
+
+    if (stat) {
+        fprintf(stderr,"%s: listen %s:%d mountpoints=%d workers=%d\n",RELAY_VER,
+                addr,port,nmnt,nwrk);
+        for (i=1;i<=nwrk;i++) {
+            fprintf(stderr,"%s: worker %d node %d\n",RELAY_VER,i,wrks[i].node);
+        }
+    }
+    while (stat&&!stop) {
+        if (reload) {
+            reload=0;
+            if (proffile) loadprof(proffile);
+        }
+        if (!wrkevent(wrks,sock)) break;
+    }
+    stop=1;
+    fprintf(stderr,"%s: stop\n",RELAY_VER);
+    logstat(wrks);
+
+    for (i=1;i<=nwrk;i++) {
+        pthread_join(wrks[i].thr,NULL);
+    }
+    closeall();
+
+    for (i=0;i<=nwrk;i++) {
+        close(wrks[i].epfd);
+        close(wrks[i].evfd);
+    }
+    close(sock);
+    for (i=0;i<nmnt;i++) {
+        rtcmcvtclose(mnts[i]->cvt);
+        free(mnts[i]);
+    }
+    rtcmlogclose();
+    return stat?0:-1;
+}
@@ -0,0 +1,460 @@
+/*------------------------------------------------------------------------------
+* bench_relay.c : ntrip relay throughput and latency benchmark
+*
+* notes  : start rtcmrelay on a free loopback port with nsrc source
+*          mountpoints RAW<k> and derived mountpoints L1_<k>, connect nclient
+*          clients to the derived mountpoints in turn and send the stream as
+*          all sources. the benchmark and the relay run on the same host, so
+*          the sender and the clients share the cpus with the relay.
+*
+*          throughput (-r 0): the stream is sent nloop times as fast as the
+*          relay reads it. the time until all clients received all converted
+*          data gives the input frame rate and the fan-out rate.
+*
+*          latency (-r rate): the epochs of the stream (msm frames up to the
+*          one with multiple message bit 0) are sent at rate epochs/s per
+*          source. the latency of an epoch is the time from sending its last
+*          byte to a client receiving the last byte of its converted output.
+*
+*          numa: the pages of the relay on each node (/proc/<pid>/numa_maps)
+*          at the end of the run, the page allocations on local and other
+*          nodes of the host during the run (numastat of the nodes) and the
+*          node loads and node load misses (loads from memory of other nodes)
+*          of the relay threads in user space by perf events (n/a without
+*          hardware counters). run with -n 0 and -n <nodes> to compare the
+*          cross-node traffic without and with placement of the workers.
+*
+*          usage : bench_relay rtcmrelay stream [-c nclient] [-s nsrc]
+*                              [-n nwrk] [-l nloop] [-r rate]
+*-----------------------------------------------------------------------------*/
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <dirent.h>
+#include <sys/epoll.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <sys/syscall.h>
+#include <sys/wait.h>
+#include <linux/perf_event.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <arpa/inet.h>
+#include "tutil.h"
+
+#define PROF_L1     "L1,G1,E1,L1,L1,B1I,L5"
+#define MAXSRC      64          /* max number of sources */
+#define MAXEP       100000      /* max number of epochs */
+#define TIMEOUT     30.0        /* timeout without progress (s) */
+#define MAXNODE     64          /* max number of numa nodes */
+#define MAXTHR      128         /* max number of relay threads counted */
+
+typedef struct {            /* client type */
+    int fd;                 /* socket */
+    int mnt;                /* derived mountpoint index */
+    long long nrecv;        /* received bytes */
+    int ep;                 /* next epoch to receive */
+} cli_t;
+
+static double *lat;         /* latency samples (s) */
+static long nlat=0,nlatmax=0;
+
+/* current time (s) ----------------------------------------------------------*/
+static double now(void)
+{
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC,&tp);
+    return tp.tv_sec+tp.tv_nsec*1E-9;
+}
+/* cpu time of process (s) ---------------------------------------------------*/
+static double cputime(pid_t pid)
+{
+    FILE *fp;
+    char file[64],buff[1024],*p;
+    unsigned long ut=0,st=0;
+
+    sprintf(file,"/proc/%d/stat",(int)pid);
+    if (!(fp=fopen(file,"r"))) return 0.0;
+    if (!fgets(buff,sizeof(buff),fp)) *buff='\0';
+    fclose(fp);
+    if (!(p=strrchr(buff,')'))) return 0.0;
+    sscanf(p+2,"%*c %*d %*d %*d %*d %*d %*u %*u %*u %*u %*u %lu %lu",&ut,&st);
+    return (double)(ut+st)/sysconf(_SC_CLK_TCK);
+}
+/* pages of process on numa nodes (return: number of nodes) -----------------*/
+static int numapages(pid_t pid, long long *pages)
+{
+    FILE *fp;
+    char file[64],buff[4096],*p;
+    long long v;
+    int k,nnode=0;
+
+    memset(pages,0,sizeof(long long)*MAXNODE);
+    sprintf(file,"/proc/%d/numa_maps",(int)pid);
+    if (!(fp=fopen(file,"r"))) return 0;
+    while (fgets(buff,sizeof(buff),fp)) {
+        for (p=buff;(p=strstr(p," N"));p++) {
+            if (sscanf(p," N%d=%lld",&k,&v)<2||k<0||k>=MAXNODE) continue;
+            pages[k]+=v;
+            if (k>=nnode) nnode=k+1;
+        }
+    }
+    fclose(fp);
+    return nnode;
+}
+/* page allocations on local and other nodes of host (numastat) --------------*/
+static void numastat(long long *local, long long *other)
+{
+    FILE *fp;
+    char file[64],buff[256];
+    long long v;
+    int k;
+
+    *local=*other=0;
+    for (k=0;k<MAXNODE;k++) {
+        sprintf(file,"/sys/devices/system/node/node%d/numastat",k);
+        if (!(fp=fopen(file,"r"))) continue;
+        while (fgets(buff,sizeof(buff),fp)) {
+            if      (sscanf(buff,"local_node %lld",&v)==1) *local+=v;
+            else if (sscanf(buff,"other_node %lld",&v)==1) *other+=v;
+        }
+        fclose(fp);
+    }
+}
+/* open node load and miss counters of threads of process ----------------------
+* return : number of threads counted (-1: no counters)
+*-----------------------------------------------------------------------------*/
+static int opennode(pid_t pid, int *fd)
+{
+    struct perf_event_attr pa;
+    struct dirent *d;
+    DIR *dir;
+    char path[64];
+    int i,n=0;
+
+    sprintf(path,"/proc/%d/task",(int)pid);
+    if (!(dir=opendir(path))) return -1;
+
+    while ((d=readdir(dir))&&n<MAXTHR) {
+        if (d->d_name[0]=='.') continue;
+        for (i=0;i<2;i++) {
+            memset(&pa,0,sizeof(pa));
+            pa.type=PERF_TYPE_HW_CACHE;
+            pa.size=sizeof(pa);
+            pa.config=PERF_COUNT_HW_CACHE_NODE|
+                      (PERF_COUNT_HW_CACHE_OP_READ<<8)|
+                      ((i?PERF_COUNT_HW_CACHE_RESULT_MISS:
+                          PERF_COUNT_HW_CACHE_RESULT_ACCESS)<<16);
+            pa.exclude_kernel=1;
+            pa.exclude_hv=1;
+            fd[2*n+i]=(int)syscall(SYS_perf_event_open,&pa,atoi(d->d_name),-1,
+                                   -1,0);
+        }
+        if (fd[2*n]<0||fd[2*n+1]<0) {
+            for (i=0;i<2*n+2;i++) if (fd[i]>=0) close(fd[i]);
+            closedir(dir);
+            return -1;
+        }
+        n++;
+    }
+    closedir(dir);
+    return n;
+}
+/* read and close node load and miss counters --------------------------------*/
+static void readnode(const int *fd, int n, long long *load, long long *miss)
+{
+    long long v;
+    int i;
+
+    *load=*miss=0;
+    for (i=0;i<2*n;i++) {
+        if (read(fd[i],&v,sizeof(v))==(ssize_t)sizeof(v)) {
+            if (i%2) *miss+=v; else *load+=v;
+        }
+        close(fd[i]);
+    }
+}
+/* free loopback port --------------------------------------------------------*/
+static int freeport(void)
+{
+    struct sockaddr_in sa={0};
+    socklen_t len=sizeof(sa);
+    int sock,port=0;
+
+    sa.sin_family=AF_INET;
+    sa.sin_addr.s_addr=htonl(INADDR_LOOPBACK);
+    if ((sock=socket(AF_INET,SOCK_STREAM,0))<0) return 0;
+    if (!bind(sock,(struct sockaddr *)&sa,sizeof(sa))&&
+        !getsockname(sock,(struct sockaddr *)&sa,&len)) {
+        port=ntohs(sa.sin_port);
+    }
+    close(sock);
+    return port;
+}
+/* connect to relay, send request and receive response header ---------------*/
+static int connreq(int port, const char *req)
+{
+    struct sockaddr_in sa={0};
+    char buff[256];
+    int sock=-1,i,n=0,on=1;
+
+    sa.sin_family=AF_INET;
+    sa.sin_port=htons((unsigned short)port);
+    sa.sin_addr.s_addr=htonl(INADDR_LOOPBACK);
+
+    for (i=0;i<50;i++) { /* relay may be starting */
+        if ((sock=socket(AF_INET,SOCK_STREAM,0))<0) return -1;
+        if (!connect(sock,(struct sockaddr *)&sa,sizeof(sa))) break;
+        close(sock);
+        sock=-1;
+        usleep(100000);
+    }
+    if (sock<0) return -1;
+    setsockopt(sock,IPPROTO_TCP,TCP_NODELAY,&on,sizeof(on));
+    if (send(sock,req,strlen(req),0)!=(ssize_t)strlen(req)) {
+        close(sock);
+        return -1;
+    }
+    while (n<(int)sizeof(buff)-1&&recv(sock,buff+n,1,0)==1) {
+        buff[++n]='\0';
+        if (n>=4&&!strcmp(buff+n-4,"\r\n\r\n")) {
+            fcntl(sock,F_SETFL,fcntl(sock,F_GETFL,0)|O_NONBLOCK);
+            return sock;
+        }
+    }
+    close(sock);
+    return -1;
+}
+/* epochs of stream (return: number of epochs) -------------------------------*/
+static int epochs(const unsigned char *data, int n, int *epend)
+{
+    int p=0,len,nep=0;
+
+    for (;(len=nextframe(data,n,&p))>0&&nep<MAXEP;p+=len) {
+        if (is_msm(frametype(data+p))&&!framesync(data+p)) epend[nep++]=p+len;
+    }
+    return nep;
+}
+/* converted output bytes of derived mountpoint at end of epochs -------------*/
+static long long expout(const unsigned char *data, int n, const int *epend,
+                        int nep, long long *cum)
+{
+    char *freq_c[7]=TPROF_L1;
+    rtcmcvt_t *cvt=rtcmcvtopen();
+    unsigned char buff[1200];
+    long long nout=0;
+    int p=0,len,type,lsd,ep=0;
+
+    rtcmcvtsetprof(cvt,rtcmprofnew(freq_c));
+
+    for (;(len=nextframe(data,n,&p))>0;p+=len) {
+        for (;ep<nep&&epend[ep]<=p;ep++) cum[ep]=nout;
+        type=frametype(data+p);
+        if (!is_msm(type)&&!is_ssr(type)) nout+=len;
+        else if (rtcmcvtinput(cvt,framesync(data+p),(unsigned char *)data+p,len,
+                              NULL,buff,&lsd)>0) {
+            nout+=lsd;
+        }
+    }
+    for (;ep<nep;ep++) cum[ep]=nout;
+    rtcmcvtclose(cvt);
+    return nout;
+}
+/* add latency sample ----------------------------------------------------------*/
+static void addlat(double t)
+{
+    double *p;
+
+    if (nlat>=nlatmax) {
+        nlatmax=nlatmax?nlatmax*2:65536;
+        if (!(p=(double *)realloc(lat,sizeof(double)*nlatmax))) return;
+        lat=p;
+    }
+    lat[nlat++]=t;
+}
+static int cmplat(const void *a, const void *b)
+{
+    double d=*(const double *)a-*(const double *)b;
+    return d<0.0?-1:(d>0.0?1:0);
+}
+/* raise open file limit -------------------------------------------------------*/
+static void setfilelimit(void)
+{
+    struct rlimit rl;
+
+    if (getrlimit(RLIMIT_NOFILE,&rl)==0&&rl.rlim_cur<rl.rlim_max) {
+        rl.rlim_cur=rl.rlim_max;
+        setrlimit(RLIMIT_NOFILE,&rl);
+    }
+}
+/* main ----------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    static int epend[MAXEP];
+    static long long cum[MAXEP];
+    static double tsend[MAXSRC][MAXEP];
+    static unsigned char buff[65536];
+    struct epoll_event ev={0},evs[256];
+    unsigned char *data;
+    char **args,port_s[16],nwrk_s[16],req[128];
+    long long nexp,nsent[MAXSRC]={0},ntot,nrecv=0,pages[MAXNODE];
+    long long loc0,loc1,oth0,oth1,nload=0,nmiss=0;
+    double rate=0.0,t0,t1,tlast,c0,c1,tnext;
+    int i,j,k,n,m,nep,port,nclient=100,nsrc=1,nwrk=0,nloop=10,epfd,na=0;
+    int fdn[2*MAXTHR],nthr,nnode;
+    int src[MAXSRC],sep[MAXSRC]={0},ndone=0,nframe=0,p=0,len;
+    cli_t *cli,*c;
+    pid_t pid;
+
+    if (argc<3) {
+        fprintf(stderr,"usage: bench_relay rtcmrelay stream [-c nclient] "
+                "[-s nsrc] [-n nwrk] [-l nloop] [-r rate]\n");
+        return 1;
+    }
+    for (i=3;i<argc;i++) {
+        if      (!strcmp(argv[i],"-c")&&i+1<argc) nclient=atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-s")&&i+1<argc) nsrc=atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-n")&&i+1<argc) nwrk=atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-l")&&i+1<argc) nloop=atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-r")&&i+1<argc) rate=atof(argv[++i]);
+    }
+    if (nsrc<1) nsrc=1; else if (nsrc>MAXSRC) nsrc=MAXSRC;
+    if (nclient<1) nclient=1;
+    if (rate>0.0) nloop=1;
+    signal(SIGPIPE,SIG_IGN);
+    setfilelimit();
+
+    if (!(data=readfile(NULL,argv[2],&n))) return 1;
+    for (;(len=nextframe(data,n,&p))>0;p+=len) nframe++;
+    nep=epochs(data,n,epend);
+    nexp=expout(data,n,epend,nep,cum);
+
+    /* start relay */
+    if (!(port=freeport())) return 1;
+    sprintf(port_s,"%d",port);
+    sprintf(nwrk_s,"%d",nwrk);
+    args=(char **)calloc(10+4*nsrc,sizeof(char *));
+    args[na++]=argv[1];
+    args[na++]="-a"; args[na++]="127.0.0.1";
+    args[na++]="-p"; args[na++]=port_s;
+    args[na++]="-n"; args[na++]=nwrk_s;
+    for (i=0;i<nsrc;i++) {
+        args[na++]="-m"; args[na]=(char *)malloc(16); sprintf(args[na++],"RAW%d",i);
+        args[na++]="-m"; args[na]=(char *)malloc(64);
+        sprintf(args[na++],"L1_%d:RAW%d:%s",i,i,PROF_L1);
+    }
+    if (!(pid=fork())) {
+        freopen("/dev/null","w",stderr);
+        execv(argv[1],args);
+        _exit(127);
+    }
+    /* connect clients and sources */
+    epfd=epoll_create1(0);
+    cli=(cli_t *)calloc(nclient,sizeof(cli_t));
+    for (i=0;i<nclient;i++) {
+        cli[i].mnt=i%nsrc;
+        sprintf(req,"GET /L1_%d HTTP/1.0\r\n\r\n",cli[i].mnt);
+        if ((cli[i].fd=connreq(port,req))<0) {
+            fprintf(stderr,"client connect error: %d\n",i);
+            kill(pid,SIGTERM);
+            return 1;
+        }
+        ev.events=EPOLLIN;
+        ev.data.ptr=cli+i;
+        epoll_ctl(epfd,EPOLL_CTL_ADD,cli[i].fd,&ev);
+    }
+    for (i=0;i<nsrc;i++) {
+        sprintf(req,"SOURCE x /RAW%d\r\n\r\n",i);
+        if ((src[i]=connreq(port,req))<0) {
+            fprintf(stderr,"source connect error: %d\n",i);
+            kill(pid,SIGTERM);
+            return 1;
+        }
+    }
+    ntot=(long long)nloop*n;
+    nthr=opennode(pid,fdn);
+    numastat(&loc0,&oth0);
+    c0=cputime(pid);
+    t0=tlast=now();
+
+    while (ndone<nclient&&now()-tlast<TIMEOUT) {
+        /* send stream of sources */
+        tnext=1.0;
+        for (i=0;i<nsrc;i++) {
+            if (nsent[i]>=ntot) continue;
+            if (rate>0.0) { /* paced by epochs */
+                if (sep[i]<nep&&now()<t0+sep[i]/rate) {
+                    if (t0+sep[i]/rate-now()<tnext) tnext=t0+sep[i]/rate-now();
+                    continue;
+                }
+                m=(sep[i]<nep?epend[sep[i]]:n)-(int)nsent[i];
+            }
+            else m=(int)(ntot-nsent[i]<65536?ntot-nsent[i]:65536);
+            m=m<n-(int)(nsent[i]%n)?m:n-(int)(nsent[i]%n);
+            if ((k=(int)send(src[i],data+nsent[i]%n,m,MSG_DONTWAIT))>0) {
+                nsent[i]+=k;
+            }
+            if (rate>0.0&&sep[i]<nep&&nsent[i]>=epend[sep[i]]) {
+                tsend[i][sep[i]++]=now();
+            }
+            tnext=0.0;
+        }
+        /* receive converted stream of clients */
+        if ((k=epoll_wait(epfd,evs,256,(int)(tnext*1000.0)))<0) {
+            if (errno==EINTR) continue;
+            break;
+        }
+        for (j=0;j<k;j++) {
+            c=(cli_t *)evs[j].data.ptr;
+            while ((m=(int)recv(c->fd,buff,sizeof(buff),0))>0) {
+                c->nrecv+=m;
+                nrecv+=m;
+                tlast=now();
+                for (;rate>0.0&&c->ep<nep&&c->nrecv>=cum[c->ep];c->ep++) {
+                    addlat(now()-tsend[c->mnt][c->ep]);
+                }
+            }
+            if (c->nrecv>=(long long)nloop*nexp&&c->fd>=0) {
+                epoll_ctl(epfd,EPOLL_CTL_DEL,c->fd,NULL);
+                ndone++;
+            }
+        }
+    }
+    t1=now();
+    c1=cputime(pid);
+    numastat(&loc1,&oth1);
+    if (nthr>0) readnode(fdn,nthr,&nload,&nmiss);
+    nnode=numapages(pid,pages);
+
+    printf("clients=%d sources=%d workers=%d stream=%d bytes %d frames "
+           "%d epochs loops=%d rate=%.1f\n",nclient,nsrc,nwrk,n,nframe,nep,
+           nloop,rate);
+    printf("done=%d/%d time=%.3f s relay cpu=%.3f s\n",ndone,nclient,t1-t0,
+           c1-c0);
+    printf("input : %10.0f frames/s %8.2f MB/s\n",
+           (double)nframe*nloop*nsrc/(t1-t0),(double)ntot*nsrc/(t1-t0)*1E-6);
+    printf("output: %10.2f MB/s to clients (%lld bytes)\n",
+           nrecv/(t1-t0)*1E-6,nrecv);
+    printf("relay cpu: %.2f us/input frame\n",
+           (c1-c0)/((double)nframe*nloop*nsrc)*1E6);
+    if (nlat>0) {
+        qsort(lat,nlat,sizeof(double),cmplat);
+        printf("latency: n=%ld p50=%.3f p90=%.3f p99=%.3f max=%.3f ms\n",nlat,
+               lat[nlat/2]*1E3,lat[nlat*9/10]*1E3,lat[nlat*99/100]*1E3,
+               lat[nlat-1]*1E3);
+    }
+    printf("numa: relay pages");
+    for (i=0;i<nnode;i++) printf(" N%d=%lld",i,pages[i]);
+    printf("\nnuma: host page allocations local=%lld other=%lld\n",loc1-loc0,
+           oth1-oth0);
+    if (nthr>0) {
+        printf("numa: relay node loads=%lld misses=%lld (%.2f%%) threads=%d\n",
+               nload,nmiss,nload>0?100.0*nmiss/nload:0.0,nthr);
+    }
+    else printf("numa: relay node loads n/a (no hardware counters)\n");
+    kill(pid,SIGTERM);
+    waitpid(pid,NULL,0);
+    return ndone==nclient?0:1;
+}
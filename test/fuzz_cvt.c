@@ -0,0 +1,226 @@
+/*------------------------------------------------------------------------------
+* fuzz_cvt.c : fuzz target of rtcm 3 decoders
+*
+* notes  : libFuzzer entry LLVMFuzzerTestOneInput(). the first bytes of the
+*          input select the converter options, the rest is the rtcm 3 stream:
+*
+*          byte 0 : profile (bit 0-2), verify (bit 3), legacy out (bit 4),
+*                   legacy msm (bit 5), repeat suppression (bit 6), decimation
+*                   (bit 7)
+*          byte 1 : chunk size of rtcmcvtinputs() (+1)
+*          byte 2 : keyframe interval of delta coding (bit 0-5, 0:off), fix
+*                   parity of frames in stream (bit 7)
+*
+*          the stream is input to rtcmcvtinputs() split in chunks, and each
+*          frame start (preamble) to rtcmCvt() and rtcmcvtundelta() with the
+*          rest of the stream (up to MAXIN bytes) as length. converted
+*          outputs of delta coding are restored by rtcmcvtundelta(). the
+*          stream is read as archive by rtcmarcread() if it starts with the
+*          archive magic. the stream is written to an archive and read back,
+*          which must restore the stream, and read again after corrupting 4
+*          bytes of the archive
+*
+*          link with -fsanitize=fuzzer for libFuzzer, else with fuzz_main.c
+*          to replay and mutate inputs
+*-----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include "rtcmCnv.h"
+
+#define MAXIN       2048        /* max input length of a frame start */
+#define MAXOUT      4096        /* size of converter output buffer */
+
+static char *profs[][7]={       /* frequency selections */
+    {"L1","G1","E1","L1","L1","B1I","L5"},
+    {"L1+L2","G1+G2","E1+E5a","L2+L5","","B3I","L5"},
+    {"L1+L2+L5","G1+G2","E1+E5a+E5b+E6","L1+L2+L5","L1+L5","B1I+B2I+B3I",
+     "L5+S"},
+    {"","","","","","",""},
+    {"L5+L2+L1","G2","E5b+E1","L1","L5","B2a+B1C","S"},
+    {"L1+L1+L2","G1+G1","E1","L1","L1","B1I","L5"}
+};
+static const char *sigs[]={     /* signal selections by obs codes */
+    "G:1C,2W;E:1X,5X",
+    "G:1C,1W,2W,2L;R:1C,2P;C:2I,7I;J:1C,2L"
+};
+
+/* fix parity of frames in stream --------------------------------------------*/
+static void fixcrc(unsigned char *data, int n)
+{
+    unsigned int crc;
+    int p,len;
+
+    for (p=0;p+6<=n;p++) {
+        if (data[p]!=0xD3) continue;
+        len=(((data[p+1]&3)<<8)|data[p+2])+3;
+        if (p+len+3>n) break;
+        crc=rtcmcrc24q(data+p,len);
+        data[p+len  ]=(unsigned char)(crc>>16);
+        data[p+len+1]=(unsigned char)(crc>>8);
+        data[p+len+2]=(unsigned char)crc;
+        p+=len+2;
+    }
+}
+/* open converter with options -----------------------------------------------*/
+static rtcmcvt_t *opencvt(int opt, int nkey)
+{
+    rtcmcvt_t *cvt;
+    int iprof=opt&7;
+
+    if (!(cvt=rtcmcvtopen())) return NULL;
+    if (iprof<6) rtcmcvtsetprof(cvt,rtcmprofnew(profs[iprof]));
+    else rtcmcvtsetprof(cvt,rtcmprofsig(sigs[iprof-6]));
+    rtcmcvtverify(cvt,(opt>>3)&1);
+    if (opt&0x10) rtcmcvtlegacy(cvt,RTCMLEG_OUT);
+    else if (opt&0x20) rtcmcvtlegacy(cvt,RTCMLEG_MSM);
+    if (opt&0x40) rtcmcvtrepeat(cvt,5000);
+    if (opt&0x80) rtcmcvtdecim(cvt,2000,0);
+    if (nkey) rtcmcvtdelta(cvt,nkey);
+    return cvt;
+}
+/* input stream by rtcmcvtinputs() -------------------------------------------*/
+static void fuzz_inputs(const unsigned char *data, int n, int opt, int chunk,
+                        int nkey)
+{
+    rtcmcvt_t *cvt=opencvt(opt,nkey),*dec=rtcmcvtopen();
+    rtcmobs_t obs[64];
+    unsigned char out[MAXOUT],res[MAXOUT];
+    int p,q,m,nused,lsd,lres;
+
+    for (p=0;cvt&&dec&&p<n;p+=m) {
+        m=chunk<n-p?chunk:n-p;
+        for (q=0;q<m;q+=nused) {
+            if (rtcmcvtinputs(cvt,data+p+q,m-q,&nused,NULL,out,&lsd)==-2) break;
+            if (nused<=0) break;
+            if (lsd<=0) continue;
+            rtcmcvtobs(cvt,obs,64);
+            if (nkey) rtcmcvtundelta(dec,out,lsd,res,&lres);
+        }
+    }
+    if (cvt) rtcmcvtclose(cvt);
+    if (dec) rtcmcvtclose(dec);
+}
+/* input frames by rtcmCvt() and rtcmcvtundelta() ----------------------------*/
+static void fuzz_frames(const unsigned char *data, int n, int opt)
+{
+    rtcmcvt_t *dec=rtcmcvtopen();
+    unsigned char buff[MAXIN],out[MAXOUT];
+    int p,len,lsd;
+
+    if (!dec) return;
+
+    for (p=0;p<n;p++) {
+        if (data[p]!=0xD3) continue;
+        len=n-p<MAXIN?n-p:MAXIN;
+        memcpy(buff,data+p,len); /* rtcmCvt() input is not const */
+        rtcmCvt(p&1,buff,len,profs[(opt&7)%6],out,&lsd);
+        rtcmcvtundelta(dec,data+p,len,out,&lsd);
+    }
+    rtcmcvtclose(dec);
+}
+/* write temporary file (return: file path or NULL) --------------------------*/
+static char *tmpwrite(char *path, const unsigned char *data, int n)
+{
+    int fd;
+
+    strcpy(path,"/tmp/fuzz_cvt_XXXXXX");
+    if ((fd=mkstemp(path))<0) return NULL;
+    if (n>0&&write(fd,data,n)!=n) {
+        close(fd);
+        unlink(path);
+        return NULL;
+    }
+    close(fd);
+    return path;
+}
+/* read archive by rtcmarcread() (return: stream length,-1:error) ------------*/
+static int arcread(const char *file, unsigned char *out, int nmax)
+{
+    rtcmarcr_t *r;
+    unsigned char buff[MAXOUT];
+    int len,n=0;
+
+    if (!(r=rtcmarcropen(file))) return -1;
+    while ((len=rtcmarcread(r,buff))>0) {
+        if (out) {
+            if (n+len>nmax) break;
+            memcpy(out+n,buff,len);
+        }
+        n+=len;
+    }
+    rtcmarcrclose(r);
+    return len<0?-1:n;
+}
+/* corrupt archive file at positions by hash of stream -----------------------*/
+static void corrupt(const char *file, unsigned int hash)
+{
+    FILE *fp;
+    long size,off;
+    int i;
+
+    if (!(fp=fopen(file,"r+b"))) return;
+    fseek(fp,0,SEEK_END);
+    if ((size=ftell(fp))>16) {
+        for (i=0;i<4;i++) {
+            off=(long)((hash+i*7919U)%(unsigned int)(size-16));
+            fseek(fp,16+off,SEEK_SET);
+            fputc((int)(hash>>(i*8))&0xFF,fp);
+        }
+    }
+    fclose(fp);
+}
+/* read stream as archive and write archive of stream ------------------------*/
+static void fuzz_arc(const unsigned char *data, int n)
+{
+    rtcmarcw_t *w;
+    unsigned char *out;
+    char path[32];
+    int nout,ok=0;
+
+    if (n>=8&&!memcmp(data,"RTCMARC1",8)&&tmpwrite(path,data,n)) {
+        arcread(path,NULL,0);
+        unlink(path);
+    }
+    if (!tmpwrite(path,data,0)) return;
+
+    if ((w=rtcmarcopen(path))) {
+        rtcmarcinput(w,data,n);
+        if (rtcmarcclose(w)&&(out=(unsigned char *)malloc(n+MAXOUT))) {
+            nout=arcread(path,out,n+MAXOUT);
+            if (nout!=n||memcmp(out,data,n)) {
+                fprintf(stderr,"archive not restored: n=%d nout=%d\n",n,nout);
+                abort();
+            }
+            free(out);
+            ok=1;
+        }
+    }
+    if (ok) { /* corrupted archive */
+        corrupt(path,rtcmcrc24q(data,n));
+        arcread(path,NULL,0);
+    }
+    unlink(path);
+}
+/* fuzz target ---------------------------------------------------------------*/
+int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size)
+{
+    unsigned char *buff;
+    int n=(int)size-3,opt,chunk,nkey;
+
+    if (size<3||size>1000000) return 0;
+    opt=data[0];
+    chunk=data[1]+1;
+    nkey=data[2]&0x3F;
+
+    if (!(buff=(unsigned char *)malloc(n>0?n:1))) return 0;
+    memcpy(buff,data+3,n);
+    if (data[2]&0x80) fixcrc(buff,n);
+
+    fuzz_inputs(buff,n,opt,chunk,nkey);
+    fuzz_frames(buff,n,opt);
+    fuzz_arc(buff,n);
+    free(buff);
+    return 0;
+}
@@ -0,0 +1,122 @@
+/*------------------------------------------------------------------------------
+* fuzz_main.c : replay driver of fuzz target without libFuzzer
+*
+* notes  : input each file to LLVMFuzzerTestOneInput() as libFuzzer would. with
+*          -s, the files are rtcm 3 streams (seeds): each is input with option
+*          bytes for every profile and option bit, then mutated nmut times by
+*          random byte changes, insertions and cuts
+*
+*          usage : fuzz_main [-s] [-n nmut] [-r seed] file ...
+*-----------------------------------------------------------------------------*/
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+extern int LLVMFuzzerTestOneInput(const unsigned char *data, size_t size);
+
+/* read file -----------------------------------------------------------------*/
+static unsigned char *readfile(const char *file, int *n)
+{
+    FILE *fp;
+    unsigned char *data;
+    long size;
+
+    *n=0;
+    if (!(fp=fopen(file,"rb"))) return NULL;
+    fseek(fp,0,SEEK_END);
+    size=ftell(fp);
+    fseek(fp,0,SEEK_SET);
+    if (!(data=(unsigned char *)malloc(size+3))||
+        fread(data+3,1,size,fp)!=(size_t)size) {
+        free(data);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+    *n=(int)size+3;
+    return data;
+}
+/* random number (xorshift) --------------------------------------------------*/
+static unsigned int rnd(void)
+{
+    static unsigned int x=2463534242U;
+
+    x^=x<<13; x^=x>>17; x^=x<<5;
+    return x;
+}
+/* mutate input (return: length) ---------------------------------------------*/
+static int mutate(unsigned char *data, int n, int nmax)
+{
+    int i,p,m;
+
+    for (i=1+rnd()%8;i>0&&n>3;i--) {
+        p=3+rnd()%(n-3);
+        switch (rnd()%4) {
+            case 0: /* bit flip */
+                data[p]^=(unsigned char)(1<<(rnd()%8));
+                break;
+            case 1: /* random byte */
+                data[p]=(unsigned char)rnd();
+                break;
+            case 2: /* insert bytes */
+                m=1+rnd()%16;
+                if (n+m>nmax) break;
+                memmove(data+p+m,data+p,n-p);
+                n+=m;
+                for (;m>0;m--) data[p+m-1]=(unsigned char)rnd();
+                break;
+            case 3: /* cut bytes */
+                m=1+rnd()%64;
+                if (p+m>n) m=n-p;
+                memmove(data+p,data+p+m,n-p-m);
+                n-=m;
+                break;
+        }
+    }
+    return n;
+}
+/* main ----------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    unsigned char *data,*buff;
+    int i,j,n,m,seed=0,nmut=0;
+
+    for (i=1;i<argc&&argv[i][0]=='-';i++) {
+        if (!strcmp(argv[i],"-s")) seed=1;
+        else if (!strcmp(argv[i],"-n")&&i+1<argc) nmut=atoi(argv[++i]);
+        else if (!strcmp(argv[i],"-r")&&i+1<argc) {
+            for (j=atoi(argv[++i]);j>0;j--) rnd();
+        }
+    }
+    for (;i<argc;i++) {
+        if (!(data=readfile(argv[i],&n))) {
+            fprintf(stderr,"file read error: %s\n",argv[i]);
+            return 1;
+        }
+        if (!seed) {
+            LLVMFuzzerTestOneInput(data+3,n-3);
+            free(data);
+            continue;
+        }
+        for (j=0;j<16;j++) { /* profiles x option bits */
+            data[0]=(unsigned char)((j&7)|(j<8?0:8<<(j%5)));
+            data[1]=(unsigned char)(j*37);
+            data[2]=(unsigned char)((j%3==0?5+j:0)|(j&1?0x80:0));
+            LLVMFuzzerTestOneInput(data,n);
+        }
+        if (!(buff=(unsigned char *)malloc(n+1024))) return 1;
+
+        for (j=0;j<nmut;j++) {
+            memcpy(buff,data,n);
+            buff[0]=(unsigned char)rnd();
+            buff[1]=(unsigned char)rnd();
+            buff[2]=(unsigned char)(rnd()|0x80); /* parity fixed */
+            m=mutate(buff,n,n+1024);
+            LLVMFuzzerTestOneInput(buff,m);
+        }
+        fprintf(stderr,"%s: %d inputs OK\n",argv[i],16+nmut);
+        free(buff);
+        free(data);
+    }
+    return 0;
+}
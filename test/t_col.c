@@ -0,0 +1,199 @@
+/*------------------------------------------------------------------------------
+* t_col.c : columnar export test by reading the file back
+*
+* notes  : data/msm.rtcm3 is converted with rtcmcvtinput() and exported with
+*          rtcmcolwrite() in small chunks. the file is read back from the
+*          footer: magic and offset of footer, dictionaries, chunk directory
+*          with epoch min/max of every chunk and the columns. the rows must
+*          be the observation data of rtcmcvtobs() of every message, and the
+*          epochs of gps messages the week and time of week of the frame.
+*          a gps msm7 frame with lock time indicator 600 is appended to the
+*          stream. the file is written in the current directory
+*-----------------------------------------------------------------------------*/
+#include "tutil.h"
+
+#define COLFILE     "t_col.col"
+#define WEEK        2300        /* gps week of first epoch */
+#define NROW        1000        /* rows per chunk */
+#define MAXROW      65536       /* max number of rows */
+#define NCOL        9           /* number of columns */
+#define LOCK        600         /* lock time indicator of appended msm7 */
+
+typedef struct {            /* expected row type */
+    long long epoch;        /* epoch (gps time,ms) (-1:not checked) */
+    rtcmobs_t obs;          /* observation data */
+} row_t;
+
+typedef struct {            /* chunk directory type of file */
+    unsigned int nrow,reserved;
+    long long tmin,tmax;
+    unsigned long long off[NCOL];
+} chk_t;
+
+static row_t rows[MAXROW];
+
+/* epoch of msm frame (gps time of week,ms) ---------------------------------*/
+static unsigned int frametow(const unsigned char *frm)
+{
+    return ((unsigned int)frm[6]<<22)|(frm[7]<<14)|(frm[8]<<6)|(frm[9]>>2);
+}
+/* set bits ------------------------------------------------------------------*/
+static void setbits(unsigned char *buff, int pos, int len, unsigned int data)
+{
+    int i;
+
+    for (i=len-1;i>=0;i--,pos++) {
+        if ((data>>i)&1) buff[pos/8]|=(unsigned char)(0x80>>(pos%8));
+        else buff[pos/8]&=(unsigned char)~(0x80>>(pos%8));
+    }
+}
+/* generate gps msm7 frame of one satellite and signal -----------------------*/
+static int genmsm7(unsigned int tow, unsigned char *buff)
+{
+    unsigned int crc;
+    int p=24,len;
+
+    memset(buff,0,64);
+    setbits(buff,p,12,1077); p+=12;
+    setbits(buff,p,12,1);    p+=12; /* station id */
+    setbits(buff,p,30,tow);  p+=30;
+    p+=1+3+7+2+2+1+3; /* sync..smoothing interval */
+    setbits(buff,p,1,1); p+=64; /* satellite id 1 */
+    setbits(buff,p+1,1,1); p+=32; /* signal id 2 (1C) */
+    setbits(buff,p,1,1); p+=1;  /* cell */
+    setbits(buff,p, 8,70);   p+=8+4;
+    setbits(buff,p,10,100);  p+=10;
+    setbits(buff,p,14,500);  p+=14;
+    setbits(buff,p,20,1000); p+=20;
+    setbits(buff,p,24,2000); p+=24;
+    setbits(buff,p,10,LOCK); p+=10+1;
+    setbits(buff,p,10,640);  p+=10;
+    setbits(buff,p,15,100);  p+=15;
+
+    len=(p+7)/8;
+    setbits(buff,0,8,0xD3);
+    setbits(buff,14,10,len-3);
+    crc=rtcmcrc24q(buff,len);
+    setbits(buff,len*8,24,crc);
+    return len+3;
+}
+/* convert stream and write columnar export (return: number of rows) ---------*/
+static int writecol(const unsigned char *data, int n)
+{
+    char *freq_c[7]=TPROF_L1L2;
+    rtcmcvt_t *cvt;
+    rtcmcol_t *col;
+    rtcmobs_t obs[256];
+    unsigned char out[1200];
+    int i,p=0,len,lsd,m,nrow=0,type;
+
+    if (!(cvt=rtcmcvtopen())) return -1;
+    rtcmcvtsetprof(cvt,rtcmprofnew(freq_c));
+    if (!(col=rtcmcolopen(COLFILE,NROW,WEEK))) {
+        rtcmcvtclose(cvt);
+        return -1;
+    }
+    for (;(len=nextframe(data,n,&p))>0;p+=len) {
+        if (rtcmcvtinput(cvt,framesync(data+p),(unsigned char *)data+p,len,
+                         NULL,out,&lsd)<=0) continue;
+        m=rtcmcvtobs(cvt,obs,256);
+        type=frametype(data+p);
+        if (rtcmcolwrite(col,cvt)!=m||nrow+m>MAXROW) {
+            nrow=-1;
+            break;
+        }
+        for (i=0;i<m;i++,nrow++) {
+            rows[nrow].obs=obs[i];
+            rows[nrow].epoch=type>=1071&&type<=1077?
+                (long long)WEEK*604800000+frametow(data+p):-1;
+        }
+    }
+    if (!rtcmcolclose(col)) nrow=-1;
+    rtcmcvtclose(cvt);
+    return nrow;
+}
+/* read back and compare columnar export -------------------------------------*/
+static void readcol(int nrow)
+{
+    unsigned char *data;
+    const unsigned char *ftr,*p;
+    unsigned int hdr[4];
+    unsigned long long off;
+    long long t,tmin,tmax;
+    unsigned short sat,lock;
+    double P,L;
+    chk_t chk;
+    const row_t *r;
+    int i,j,n,nsat,nsig,nchk,k=0,ok=1,okt=1,nlock=0,ngps=0;
+
+    if (!(data=readfile(NULL,COLFILE,&n))) {
+        nfail++;
+        return;
+    }
+    memcpy(&off,data+n-16,8);
+    check(n>32&&!memcmp(data,"RTCMCOL1",8)&&!memcmp(data+n-8,"RTCMCOL1",8)&&
+          off<(unsigned long long)n-16,"file magic and footer offset");
+
+    ftr=data+off;
+    memcpy(hdr,ftr,16);
+    nchk=(int)hdr[1]; nsat=(int)hdr[2]; nsig=(int)hdr[3];
+    check(hdr[0]==NCOL&&nchk==(nrow+NROW-1)/NROW&&nsat>0&&nsig>0,
+          "footer number of columns and chunks");
+
+    for (i=0;i<nchk&&ok;i++) {
+        memcpy(&chk,ftr+16+(nsat*4+7)/8*8+(nsig*4+7)/8*8+i*sizeof(chk_t),
+               sizeof(chk_t));
+        if (chk.nrow!=(unsigned int)(i<nchk-1?NROW:nrow-(nchk-1)*NROW)) ok=0;
+        tmin=0x7FFFFFFFFFFFFFFFLL; tmax=-1;
+
+        for (j=0;j<(int)chk.nrow&&ok;j++,k++) {
+            r=rows+k;
+            memcpy(&t   ,data+chk.off[0]+j*8,8);
+            memcpy(&sat ,data+chk.off[1]+j*2,2);
+            memcpy(&P   ,data+chk.off[3]+j*8,8);
+            memcpy(&L   ,data+chk.off[4]+j*8,8);
+            memcpy(&lock,data+chk.off[8]+j*2,2);
+            p=data+chk.off[2]+j;
+            if (sat>=nsat||*p>=nsig||
+                strncmp((const char *)ftr+16+sat*4,r->obs.sat,4)||
+                strncmp((const char *)ftr+16+(nsat*4+7)/8*8+*p*4,r->obs.code,4)||
+                P!=r->obs.P||L!=r->obs.L||lock!=r->obs.lock||
+                data[chk.off[7]+j]!=r->obs.LLI) ok=0;
+            if (r->epoch>=0) {
+                if (t!=r->epoch) okt=0;
+                ngps++;
+            }
+            if (t<tmin) tmin=t;
+            if (t>tmax) tmax=t;
+            if (lock==LOCK) nlock++;
+        }
+        if (chk.tmin!=tmin||chk.tmax!=tmax) okt=0;
+        for (j=0;j<NCOL;j++) if (chk.off[j]%8) ok=0;
+    }
+    check(ok&&k==nrow,"dictionaries and columns of rows");
+    check(okt&&ngps>0,"epochs and tmin/tmax of chunks");
+    check(nlock==1,"lock time indicator over 255");
+    free(data);
+}
+/* main ----------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    const char *dir=argc>1?argv[1]:"data";
+    unsigned char *data,*buff;
+    unsigned int tow=0;
+    int n,p=0,len,nrow;
+
+    if (!(data=readfile(dir,"msm.rtcm3",&n))) return 1;
+    if (!(buff=(unsigned char *)malloc(n+64))) return 1;
+    memcpy(buff,data,n);
+    for (;(len=nextframe(data,n,&p))>0;p+=len) {
+        if (frametype(data+p)==1077) tow=frametow(data+p);
+    }
+    n+=genmsm7(tow+1000,buff+n);
+    nrow=writecol(buff,n);
+    check(nrow>NROW,"rtcmcolwrite");
+    if (nrow>NROW) readcol(nrow);
+    free(buff);
+    free(data);
+    return nfail?1:0;
+}
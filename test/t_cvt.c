@@ -0,0 +1,229 @@
+/*------------------------------------------------------------------------------
+* t_cvt.c : stream conversion test against expected output
+*
+* notes  : data/msm.rtcm3 is a 60 s synthetic stream of gps/glonass/galileo
+*          msm7, galileo msm5, qzss/irnss msm4 and bds msm6 with smooth ranges
+*          and noise, station (1005,1033), ephemeris (1019,1020,1042) and ssr
+*          code bias (1059) messages and junk bytes between frames.
+*          data/msm_*.rtcm3 are the expected outputs. run "t_cvt <dir> -w" to
+*          write them again after a reviewed change of the output. the clean
+*          stream must count no decode errors, and the frames of types not
+*          converted (station, ephemeris other than 1020) as not converted.
+*          the statistics are checked in the prometheus text. gps and
+*          glonass msm7 converted to 1004/1012 and back to msm4 must keep the
+*          observations of rtcmcvtobs() within the legacy resolution
+*-----------------------------------------------------------------------------*/
+#include <math.h>
+#include "tutil.h"
+
+typedef struct {            /* test case type */
+    const char *file;       /* expected output file */
+    char *freq_c[7];        /* frequency selection */
+    int tint;               /* decimation interval (ms) */
+} case_t;
+
+static const case_t cases[]={
+    {"msm_l1.rtcm3"  ,TPROF_L1  ,0   },
+    {"msm_l1l2.rtcm3",TPROF_L1L2,2000}
+};
+
+/* open converter of test case -----------------------------------------------*/
+static rtcmcvt_t *opencvt(const case_t *c, int verify)
+{
+    rtcmcvt_t *cvt=rtcmcvtopen();
+    char **freq_c=(char **)c->freq_c;
+
+    if (!cvt) return NULL;
+    rtcmcvtsetprof(cvt,rtcmprofnew(freq_c));
+    rtcmcvtdecim(cvt,c->tint,0);
+    rtcmcvtverify(cvt,verify);
+    return cvt;
+}
+/* convert stream frame by frame (rtcmcvtinput()) ----------------------------*/
+static int cvtframe(const case_t *c, const unsigned char *data, int n,
+                    unsigned char *out, rtcmstat_t *stat)
+{
+    rtcmcvt_t *cvt=opencvt(c,1);
+    unsigned char buff[1200];
+    int p=0,len,nout=0,lsd;
+
+    for (;(len=nextframe(data,n,&p))>0;p+=len) {
+        if (rtcmcvtinput(cvt,framesync(data+p),(unsigned char *)data+p,len,NULL,
+                         buff,&lsd)>0) {
+            memcpy(out+nout,buff,lsd);
+            nout+=lsd;
+        }
+    }
+    rtcmcvtstat(cvt,stat);
+    rtcmcvtclose(cvt);
+    return nout;
+}
+/* convert stream split to chunks (rtcmcvtinputs()) --------------------------*/
+static int cvtstream(const case_t *c, const unsigned char *data, int n,
+                     int chunk, unsigned char *out, rtcmstat_t *stat)
+{
+    rtcmcvt_t *cvt=opencvt(c,0);
+    unsigned char buff[1200];
+    int p,q,m,nused,nout=0,lsd;
+
+    for (p=0;p<n;p+=m) {
+        m=chunk<n-p?chunk:n-p;
+        for (q=0;q<m;q+=nused) {
+            if (rtcmcvtinputs(cvt,data+p+q,m-q,&nused,NULL,buff,&lsd)>0) {
+                memcpy(out+nout,buff,lsd);
+                nout+=lsd;
+            }
+        }
+    }
+    rtcmcvtstat(cvt,stat);
+    rtcmcvtclose(cvt);
+    return nout;
+}
+/* number of frames of types not converted -----------------------------------*/
+static unsigned long long nunsup(const unsigned char *data, int n)
+{
+    unsigned long long m=0;
+    int p=0,len,type;
+
+    for (;(len=nextframe(data,n,&p))>0;p+=len) {
+        type=frametype(data+p);
+        if (!is_msm(type)&&!is_ssr(type)&&type!=1020) m++;
+    }
+    return m;
+}
+/* statistics in prometheus text ---------------------------------------------*/
+static void promtest(const rtcmstat_t *stat, unsigned long long nuns)
+{
+    char buff[65536],line[128];
+    int n;
+
+    n=rtcmstat2prom(stat,"station=\"T\"",buff,sizeof(buff));
+    check(n>0&&n==(int)strlen(buff),"rtcmstat2prom length");
+
+    check(strstr(buff,"# TYPE rtcmcvt_decode_errors_total counter\n"
+                 "rtcmcvt_decode_errors_total{station=\"T\"} 0\n")!=NULL,
+          "rtcmstat2prom decode errors");
+    sprintf(line,"rtcmcvt_frames_unsupported_total{station=\"T\"} %llu\n",nuns);
+    check(strstr(buff,line)!=NULL,"rtcmstat2prom unsupported frames");
+    sprintf(line,"rtcmcvt_frames_in_total{station=\"T\",type=\"1077\"} %llu\n",
+            stat->nin[77]);
+    check(stat->nin[77]>0&&strstr(buff,line)!=NULL,"rtcmstat2prom frames in");
+    sprintf(line,"rtcmcvt_latency_seconds_count{station=\"T\",stage=\"total\"} ");
+    check(strstr(buff,line)!=NULL&&
+          strstr(buff,"le=\"+Inf\"}")!=NULL,"rtcmstat2prom latency");
+
+    check(rtcmstat2prom(stat,"station=\"T\"",buff,n)==-1&&
+          rtcmstat2prom(stat,"station=\"T\"",buff,n+1)==n,
+          "rtcmstat2prom overflow");
+    check(rtcmstat2prom(stat,NULL,buff,sizeof(buff))>0&&
+          strstr(buff,"rtcmcvt_decode_errors_total{} 0\n")!=NULL,
+          "rtcmstat2prom no label");
+}
+/* legacy round trip msm7 -> 1004/1012 -> msm4 ------------------------------
+* pseudoranges within 0.02 m and carrier-phases modulo the 1500 cycle phase-
+* range rollover of legacy messages within 0.01 cycle
+*-----------------------------------------------------------------------------*/
+static void legtest(const unsigned char *data, int n)
+{
+    char *freq_c[7]=TPROF_L1L2;
+    rtcmcvt_t *leg,*msm;
+    rtcmobs_t obs1[256],obs2[256];
+    unsigned char buff[1200],out[1200];
+    double dL;
+    int i,j,p=0,len,lsd,lout,n1,n2,type,nobs=0,nmsg=0,ok=1;
+
+    if (!(leg=rtcmcvtopen())) return;
+    if (!(msm=rtcmcvtopen())) {
+        rtcmcvtclose(leg);
+        return;
+    }
+    rtcmcvtsetprof(leg,rtcmprofnew(freq_c));
+    rtcmcvtsetprof(msm,rtcmprofnew(freq_c));
+    rtcmcvtlegacy(leg,RTCMLEG_OUT);
+    rtcmcvtlegacy(msm,RTCMLEG_MSM);
+
+    for (;(len=nextframe(data,n,&p))>0;p+=len) {
+        type=frametype(data+p);
+        if (type!=1077&&type!=1087&&type!=1020) continue;
+        if (type==1020) { /* glonass fcn to encode 1012 */
+            rtcmcvtinput(leg,0,(unsigned char *)data+p,len,NULL,buff,&lsd);
+            continue;
+        }
+        if (rtcmcvtinput(leg,framesync(data+p),(unsigned char *)data+p,len,
+                         NULL,buff,&lsd)<=0) continue;
+        n1=rtcmcvtobs(leg,obs1,256);
+        if (frametype(buff)!=(type==1077?1004:1012)||
+            rtcmcvtinput(msm,framesync(data+p),buff,lsd,NULL,out,&lout)<=0||
+            frametype(out)!=(type==1077?1074:1084)) {
+            ok=0;
+            continue;
+        }
+        n2=rtcmcvtobs(msm,obs2,256);
+        nmsg++;
+
+        for (i=0;i<n2;i++,nobs++) {
+            for (j=0;j<n1;j++) {
+                if (!strcmp(obs1[j].sat,obs2[i].sat)&&
+                    !strcmp(obs1[j].code,obs2[i].code)) break;
+            }
+            if (j>=n1) {
+                ok=0;
+                continue;
+            }
+            dL=obs2[i].L-obs1[j].L;
+            dL-=1500.0*floor(dL/1500.0+0.5);
+            if (fabs(obs2[i].P-obs1[j].P)>0.02||fabs(dL)>0.01) ok=0;
+        }
+    }
+    check(ok&&nmsg>0&&nobs>0,"legacy round trip msm7-1004/1012-msm4");
+    rtcmcvtclose(leg);
+    rtcmcvtclose(msm);
+}
+/* main ----------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    static const int chunks[]={1,7,1000,65536};
+    const char *dir=argc>1?argv[1]:"data";
+    static rtcmstat_t stat;
+    unsigned char *data,*ref,*out;
+    unsigned long long nuns;
+    char name[128];
+    int i,j,n,nref,nout,write=argc>2&&!strcmp(argv[2],"-w");
+
+    if (!(data=readfile(dir,"msm.rtcm3",&n))) return 1;
+    out=(unsigned char *)malloc(n+65536);
+    nuns=nunsup(data,n);
+
+    legtest(data,n);
+
+    for (i=0;i<(int)(sizeof(cases)/sizeof(*cases));i++) {
+        nout=cvtframe(cases+i,data,n,out,&stat);
+
+        if (write) {
+            check(writefile(dir,cases[i].file,out,nout),cases[i].file);
+            continue;
+        }
+        if (!(ref=readfile(dir,cases[i].file,&nref))) {
+            nfail++;
+            continue;
+        }
+        sprintf(name,"%s rtcmcvtinput",cases[i].file);
+        check(nout==nref&&!memcmp(out,ref,nref),name);
+        sprintf(name,"%s verify",cases[i].file);
+        check(stat.nverr==0,name);
+        sprintf(name,"%s decode errors",cases[i].file);
+        check(stat.nerr==0&&stat.nunsup==nuns&&nuns>0,name);
+        if (i==0) promtest(&stat,nuns);
+
+        for (j=0;j<(int)(sizeof(chunks)/sizeof(*chunks));j++) {
+            nout=cvtstream(cases+i,data,n,chunks[j],out,&stat);
+            sprintf(name,"%s rtcmcvtinputs chunk=%d",cases[i].file,chunks[j]);
+            check(nout==nref&&!memcmp(out,ref,nref)&&stat.nerr==0&&
+                  stat.nunsup==nuns,name);
+        }
+        free(ref);
+    }
+    free(out);
+    free(data);
+    return nfail?1:0;
+}
@@ -0,0 +1,111 @@
+/*------------------------------------------------------------------------------
+* t_dlt.c : msm4 delta coding test
+*
+* notes  : convert data/msm.rtcm3 with and without delta coding, restore the
+*          delta coded stream and compare with the stream without delta coding.
+*          the iods of msm messages is cleared as the synthetic stream changes
+*          it every epoch. then drop the second keyframe of a system: the delta
+*          messages coded against it must be rejected until the next keyframe.
+*          keyframe intervals above 16 check the sequence number over the old
+*          4-bit modulo
+*-----------------------------------------------------------------------------*/
+#include "tutil.h"
+
+#define DLTTYPE     4088        /* msm4 delta message type */
+
+/* system index of msm4 or delta message (-1: other) -------------------------*/
+static int dltsys(const unsigned char *frm)
+{
+    int type=frametype(frm);
+
+    if (type==DLTTYPE) return (frm[4]>>1)&7; /* bits 36-38 */
+    if (is_msm(type)&&type%10==4) {
+        switch (type/10) {
+            case 107: return 0; case 108: return 1; case 109: return 2;
+            case 111: return 3; case 110: return 4; case 112: return 5;
+            case 113: return 6;
+        }
+    }
+    return -1;
+}
+/* clear iods of msm messages (bits 79-81) ----------------------------------*/
+static void cleariods(unsigned char *data, int n)
+{
+    unsigned int crc;
+    int p=0,len;
+
+    for (;(len=nextframe(data,n,&p))>0;p+=len) {
+        if (!is_msm(frametype(data+p))) continue;
+        data[p+9]&=0xFE;
+        data[p+10]&=0x3F;
+        crc=rtcmcrc24q(data+p,len-3);
+        data[p+len-3]=(unsigned char)(crc>>16);
+        data[p+len-2]=(unsigned char)(crc>>8);
+        data[p+len-1]=(unsigned char)crc;
+    }
+}
+/* delta coding test (return: number of rejected delta messages) ------------*/
+static int dlttest(const unsigned char *data, int n, int nkey, int dropsys,
+                   int *ndlt, int *nbad)
+{
+    char *freq_c[7]=TPROF_L1;
+    rtcmcvt_t *ref=rtcmcvtopen(),*enc=rtcmcvtopen(),*dec=rtcmcvtopen();
+    unsigned char bref[1200],benc[1200],bdec[1200];
+    int p=0,len,lref,lenc,ldec,ret,nkf=0,drop=0,nrej=0;
+
+    rtcmcvtsetprof(ref,rtcmprofnew(freq_c));
+    rtcmcvtsetprof(enc,rtcmprofnew(freq_c));
+    rtcmcvtdelta(enc,nkey);
+    *ndlt=*nbad=0;
+
+    for (;(len=nextframe(data,n,&p))>0;p+=len) {
+        if (rtcmcvtinput(ref,framesync(data+p),(unsigned char *)data+p,len,NULL,
+                         bref,&lref)<=0||
+            rtcmcvtinput(enc,framesync(data+p),(unsigned char *)data+p,len,NULL,
+                         benc,&lenc)<=0) continue;
+
+        if (frametype(benc)==DLTTYPE) (*ndlt)++;
+
+        /* drop second keyframe of system */
+        if (dltsys(benc)==dropsys&&frametype(benc)!=DLTTYPE) {
+            drop=++nkf==2;
+            if (drop) continue;
+        }
+        ret=rtcmcvtundelta(dec,benc,lenc,bdec,&ldec);
+
+        if (ret==0) {
+            nrej++;
+            if (!drop||dltsys(benc)!=dropsys) (*nbad)++;
+        }
+        else if (ret!=1||ldec!=lref||memcmp(bdec,bref,lref)) (*nbad)++;
+    }
+    rtcmcvtclose(ref);
+    rtcmcvtclose(enc);
+    rtcmcvtclose(dec);
+    return nrej;
+}
+/* main ----------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    static const int nkeys[]={5,17,40};
+    const char *dir=argc>1?argv[1]:"data";
+    unsigned char *data;
+    char name[128];
+    int i,n,nrej,ndlt,nbad;
+
+    if (!(data=readfile(dir,"msm.rtcm3",&n))) return 1;
+    cleariods(data,n);
+
+    for (i=0;i<(int)(sizeof(nkeys)/sizeof(*nkeys));i++) {
+        nrej=dlttest(data,n,nkeys[i],-1,&ndlt,&nbad);
+        sprintf(name,"nkey=%d restore",nkeys[i]);
+        check(ndlt>0&&nrej==0&&nbad==0,name);
+
+        /* qzss msm4: deltas up to next keyframe rejected */
+        nrej=dlttest(data,n,nkeys[i],3,&ndlt,&nbad);
+        sprintf(name,"nkey=%d keyframe lost",nkeys[i]);
+        check(nrej>0&&nbad==0,name);
+    }
+    free(data);
+    return nfail?1:0;
+}
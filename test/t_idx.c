@@ -0,0 +1,172 @@
+/*------------------------------------------------------------------------------
+* t_idx.c : archive frame index test over gps week rollover
+*
+* notes  : a synthetic archive of gps msm4, glonass msm4 with unknown day of
+*          week (7) and station (1005) frames of each epoch from 5 s before
+*          to 5 s after the end of gps week is indexed by rtcmidxbuild() and
+*          by rtcmidxinput() appended in two parts. windows over the end of
+*          week are searched by rtcmidxsearch(), rtcmidxrange() and
+*          rtcmextract(), with and without conversion. files are written in
+*          the current directory
+*-----------------------------------------------------------------------------*/
+#include "tutil.h"
+
+#define WEEKMS      604800000U  /* ms of week */
+#define NEPOCH      10          /* number of epochs */
+#define TOW0        (WEEKMS-5000) /* tow of first epoch (ms) */
+#define ARCFILE     "t_idx.rtcm3"
+#define IDXFILE     "t_idx.rtcm3.idx"
+
+/* set bits ------------------------------------------------------------------*/
+static void setbits(unsigned char *buff, int pos, int len, unsigned int data)
+{
+    int i;
+
+    for (i=len-1;i>=0;i--,pos++) {
+        if ((data>>i)&1) buff[pos/8]|=(unsigned char)(0x80>>(pos%8));
+        else buff[pos/8]&=(unsigned char)~(0x80>>(pos%8));
+    }
+}
+/* set frame header and parity (return: frame length) ------------------------*/
+static int setframe(unsigned char *buff, int nbit)
+{
+    unsigned int crc;
+    int len=(nbit+7)/8;
+
+    setbits(buff,0,8,0xD3);
+    setbits(buff,8,6,0);
+    setbits(buff,14,10,len-3);
+    crc=rtcmcrc24q(buff,len);
+    setbits(buff,len*8,24,crc);
+    return len+3;
+}
+/* generate msm4 frame of one satellite and signal ---------------------------*/
+static int genmsm4(int type, unsigned int epoch, unsigned char *buff)
+{
+    int p=24;
+
+    memset(buff,0,64);
+    setbits(buff,p,12,type); p+=12;
+    setbits(buff,p,12,1);    p+=12; /* station id */
+    setbits(buff,p,30,epoch); p+=30;
+    p+=1+3+7+2+2+1+3; /* sync..smoothing interval */
+    setbits(buff,p,1,1); p+=64; /* satellite id 1 */
+    setbits(buff,p+1,1,1); p+=32; /* signal id 2 */
+    setbits(buff,p,1,1); p+=1;  /* cell */
+    setbits(buff,p, 8,70); p+=8;
+    setbits(buff,p,10,100); p+=10;
+    setbits(buff,p,15,1000); p+=15;
+    setbits(buff,p,22,2000); p+=22;
+    setbits(buff,p, 4,10); p+=4;
+    p+=1; /* half-cycle ambiguity */
+    setbits(buff,p, 6,40); p+=6;
+    return setframe(buff,p);
+}
+/* generate station frame (1005) ---------------------------------------------*/
+static int gen1005(unsigned char *buff)
+{
+    memset(buff,0,64);
+    setbits(buff,24,12,1005);
+    setbits(buff,36,12,1);
+    return setframe(buff,24+152);
+}
+/* generate archive (return: archive length) ---------------------------------*/
+static int genarc(unsigned char *arc, int *half)
+{
+    unsigned int tow,tod;
+    int i,n=0;
+
+    for (i=0;i<NEPOCH;i++) {
+        if (i==NEPOCH/2) *half=n;
+        tow=(TOW0+i*1000U)%WEEKMS;
+        tod=(tow%86400000U+10800000U-18000U)%86400000U; /* utc(su)+3h */
+        n+=genmsm4(1074,tow,arc+n);
+        n+=genmsm4(1084,7U<<27|tod,arc+n);
+        n+=gen1005(arc+n);
+    }
+    return n;
+}
+/* check records of window ---------------------------------------------------*/
+static int chkrec(const rtcmidx_t *idx, int n, unsigned int ts, int nep)
+{
+    int i;
+
+    if (n!=nep*3) return 0;
+    for (i=0;i<n;i++) {
+        if (idx[i].tow!=(ts+i/3*1000U)%WEEKMS) return 0;
+        if (idx[i].type!=(i%3==0?1074:i%3==1?1084:1005)) return 0;
+    }
+    return 1;
+}
+/* search windows of index ---------------------------------------------------*/
+static void search(const char *name)
+{
+    rtcmidx_t idx[64];
+    unsigned long long off,len;
+    char str[128];
+    int n;
+
+    n=rtcmidxsearch(IDXFILE,WEEKMS-2000,2000,0,idx,64);
+    sprintf(str,"%s over end of week",name);
+    check(chkrec(idx,n,WEEKMS-2000,4),str);
+
+    n=rtcmidxsearch(IDXFILE,0,3000,0,idx,64);
+    sprintf(str,"%s after end of week",name);
+    check(chkrec(idx,n,0,3),str);
+
+    n=rtcmidxsearch(IDXFILE,WEEKMS-5000,WEEKMS-3000,1084,idx,64);
+    sprintf(str,"%s before end of week",name);
+    check(n==2&&idx[0].tow==WEEKMS-5000&&idx[1].tow==WEEKMS-4000,str);
+
+    n=rtcmidxrange(IDXFILE,WEEKMS-1000,1000,&off,&len);
+    sprintf(str,"%s range over end of week",name);
+    check(n==6&&off>0&&len>0,str);
+}
+/* number of frames of message type in file ---------------------------------*/
+static int ntype(const char *file, int type)
+{
+    unsigned char *data;
+    int n,p=0,len,m=0;
+
+    if (!(data=readfile(NULL,file,&n))) return -1;
+    for (;(len=nextframe(data,n,&p))>0;p+=len) {
+        if (frametype(data+p)==type) m++;
+    }
+    free(data);
+    return m;
+}
+/* main ----------------------------------------------------------------------*/
+int main(void)
+{
+    static const char *files[]={ARCFILE},*outfiles[]={"t_idx_out.rtcm3"};
+    char *freq_c[7]=TPROF_L1;
+    rtcmidxw_t *w;
+    unsigned char arc[4096];
+    int n,half=0,nout;
+
+    n=genarc(arc,&half);
+    if (!writefile(NULL,ARCFILE,arc,n)) return 1;
+
+    check(rtcmidxbuild(ARCFILE,IDXFILE)==NEPOCH*3,"rtcmidxbuild");
+    search("rtcmidxbuild");
+
+    remove(IDXFILE);
+    if ((w=rtcmidxopen(IDXFILE,0))) {
+        rtcmidxinput(w,arc,half);
+        rtcmidxclose(w);
+    }
+    if ((w=rtcmidxopen(IDXFILE,half))) {
+        rtcmidxinput(w,arc+half,n-half);
+        rtcmidxclose(w);
+    }
+    search("rtcmidxinput");
+
+    check(rtcmextract(files,outfiles,1,WEEKMS-2000,2000,NULL,0,NULL,NULL,1,
+                      &nout)==12&&nout==12,"rtcmextract over end of week");
+
+    /* frames not converted (1005) copied with conversion */
+    check(rtcmextract(files,outfiles,1,WEEKMS-2000,2000,NULL,0,NULL,freq_c,1,
+                      &nout)==12&&nout==12&&ntype(outfiles[0],1005)==4,
+          "rtcmextract with freq_c");
+    return nfail?1:0;
+}
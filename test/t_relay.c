@@ -0,0 +1,226 @@
+/*------------------------------------------------------------------------------
+* t_relay.c : ntrip relay test with loopback sockets
+*
+* notes  : start rtcmrelay on a free loopback port, connect ntrip 1.0 and 2.0
+*          clients to the source and a derived mountpoint, send data/msm.rtcm3
+*          as ntrip 1.0 source and compare the streams received by the clients
+*          with the stream and the converter output of the same profile
+*
+*          usage : t_relay rtcmrelay datadir [nwrk]
+*-----------------------------------------------------------------------------*/
+#include <errno.h>
+#include <signal.h>
+#include <time.h>
+#include <unistd.h>
+#include <sys/socket.h>
+#include <sys/wait.h>
+#include <netinet/in.h>
+#include <arpa/inet.h>
+#include "tutil.h"
+
+#define PROF_L1     "L1,G1,E1,L1,L1,B1I,L5"
+#define TIMEOUT     10.0        /* receive timeout (s) */
+
+/* current time (s) ----------------------------------------------------------*/
+static double now(void)
+{
+    struct timespec tp;
+    clock_gettime(CLOCK_MONOTONIC,&tp);
+    return tp.tv_sec+tp.tv_nsec*1E-9;
+}
+/* free loopback port --------------------------------------------------------*/
+static int freeport(void)
+{
+    struct sockaddr_in sa={0};
+    socklen_t len=sizeof(sa);
+    int sock,port=0;
+
+    sa.sin_family=AF_INET;
+    sa.sin_addr.s_addr=htonl(INADDR_LOOPBACK);
+    if ((sock=socket(AF_INET,SOCK_STREAM,0))<0) return 0;
+    if (!bind(sock,(struct sockaddr *)&sa,sizeof(sa))&&
+        !getsockname(sock,(struct sockaddr *)&sa,&len)) {
+        port=ntohs(sa.sin_port);
+    }
+    close(sock);
+    return port;
+}
+/* connect to relay and send request ---------------------------------------*/
+static int connreq(int port, const char *req)
+{
+    struct sockaddr_in sa={0};
+    struct timeval tv={1,0};
+    int sock,i;
+
+    sa.sin_family=AF_INET;
+    sa.sin_port=htons((unsigned short)port);
+    sa.sin_addr.s_addr=htonl(INADDR_LOOPBACK);
+
+    for (i=0;i<50;i++) { /* relay may be starting */
+        if ((sock=socket(AF_INET,SOCK_STREAM,0))<0) return -1;
+        if (!connect(sock,(struct sockaddr *)&sa,sizeof(sa))) break;
+        close(sock);
+        sock=-1;
+        usleep(100000);
+    }
+    if (sock<0) return -1;
+    setsockopt(sock,SOL_SOCKET,SO_RCVTIMEO,&tv,sizeof(tv));
+    if (send(sock,req,strlen(req),0)!=(ssize_t)strlen(req)) {
+        close(sock);
+        return -1;
+    }
+    return sock;
+}
+/* receive response header (return: length of header,0:error) ----------------*/
+static int recvhead(int sock, char *buff, int size)
+{
+    int n=0;
+
+    while (n<size-1&&recv(sock,buff+n,1,0)==1) {
+        buff[++n]='\0';
+        if (n>=4&&!strcmp(buff+n-4,"\r\n\r\n")) return n;
+    }
+    return 0;
+}
+/* receive stream until n bytes or timeout -----------------------------------*/
+static int recvall(int sock, unsigned char *buff, int n)
+{
+    double t0=now();
+    int m=0,k;
+
+    while (m<n&&now()-t0<TIMEOUT) {
+        if ((k=(int)recv(sock,buff+m,n-m,0))>0) m+=k;
+        else if (k==0||(errno!=EAGAIN&&errno!=EWOULDBLOCK&&errno!=EINTR)) break;
+    }
+    return m;
+}
+/* decode complete chunks of http chunked stream ----------------------------*/
+static int unchunk(const unsigned char *in, int n, unsigned char *out)
+{
+    char *end;
+    int p=0,m=0;
+    long size;
+
+    while (p<n&&memchr(in+p,'\n',n-p)) {
+        size=strtol((const char *)in+p,&end,16);
+        if ((unsigned char *)end==in+p||size<=0) break;
+        p=(int)((unsigned char *)end-in)+2;
+        if (p+size+2>n) break;
+        memcpy(out+m,in+p,size);
+        m+=size;
+        p+=size+2;
+    }
+    return m;
+}
+/* receive chunked stream until n bytes of data or timeout -------------------*/
+static int recvchunk(int sock, unsigned char *buff, int size, unsigned char *out,
+                     int n)
+{
+    double t0=now();
+    int m=0,k,nout=0;
+
+    while (nout<n&&m<size&&now()-t0<TIMEOUT) {
+        if ((k=(int)recv(sock,buff+m,size-m,0))>0) m+=k;
+        else if (k==0||(errno!=EAGAIN&&errno!=EWOULDBLOCK&&errno!=EINTR)) break;
+        nout=unchunk(buff,m,out);
+    }
+    return nout;
+}
+/* expected output of derived mountpoint -------------------------------------*/
+static int expout(const unsigned char *data, int n, unsigned char *out)
+{
+    char *freq_c[7]=TPROF_L1;
+    rtcmcvt_t *cvt=rtcmcvtopen();
+    unsigned char buff[1200];
+    int p=0,len,type,lsd,nout=0;
+
+    rtcmcvtsetprof(cvt,rtcmprofnew(freq_c));
+
+    for (;(len=nextframe(data,n,&p))>0;p+=len) {
+        type=frametype(data+p);
+        if (!is_msm(type)&&!is_ssr(type)) {
+            memcpy(out+nout,data+p,len);
+            nout+=len;
+        }
+        else if (rtcmcvtinput(cvt,framesync(data+p),(unsigned char *)data+p,
+                              len,NULL,buff,&lsd)>0) {
+            memcpy(out+nout,buff,lsd);
+            nout+=lsd;
+        }
+    }
+    rtcmcvtclose(cvt);
+    return nout;
+}
+/* frames of stream without data out of frames -------------------------------*/
+static int frames(const unsigned char *data, int n, unsigned char *out)
+{
+    int p=0,len,nout=0;
+
+    for (;(len=nextframe(data,n,&p))>0;p+=len) {
+        memcpy(out+nout,data+p,len);
+        nout+=len;
+    }
+    return nout;
+}
+/* main ----------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    unsigned char *data,*exp,*raw,*out,*dec;
+    char head[1024],port_s[16],*nwrk=argc>3?argv[3]:"0";
+    int i,n,nexp,nraw,nout,port,src,cli[3],stat;
+    pid_t pid;
+
+    if (argc<3) {
+        fprintf(stderr,"usage: t_relay rtcmrelay datadir [nwrk]\n");
+        return 1;
+    }
+    signal(SIGPIPE,SIG_IGN);
+    if (!(data=readfile(argv[2],"msm.rtcm3",&n))) return 1;
+    exp=(unsigned char *)malloc(n);
+    raw=(unsigned char *)malloc(n);
+    out=(unsigned char *)malloc(2*n);
+    dec=(unsigned char *)malloc(2*n);
+    nexp=expout(data,n,exp);
+    nraw=frames(data,n,raw);
+
+    if (!(port=freeport())) return 1;
+    sprintf(port_s,"%d",port);
+
+    if (!(pid=fork())) {
+        execl(argv[1],argv[1],"-a","127.0.0.1","-p",port_s,"-n",nwrk,"-m","RAW",
+              "-m","L1:RAW:" PROF_L1,(char *)NULL);
+        _exit(127);
+    }
+    cli[0]=connreq(port,"GET /L1 HTTP/1.0\r\n\r\n");
+    cli[1]=connreq(port,"GET /L1 HTTP/1.1\r\nNtrip-Version: Ntrip/2.0\r\n\r\n");
+    cli[2]=connreq(port,"GET /RAW HTTP/1.0\r\n\r\n");
+
+    /* clients are registered when the response is received */
+    for (i=0;i<3;i++) {
+        check(cli[i]>=0&&recvhead(cli[i],head,sizeof(head))>0,"client connect");
+    }
+    src=connreq(port,"SOURCE x /RAW\r\n\r\n");
+    check(src>=0&&recvhead(src,head,sizeof(head))>0&&
+          !strncmp(head,"ICY 200 OK",10),"source connect");
+
+    for (i=0;src>=0&&i<n;i+=1000) { /* stream split at any byte */
+        send(src,data+i,n-i<1000?n-i:1000,0);
+    }
+    nout=cli[0]<0?0:recvall(cli[0],out,nexp);
+    check(nout==nexp&&!memcmp(out,exp,nexp),"ntrip 1.0 client converted");
+
+    nout=cli[1]<0?0:recvchunk(cli[1],out,2*n,dec,nexp);
+    check(nout==nexp&&!memcmp(dec,exp,nexp),"ntrip 2.0 client converted");
+
+    nout=cli[2]<0?0:recvall(cli[2],out,nraw);
+    check(nout==nraw&&!memcmp(out,raw,nraw),"ntrip 1.0 client source");
+
+    kill(pid,SIGTERM);
+    check(waitpid(pid,&stat,0)==pid&&WIFEXITED(stat)&&!WEXITSTATUS(stat),
+          "relay stop");
+
+    for (i=0;i<3;i++) if (cli[i]>=0) close(cli[i]);
+    if (src>=0) close(src);
+    free(data); free(exp); free(raw); free(out); free(dec);
+    return nfail?1:0;
+}
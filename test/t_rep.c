@@ -0,0 +1,134 @@
+/*------------------------------------------------------------------------------
+* t_rep.c : repeated message suppression test against refresh interval
+*
+* notes  : a synthetic stream of gps msm4 every 1 s carries station (1005,
+*          1033) and ephemeris (1020,1042) messages every 10 s, and two copies
+*          of each before the first msm epoch. the content of 1042 changes at
+*          20 s. with a refresh interval of 30 s, every copy must be forwarded
+*          or suppressed as written down, and suppressed copies counted
+*-----------------------------------------------------------------------------*/
+#include "tutil.h"
+
+#define NEPOCH      80          /* number of msm epochs */
+#define TOW0        345600000   /* tow of first epoch (ms) */
+#define TINT        30000       /* refresh interval (ms) */
+#define NTYPE       4           /* number of message types */
+#define NCOPY       9           /* number of copies of message type */
+
+static const int types[NTYPE]={1005,1020,1033,1042};
+
+/* forwarded copies of types (1:forward,0:suppress): 2 copies before the first
+   msm epoch, then copies at 10,20,...,70 s */
+static const char *fwds[NTYPE]={
+    "100001001","100001001","100001001","100100100"
+};
+
+/* set bits ------------------------------------------------------------------*/
+static void setbits(unsigned char *buff, int pos, int len, unsigned int data)
+{
+    int i;
+
+    for (i=len-1;i>=0;i--,pos++) {
+        if ((data>>i)&1) buff[pos/8]|=(unsigned char)(0x80>>(pos%8));
+        else buff[pos/8]&=(unsigned char)~(0x80>>(pos%8));
+    }
+}
+/* set frame header and parity (return: frame length) ------------------------*/
+static int setframe(unsigned char *buff, int nbit)
+{
+    unsigned int crc;
+    int len=(nbit+7)/8;
+
+    setbits(buff,0,8,0xD3);
+    setbits(buff,8,6,0);
+    setbits(buff,14,10,len-3);
+    crc=rtcmcrc24q(buff,len);
+    setbits(buff,len*8,24,crc);
+    return len+3;
+}
+/* generate gps msm4 frame of one satellite and signal -----------------------*/
+static int genmsm4(unsigned int epoch, unsigned char *buff)
+{
+    int p=24;
+
+    memset(buff,0,64);
+    setbits(buff,p,12,1074); p+=12;
+    setbits(buff,p,12,1);    p+=12; /* station id */
+    setbits(buff,p,30,epoch); p+=30;
+    p+=1+3+7+2+2+1+3; /* sync..smoothing interval */
+    setbits(buff,p,1,1); p+=64; /* satellite id 1 */
+    setbits(buff,p+1,1,1); p+=32; /* signal id 2 */
+    setbits(buff,p,1,1); p+=1;  /* cell */
+    setbits(buff,p, 8,70); p+=8;
+    setbits(buff,p,10,100); p+=10;
+    setbits(buff,p,15,1000); p+=15;
+    setbits(buff,p,22,2000); p+=22;
+    setbits(buff,p, 4,10); p+=4;
+    p+=1; /* half-cycle ambiguity */
+    setbits(buff,p, 6,40); p+=6;
+    return setframe(buff,p);
+}
+/* generate station or ephemeris frame with content iod ----------------------*/
+static int genmsg(int type, int iod, unsigned char *buff)
+{
+    int nbit=type==1005?152:type==1020?360:type==1033?80:511;
+
+    memset(buff,0,128);
+    setbits(buff,24,12,type);
+    setbits(buff,36,6,type==1033?0:5); /* station id or prn */
+    setbits(buff,48,8,iod);
+    return setframe(buff,24+nbit);
+}
+/* input frame to converter (return: 1:forwarded,0:not) ----------------------*/
+static int input(rtcmcvt_t *cvt, unsigned char *frm, int len)
+{
+    unsigned char out[1200];
+    int lsd=0;
+
+    return rtcmcvtinput(cvt,0,frm,len,NULL,out,&lsd)>0&&lsd>0;
+}
+/* input copies of all types --------------------------------------------------*/
+static void copies(rtcmcvt_t *cvt, int e, int ncopy, int fwd[][NCOPY])
+{
+    unsigned char buff[128];
+    int i,len;
+
+    for (i=0;i<NTYPE;i++) {
+        len=genmsg(types[i],types[i]==1042&&e>=20?2:1,buff);
+        fwd[i][ncopy]=input(cvt,buff,len);
+    }
+}
+/* main ----------------------------------------------------------------------*/
+int main(void)
+{
+    char *freq_c[7]=TPROF_L1;
+    rtcmcvt_t *cvt;
+    rtcmstat_t stat;
+    unsigned char buff[128];
+    char name[64];
+    int i,j,e,n=0,ok,nfwd,nsup,ntot=0,fwd[NTYPE][NCOPY];
+
+    if (!(cvt=rtcmcvtopen())) return 1;
+    rtcmcvtsetprof(cvt,rtcmprofnew(freq_c));
+    check(rtcmcvtrepeat(cvt,TINT),"rtcmcvtrepeat");
+
+    copies(cvt,-1,n++,fwd);
+    copies(cvt,-1,n++,fwd);
+    for (e=0;e<NEPOCH;e++) {
+        if (e>0&&e%10==0) copies(cvt,e,n++,fwd);
+        input(cvt,buff,genmsm4(TOW0+e*1000U,buff));
+    }
+    for (i=0;i<NTYPE;i++) {
+        for (j=nfwd=nsup=0,ok=n==NCOPY;j<NCOPY;j++) {
+            if (fwd[i][j]!=fwds[i][j]-'0') ok=0;
+            if (fwd[i][j]) nfwd++; else nsup++;
+        }
+        ntot+=nsup;
+        sprintf(name,"%d forwarded %d suppressed %d",types[i],nfwd,nsup);
+        check(ok,name);
+    }
+    rtcmcvtstat(cvt,&stat);
+    check(stat.nrep==(unsigned long long)ntot,"suppressed copies counted");
+    rtcmcvtclose(cvt);
+    return nfail?1:0;
+}
@@ -0,0 +1,109 @@
+/*------------------------------------------------------------------------------
+* t_rnx.c : rinex observation writer test against expected output
+*
+* notes  : data/msm.rtcm3 is converted with rtcmcvtinput() and written by
+*          rtcmrnxwrite() every 10 s. the file must be data/msm.rnx except the
+*          program/date line. run "t_rnx <dir> -w" to write it again after a
+*          reviewed change of the output. the library source is included to
+*          check the static F14.3 formatter with negative, clamped and sub-mm
+*          values, which msm observations cannot reach. files are written in
+*          the current directory
+*-----------------------------------------------------------------------------*/
+#include "rtcmCnv.c"
+#include "tutil.h"
+
+#define RNXFILE     "t_rnx.obs"
+#define WEEK        2300        /* gps week of first epoch */
+
+/* convert stream and write rinex --------------------------------------------*/
+static int writernx(const unsigned char *data, int n)
+{
+    char *freq_c[7]=TPROF_L1L2;
+    rtcmcvt_t *cvt;
+    rtcmrnx_t *rnx;
+    unsigned char out[1200];
+    int p=0,len,lsd,ret=1;
+
+    if (!(cvt=rtcmcvtopen())) return 0;
+    rtcmcvtsetprof(cvt,rtcmprofnew(freq_c));
+    rtcmcvtdecim(cvt,10000,0);
+    if (!(rnx=rtcmrnxopen(RNXFILE,"TEST",WEEK,3.04))) {
+        rtcmcvtclose(cvt);
+        return 0;
+    }
+    for (;(len=nextframe(data,n,&p))>0;p+=len) {
+        if (rtcmcvtinput(cvt,framesync(data+p),(unsigned char *)data+p,len,
+                         NULL,out,&lsd)<=0) continue;
+        if (rtcmrnxwrite(rnx,cvt)<0) ret=0;
+    }
+    if (!rtcmrnxclose(rnx)) ret=0;
+    rtcmcvtclose(cvt);
+    return ret;
+}
+/* compare rinex with expected except program/date line ----------------------*/
+static int cmprnx(const char *dir)
+{
+    FILE *fp,*fq;
+    char path[1024],s1[1024],s2[1024];
+    int ok=1,n=0;
+
+    sprintf(path,"%.900s/msm.rnx",dir);
+    if (!(fp=fopen(RNXFILE,"r"))) return 0;
+    if (!(fq=fopen(path,"r"))) {
+        fclose(fp);
+        return 0;
+    }
+    while (ok) {
+        if (!fgets(s1,sizeof(s1),fp)) {
+            ok=!fgets(s2,sizeof(s2),fq);
+            break;
+        }
+        if (!fgets(s2,sizeof(s2),fq)) ok=0;
+        else if (strstr(s1,"PGM / RUN BY / DATE")) ok=strstr(s2,"PGM / RUN BY / DATE")!=NULL;
+        else if (strcmp(s1,s2)) ok=0;
+        else if (s1[0]=='>') n++;
+    }
+    fclose(fp);
+    fclose(fq);
+    return ok&&n>0;
+}
+/* check F14.3 format of value -----------------------------------------------*/
+static int chkf143(double v, const char *str)
+{
+    char buff[16];
+
+    buff[14]='\0';
+    return rnx_f143(buff,v)==buff+14&&!strcmp(buff,str);
+}
+/* main ----------------------------------------------------------------------*/
+int main(int argc, char **argv)
+{
+    const char *dir=argc>1?argv[1]:"data";
+    unsigned char *data;
+    int n,write=argc>2&&!strcmp(argv[2],"-w");
+
+    check(chkf143(        0.0,"              "),"f14.3 zero as blank");
+    check(chkf143(   -123.4567,"      -123.457"),"f14.3 negative");
+    check(chkf143(      0.0004,"         0.000")&&
+          chkf143(      0.0005,"         0.001")&&
+          chkf143(     -0.0004,"        -0.000")&&
+          chkf143(     -0.0006,"        -0.001"),"f14.3 sub-0.001");
+    check(chkf143( 9999999999.999,"9999999999.999")&&
+          chkf143( 1E12          ,"9999999999.999")&&
+          chkf143( -999999999.999,"-999999999.999")&&
+          chkf143(-1E12          ,"-999999999.999"),"f14.3 clamped");
+
+    if (!(data=readfile(dir,"msm.rtcm3",&n))) return 1;
+    check(writernx(data,n),"rtcmrnxwrite");
+    free(data);
+
+    if (write) {
+        if ((data=readfile(NULL,RNXFILE,&n))) {
+            check(writefile(dir,"msm.rnx",data,n),"msm.rnx");
+            free(data);
+        }
+        return nfail?1:0;
+    }
+    check(cmprnx(dir),"msm.rnx");
+    return nfail?1:0;
+}
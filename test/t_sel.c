@@ -0,0 +1,432 @@
+/*------------------------------------------------------------------------------
+* t_sel.c : msm satellite and signal selection test against reference frames
+*
+* notes  : msm4 frames with all cells of the listed satellites and signals are
+*          converted with the verification on. the satellite and signal masks
+*          of the output are compared with the satellites and signals written
+*          down for the profile by the code priorities and satellite id ranges
+*          of rtcm 3 (not derived by the library). unknown frequencies and
+*          codes of profiles must be errors. observation data of a signal
+*          selection by codes must keep all selected codes of a frequency
+*          with signals not selected of lower signal ids. the 10-bit lock
+*          time indicator of msm7 must be kept above 255. ssr bias messages
+*          must keep the satellites and signal ids written down by the ssr
+*          signal ids of rtcm 3, and the other ssr messages must pass as they
+*          are if the system is selected
+*-----------------------------------------------------------------------------*/
+#include "tutil.h"
+
+#define MAXLIST     16
+
+typedef struct {            /* test case type */
+    const char *name;       /* case name */
+    int type;               /* msm4 message type */
+    const char *sel;        /* signal selection by obs codes (NULL: freq_c) */
+    char *freq_c[7];        /* frequency selection */
+    int sats[MAXLIST];      /* input satellite ids (0: end) */
+    int sigs[MAXLIST];      /* input signal ids (0: end) */
+    int osats[MAXLIST];     /* expected output satellite ids (0: end) */
+    int osigs[MAXLIST];     /* expected output signal ids (0: end) */
+} case_t;
+
+/* gps signal ids: 2:1C,3:1P,4:1W,10:2W,15:2S,16:2L,17:2X,22:5I,23:5Q,24:5X */
+static const case_t cases[]={
+    {"gps L1 1P over 1W"     ,1074,NULL,{"L1","","","","","",""},
+     {1,5,32},{3,4,10,16},{1,5,32},{3}},
+    {"gps L1+L2 1C,2W"       ,1074,NULL,{"L1+L2","","","","","",""},
+     {2,9},{2,4,10,16,23},{2,9},{2,10}},
+    {"gps L2+L5 2L,5I"       ,1074,NULL,{"L2+L5","","","","","",""},
+     {3},{15,16,17,22,23,24},{3},{16,22}},
+    {"gps L5+L1 order"       ,1074,NULL,{"L5+L1","","","","","",""},
+     {3},{4,24,23},{3},{4,23}},
+    {"gps invalid sat id"    ,1074,NULL,{"L1","","","","","",""},
+     {1,32,33,40},{2},{1,32},{2}},
+    {"gps codes 1C,2L,2W"    ,1074,"G:1C,2L,2W",{0},
+     {7},{2,4,10,16,17},{7},{2,10,16}},
+    {"gps codes 1W,5X"       ,1074,"G:1W,5X",{0},
+     {7,8},{2,4,23,24},{7,8},{4,24}},
+    /* qzss ids 1-10 (prn 193-202), galileo ids 1-36, bds ids 1-63 */
+    {"qzss invalid sat id"   ,1114,NULL,{"","","","L1","","",""},
+     {1,7,10,12},{2},{1,7,10},{2}},
+    {"galileo E1 1C over 1X" ,1094,NULL,{"","","E1","","","",""},
+     {4,36,37},{2,5},{4,36},{2}},
+    {"bds B1I 2I over 2Q"    ,1124,NULL,{"","","","","","B1I",""},
+     {1,46,63,64},{2,3},{1,46,63},{2}}
+};
+
+typedef struct {            /* ssr test case type */
+    const char *name;       /* case name */
+    int type;               /* ssr message type */
+    const char *sel;        /* signal selection by obs codes (NULL: freq_c) */
+    char *freq_c[7];        /* frequency selection */
+    int mm;                 /* multiple message bit */
+    int bias[MAXLIST][2];   /* input satellite and signal ids of biases */
+    int obias[MAXLIST][2];  /* expected output biases (sat 0: end) */
+    int out;                /* expected output (0:dropped,1:kept) */
+} ssrcase_t;
+
+/* ssr signal ids: gps 0:1C,2:1W,5:2C,11:2W,14:5I, glo 0:1C,1:1P,2:2C,3:2P */
+/* gal 2:1C,5:5I,8:7I,12:8Q, qzs 0:1C,2:1L,6:5I, bds 0:2I,1:2Q,3:6I         */
+static const ssrcase_t ssrcases[]={
+    {"ssr gps orbit"         ,1057,NULL,{"L1","","","","","",""},1,{{0}},
+     {{0}},1},
+    {"ssr gps clock"         ,1058,NULL,{"L1","","","","","",""},1,{{0}},
+     {{0}},1},
+    {"ssr gps combined"      ,1060,NULL,{"L1","","","","","",""},1,{{0}},
+     {{0}},1},
+    {"ssr gps high-rate clock",1062,NULL,{"L1","","","","","",""},1,{{0}},
+     {{0}},1},
+    {"ssr glonass orbit no glonass",1063,NULL,{"L1","","","","","",""},1,{{0}},
+     {{0}},0},
+    {"ssr galileo combined"  ,1243,NULL,{"","","E1","","","",""},1,{{0}},
+     {{0}},1},
+    {"ssr bds clock no bds"  ,1259,NULL,{"","","E1","","","",""},1,{{0}},
+     {{0}},0},
+    {"ssr gps code bias L1"  ,1059,NULL,{"L1","","","","","",""},1,
+     {{1,0},{1,2},{1,11},{5,11},{10,5},{10,0}},{{1,0},{1,2},{10,0}},1},
+    {"ssr gps code bias 1C,2W",1059,"G:1C,2W",{0},1,
+     {{1,0},{1,2},{1,11}},{{1,0},{1,11}},1},
+    {"ssr glonass code bias G1",1065,NULL,{"","G1","","","","",""},1,
+     {{3,0},{3,1},{3,2},{3,3}},{{3,0},{3,1}},1},
+    {"ssr galileo code bias E1+E5a",1242,NULL,{"","","E1+E5a","","","",""},1,
+     {{5,2},{5,5},{5,12}},{{5,2},{5,5}},1},
+    {"ssr bds code bias B3I" ,1260,NULL,{"","","","","","B3I",""},1,
+     {{30,0},{30,3}},{{30,3}},1},
+    {"ssr code bias empty mm=1",1059,NULL,{"L1","","","","","",""},1,
+     {{1,11}},{{0}},0},
+    {"ssr code bias empty mm=0",1059,NULL,{"L1","","","","","",""},0,
+     {{1,11}},{{0}},1},
+    {"ssr gps phase bias L1+L2",1265,NULL,{"L1+L2","","","","","",""},1,
+     {{2,0},{2,14},{2,11},{7,14}},{{2,0},{2,11}},1},
+    {"ssr glonass phase bias G1",1266,NULL,{"","G1","","","","",""},1,
+     {{24,2},{24,0}},{{24,0}},1},
+    {"ssr galileo phase bias E1",1267,NULL,{"","","E1","","","",""},1,
+     {{11,2},{11,5},{11,8}},{{11,2}},1},
+    {"ssr qzss phase bias L1",1268,NULL,{"","","","L1","","",""},1,
+     {{2,0},{2,2},{2,6}},{{2,0},{2,2}},1},
+    {"ssr bds phase bias B1I",1270,NULL,{"","","","","","B1I",""},1,
+     {{20,0},{20,1},{20,3}},{{20,0},{20,1}},1},
+    {"ssr sbas phase bias no sbas",1269,NULL,{"L1","","","","","",""},1,
+     {{1,0}},{{0}},0}
+};
+
+/* set bits ------------------------------------------------------------------*/
+static void setbits(unsigned char *buff, int pos, int len, unsigned int data)
+{
+    int i;
+
+    for (i=len-1;i>=0;i--,pos++) {
+        if ((data>>i)&1) buff[pos/8]|=(unsigned char)(0x80>>(pos%8));
+        else buff[pos/8]&=(unsigned char)~(0x80>>(pos%8));
+    }
+}
+/* get bit -------------------------------------------------------------------*/
+static int getbit(const unsigned char *buff, int pos)
+{
+    return (buff[pos/8]>>(7-pos%8))&1;
+}
+/* number of list ------------------------------------------------------------*/
+static int nlist(const int *list)
+{
+    int n=0;
+
+    while (n<MAXLIST&&list[n]) n++;
+    return n;
+}
+/* generate msm4 frame with all cells (return: frame length) -----------------*/
+static int genmsm4(const case_t *c, unsigned char *buff)
+{
+    unsigned int crc;
+    int i,p=24,len,nsat=nlist(c->sats),nsig=nlist(c->sigs),ncell=nsat*nsig;
+
+    memset(buff,0,1029);
+    setbits(buff,p,12,c->type); p+=12;
+    setbits(buff,p,12,1);       p+=12; /* station id */
+    setbits(buff,p,30,345600000); p+=30; /* epoch */
+    p+=1+3+7+2+2+1+3; /* sync..smoothing interval */
+    for (i=0;i<nsat;i++) setbits(buff,p+c->sats[i]-1,1,1);
+    p+=64;
+    for (i=0;i<nsig;i++) setbits(buff,p+c->sigs[i]-1,1,1);
+    p+=32;
+    for (i=0;i<ncell;i++) setbits(buff,p++,1,1);
+    for (i=0;i<nsat;i++,p+=8 ) setbits(buff,p, 8,70+i);
+    for (i=0;i<nsat;i++,p+=10) setbits(buff,p,10,100+i);
+    for (i=0;i<ncell;i++,p+=15) setbits(buff,p,15,1000+i);
+    for (i=0;i<ncell;i++,p+=22) setbits(buff,p,22,2000+i);
+    for (i=0;i<ncell;i++,p+=4 ) setbits(buff,p, 4,10);
+    p+=ncell; /* half-cycle ambiguity */
+    for (i=0;i<ncell;i++,p+=6 ) setbits(buff,p, 6,40+i%8);
+
+    len=(p+7)/8;
+    setbits(buff,8,6,0);
+    setbits(buff,0,8,0xD3);
+    setbits(buff,14,10,len-3);
+    crc=rtcmcrc24q(buff,len);
+    setbits(buff,len*8,24,crc);
+    return len+3;
+}
+/* generate msm7 frame of one satellite and signal with lock time indicator -*/
+static int genmsm7(int type, int lock, unsigned char *buff)
+{
+    unsigned int crc;
+    int p=24,len;
+
+    memset(buff,0,1029);
+    setbits(buff,p,12,type); p+=12;
+    setbits(buff,p,12,1);    p+=12; /* station id */
+    setbits(buff,p,30,345600000); p+=30; /* epoch */
+    p+=1+3+7+2+2+1+3; /* sync..smoothing interval */
+    setbits(buff,p,1,1); p+=64; /* satellite id 1 */
+    setbits(buff,p+1,1,1); p+=32; /* signal id 2 */
+    setbits(buff,p,1,1); p+=1;  /* cell */
+    setbits(buff,p, 8,70);   p+=8;
+    setbits(buff,p, 4,0);    p+=4;  /* extended satellite info */
+    setbits(buff,p,10,100);  p+=10;
+    setbits(buff,p,14,500);  p+=14; /* rough phaserange rate */
+    setbits(buff,p,20,1000); p+=20;
+    setbits(buff,p,24,2000); p+=24;
+    setbits(buff,p,10,lock); p+=10;
+    p+=1; /* half-cycle ambiguity */
+    setbits(buff,p,10,640);  p+=10; /* cnr (0.0625 dBHz) */
+    setbits(buff,p,15,100);  p+=15; /* fine phaserange rate */
+
+    len=(p+7)/8;
+    setbits(buff,8,6,0);
+    setbits(buff,0,8,0xD3);
+    setbits(buff,14,10,len-3);
+    crc=rtcmcrc24q(buff,len);
+    setbits(buff,len*8,24,crc);
+    return len+3;
+}
+/* ssr message field sizes (bits) (return: 1:bias message) ------------------*/
+static int ssrsize(int type, int *ep, int *ns, int *np, int *nx, int *nb)
+{
+    int glo=(type>=1063&&type<=1068)||type==1266;
+    int qzs=(type>=1246&&type<=1251)||type==1268;
+    int pb=type>=1265&&type<=1270;
+
+    *ep=glo?17:20;
+    *ns=qzs?4:6;
+    *np=qzs?4:(glo?5:6);
+    *nx=pb?17:0; /* yaw angle and yaw rate */
+    *nb=pb?32:19;
+    return pb||type==1059||type==1065||(type>=1240&&(type-1240)%6==2);
+}
+/* generate ssr frame (return: frame length) ---------------------------------
+* biases carry the satellite and signal ids in the value (sat*32+sig) so kept
+* fields can be checked, other messages carry a fixed pattern after header
+*-----------------------------------------------------------------------------*/
+static int genssr(const ssrcase_t *c, unsigned char *buff)
+{
+    unsigned int crc;
+    int i,j,k,p=24,len,nsat=0,ep,ns,np,nx,nb;
+
+    memset(buff,0,1029);
+    setbits(buff,p,12,c->type); p+=12;
+    if (!ssrsize(c->type,&ep,&ns,&np,&nx,&nb)) {
+        for (i=0;i<40;i++) buff[5+i]=(unsigned char)(0x5A+i*7);
+        setbits(buff,p,ep,1000); p+=ep+4;
+        setbits(buff,p,1,c->mm); p+=1+320;
+    }
+    else {
+        setbits(buff,p,ep,1000); p+=ep+4;
+        setbits(buff,p,1,c->mm); p+=1;
+        setbits(buff,p,4,1); p+=4+16+4; /* iod ssr, provider, solution */
+        if (nx) p+=2; /* dispersive bias, mw consistency */
+        for (i=0;i<MAXLIST&&c->bias[i][0];i++) {
+            if (!i||c->bias[i][0]!=c->bias[i-1][0]) nsat++;
+        }
+        setbits(buff,p,ns,nsat); p+=ns;
+        for (i=0;i<MAXLIST&&c->bias[i][0];i=j) {
+            for (j=i;j<MAXLIST&&c->bias[j][0]==c->bias[i][0];j++) ;
+            setbits(buff,p,np,c->bias[i][0]); p+=np;
+            setbits(buff,p,5,j-i); p+=5;
+            setbits(buff,p,nx,0x1ABCD&((1<<nx)-1)); p+=nx;
+            for (k=i;k<j;k++) {
+                setbits(buff,p,5,c->bias[k][1]); p+=5;
+                setbits(buff,p,nb-5,c->bias[k][0]*32+c->bias[k][1]); p+=nb-5;
+            }
+        }
+    }
+    len=(p+7)/8;
+    setbits(buff,8,6,0);
+    setbits(buff,0,8,0xD3);
+    setbits(buff,14,10,len-3);
+    crc=rtcmcrc24q(buff,len);
+    setbits(buff,len*8,24,crc);
+    return len+3;
+}
+/* get bits ------------------------------------------------------------------*/
+static unsigned int getbits(const unsigned char *buff, int pos, int len)
+{
+    unsigned int data=0;
+    int i;
+
+    for (i=0;i<len;i++) data=(data<<1)|getbit(buff,pos+i);
+    return data;
+}
+/* compare output ssr frame with expected biases -----------------------------*/
+static int cmpssr(const ssrcase_t *c, const unsigned char *in, int lin,
+                  const unsigned char *buff, int len)
+{
+    int i,j,k,n=0,p=24+12,nsat,sat,nbias,sig,ep,ns,np,nx,nb;
+
+    if (!ssrsize(c->type,&ep,&ns,&np,&nx,&nb)) {
+        return len==lin&&!memcmp(in,buff,len); /* unchanged */
+    }
+    if (len<6||frametype(buff)!=c->type) return 0;
+    p+=ep+4+1+4+16+4+(nx?2:0);
+    if (memcmp(in+3,buff+3,(p-24)/8)) return 0; /* header */
+
+    nsat=getbits(buff,p,ns); p+=ns;
+    for (i=0;i<nsat;i++) {
+        sat=getbits(buff,p,np); p+=np;
+        nbias=getbits(buff,p,5); p+=5;
+        if (nx&&getbits(buff,p,nx)!=0x1ABCDU) return 0;
+        p+=nx;
+        for (j=0;j<nbias;j++,n++) {
+            sig=getbits(buff,p,5); p+=5;
+            k=getbits(buff,p,nb-5); p+=nb-5;
+            if (n>=MAXLIST||c->obias[n][0]!=sat||c->obias[n][1]!=sig||
+                k!=sat*32+sig) return 0;
+        }
+    }
+    return (n>=MAXLIST||!c->obias[n][0])&&(p+7)/8+3==len;
+}
+/* compare masks of output frame with expected satellites and signals --------*/
+static int cmpmask(const case_t *c, const unsigned char *buff, int len)
+{
+    int i,n=0,nsat=nlist(c->osats),nsig=nlist(c->osigs);
+    int sat[64]={0},sig[32]={0};
+
+    if (len<6||frametype(buff)!=c->type) return 0;
+
+    for (i=0;i<nsat;i++) sat[c->osats[i]-1]=1;
+    for (i=0;i<nsig;i++) sig[c->osigs[i]-1]=1;
+    for (i=0;i<64;i++) if (getbit(buff,97 +i)!=sat[i]) return 0;
+    for (i=0;i<32;i++) if (getbit(buff,161+i)!=sig[i]) return 0;
+    for (i=0;i<nsat*nsig;i++) n+=getbit(buff,193+i);
+    return n==nsat*nsig; /* all cells kept */
+}
+/* profile errors of unknown frequencies and codes -------------------------*/
+static void proferr(void)
+{
+    char *ok[7]={"L1+L2","G1","E1+E5a","L1","","B1I+B3I","L5"};
+    char *ng[7]={"L1+L9","G1","E1+E5a","L1","","B1I+B3I","L5"};
+    char *ng2[7]={"L1","G1","E1","L1","","B1I+B2x","L5"};
+    rtcmprof_t *prof;
+    rtcmcvt_t *cvt;
+    unsigned char in[1029],out[1200];
+    int len,lsd,nused;
+
+    check((prof=rtcmprofnew(ok))!=NULL,"profile known frequencies");
+    rtcmproffree(prof);
+    check(!rtcmprofnew(ng) ,"profile unknown gps frequency");
+    check(!rtcmprofnew(ng2),"profile unknown bds frequency");
+    check(!rtcmprofsig("G:1C,9Z"),"profile unknown obs code");
+
+    len=genmsm4(cases,in);
+    check(rtcmCvt(0,in,len,ng,out,&lsd)==-1&&lsd==0,
+          "rtcmCvt unknown frequency");
+
+    if (!(cvt=rtcmcvtopen())) return;
+    check(rtcmcvtinput(cvt,0,in,len,ng,out,&lsd)==-1&&lsd==0,
+          "rtcmcvtinput unknown frequency");
+    check(rtcmcvtinputs(cvt,in,len,&nused,ng,out,&lsd)==-1&&nused==len,
+          "rtcmcvtinputs unknown frequency");
+    check(rtcmcvtinput(cvt,0,in,len,ok,out,&lsd)>0,
+          "rtcmcvtinput known frequency");
+    rtcmcvtclose(cvt);
+}
+/* observation data of codes selected on same frequencies -----------------*/
+static void obssel(void)
+{
+    static const case_t c={"",1074,"G:1C,1W,2W,2L",{0},
+                           {7},{2,3,4,8,9,10,15,16},{0},{0}};
+    static const char *codes[]={"1C","1W","2W","2L"};
+    rtcmcvt_t *cvt;
+    rtcmobs_t obs[32];
+    unsigned char in[1029],out[1200];
+    int i,j,n,len,lsd,ok=1;
+
+    if (!(cvt=rtcmcvtopen())) return;
+    rtcmcvtsetprof(cvt,rtcmprofsig(c.sel));
+    len=genmsm4(&c,in);
+    rtcmcvtinput(cvt,0,in,len,NULL,out,&lsd);
+    n=rtcmcvtobs(cvt,obs,32);
+
+    for (i=0;i<4;i++) {
+        for (j=0;j<n&&strcmp(obs[j].code,codes[i]);j++) ;
+        if (j>=n) ok=0;
+    }
+    check(ok,"gps codes 1C,1W,2W,2L obs data");
+    rtcmcvtclose(cvt);
+}
+/* observation data of msm7 lock time indicators over 8 bits --------------*/
+static void obslock(void)
+{
+    static const int locks[]={255,256,600,704};
+    char *freq_c[7]=TPROF_L1;
+    rtcmcvt_t *cvt;
+    rtcmobs_t obs[4];
+    unsigned char in[1029],out[1200];
+    int i,len,lsd,ok=1;
+
+    if (!(cvt=rtcmcvtopen())) return;
+    for (i=0;i<4;i++) {
+        len=genmsm7(1077,locks[i],in);
+        if (rtcmcvtinput(cvt,0,in,len,freq_c,out,&lsd)<=0||
+            rtcmcvtobs(cvt,obs,4)!=1||obs[0].lock!=locks[i]) ok=0;
+    }
+    check(ok,"msm7 lock time indicator over 255");
+    rtcmcvtclose(cvt);
+}
+/* ssr satellite and signal selection ---------------------------------------*/
+static void ssrsel(void)
+{
+    const ssrcase_t *c;
+    rtcmcvt_t *cvt;
+    unsigned char in[1029],out[1200];
+    int i,len,lsd,ret;
+
+    for (i=0;i<(int)(sizeof(ssrcases)/sizeof(*ssrcases));i++) {
+        c=ssrcases+i;
+        if (!(cvt=rtcmcvtopen())) return;
+        if (c->sel) rtcmcvtsetprof(cvt,rtcmprofsig(c->sel));
+        else rtcmcvtsetprof(cvt,rtcmprofnew((char **)c->freq_c));
+
+        len=genssr(c,in);
+        lsd=0;
+        ret=rtcmcvtinput(cvt,0,in,len,NULL,out,&lsd);
+        check(c->out?ret>0&&cmpssr(c,in,len,out,lsd):ret<=0&&lsd==0,c->name);
+        rtcmcvtclose(cvt);
+    }
+}
+/* main ----------------------------------------------------------------------*/
+int main(void)
+{
+    const case_t *c;
+    rtcmcvt_t *cvt;
+    rtcmstat_t stat;
+    unsigned char in[1029],out[1200];
+    int i,len,lsd,ret;
+
+    for (i=0;i<(int)(sizeof(cases)/sizeof(*cases));i++) {
+        c=cases+i;
+        if (!(cvt=rtcmcvtopen())) return 1;
+        if (c->sel) rtcmcvtsetprof(cvt,rtcmprofsig(c->sel));
+        else rtcmcvtsetprof(cvt,rtcmprofnew((char **)c->freq_c));
+        rtcmcvtverify(cvt,1);
+
+        len=genmsm4(c,in);
+        ret=rtcmcvtinput(cvt,0,in,len,NULL,out,&lsd);
+        rtcmcvtstat(cvt,&stat);
+        check(ret>0&&stat.nverr==0&&cmpmask(c,out,lsd),c->name);
+        rtcmcvtclose(cvt);
+    }
+    proferr();
+    obssel();
+    obslock();
+    ssrsel();
+    return nfail?1:0;
+}
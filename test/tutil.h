@@ -0,0 +1,108 @@
+/*------------------------------------------------------------------------------
+* tutil.h : common functions of rtcmCnv tests
+*-----------------------------------------------------------------------------*/
+#ifndef TUTIL_H
+#define TUTIL_H
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include "rtcmCnv.h"
+
+#define TPROF_L1    {"L1","G1","E1","L1","L1","B1I","L5"}
+#define TPROF_L1L2  {"L1+L2","G1+G2","E1+E5a","L2+L5","","B3I","L5"}
+
+/* read file -------------------------------------------------------------------
+* args   : char   *dir      I   directory (NULL: no)
+*          char   *file     I   file name
+*          int    *n        O   file size (bytes)
+* return : file data (NULL: error), free by free()
+*-----------------------------------------------------------------------------*/
+static inline unsigned char *readfile(const char *dir, const char *file, int *n)
+{
+    FILE *fp;
+    unsigned char *data;
+    char path[1024];
+    long size;
+
+    sprintf(path,"%.900s%s%.100s",dir?dir:"",dir?"/":"",file);
+    *n=0;
+    if (!(fp=fopen(path,"rb"))) {
+        fprintf(stderr,"file open error: %s\n",path);
+        return NULL;
+    }
+    fseek(fp,0,SEEK_END);
+    size=ftell(fp);
+    fseek(fp,0,SEEK_SET);
+    if (!(data=(unsigned char *)malloc(size>0?size:1))||
+        fread(data,1,size,fp)!=(size_t)size) {
+        fprintf(stderr,"file read error: %s\n",path);
+        free(data);
+        fclose(fp);
+        return NULL;
+    }
+    fclose(fp);
+    *n=(int)size;
+    return data;
+}
+/* write file ----------------------------------------------------------------*/
+static inline int writefile(const char *dir, const char *file,
+                            const unsigned char *data, int n)
+{
+    FILE *fp;
+    char path[1024];
+    int ret;
+
+    sprintf(path,"%.900s%s%.100s",dir?dir:"",dir?"/":"",file);
+    if (!(fp=fopen(path,"wb"))) return 0;
+    ret=fwrite(data,1,n,fp)==(size_t)n;
+    fclose(fp);
+    return ret;
+}
+/* next rtcm 3 frame of stream -------------------------------------------------
+* args   : unsigned char *data I stream data
+*          int    n         I   number of stream data
+*          int    *p        IO  stream position (frame start on return)
+* return : frame length (bytes) (0: no frame)
+*-----------------------------------------------------------------------------*/
+static inline int nextframe(const unsigned char *data, int n, int *p)
+{
+    int len;
+
+    for (;*p+3<=n;(*p)++) {
+        if (data[*p]!=0xD3) continue;
+        len=(((data[*p+1]&3)<<8)|data[*p+2])+6;
+        if (*p+len<=n) return len;
+    }
+    return 0;
+}
+/* message type of frame -----------------------------------------------------*/
+static inline int frametype(const unsigned char *frm)
+{
+    return (frm[3]<<4)|(frm[4]>>4);
+}
+/* multiple message bit of frame (msm, bit 78) -------------------------------*/
+static inline int framesync(const unsigned char *frm)
+{
+    return (frm[9]>>1)&1;
+}
+/* is msm message type ---------------------------------------------------------*/
+static inline int is_msm(int type)
+{
+    return type>=1071&&type<=1137&&type%10>=1&&type%10<=7;
+}
+/* is ssr message type -------------------------------------------------------*/
+static inline int is_ssr(int type)
+{
+    return (type>=1057&&type<=1068)||(type>=1240&&type<=1263)||
+           (type>=1265&&type<=1270);
+}
+/* test result -----------------------------------------------------------------*/
+static int nfail=0;
+
+static inline void check(int ok, const char *name)
+{
+    if (!ok) nfail++;
+    fprintf(stderr,"%-40s %s\n",name,ok?"OK":"NG");
+}
+#endif /* TUTIL_H */